@@ -0,0 +1,246 @@
+//===-- PagedArray.h --------------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_PAGEDARRAY_H
+#define KLEE_PAGEDARRAY_H
+
+#include "klee/ADT/Ref.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <vector>
+
+namespace klee {
+
+/// HeapAllocator - The default allocation policy of PagedArray, which takes
+/// memory from the global heap.
+struct HeapAllocator {
+  static void *allocate(size_t size) { return ::operator new(size); }
+  static void deallocate(void *p, size_t) { ::operator delete(p); }
+};
+
+/// PagedArray - A fixed-size array whose elements are stored in reference
+/// counted pages of PageBytes bytes. Copies of the array share all pages,
+/// and a shared page is only copied once it is modified, so that modifying
+/// a copy of a large array costs one page rather than the whole array.
+///
+/// The pages, and the array itself when created with new, are allocated by
+/// \a Allocator, which provides static allocate(size) and
+/// deallocate(p, size) functions.
+template <typename T, typename Allocator = HeapAllocator> class PagedArray {
+public:
+  static constexpr unsigned PageBytes = 4096;
+  static constexpr unsigned PageSize = PageBytes / sizeof(T);
+  static_assert((PageSize & (PageSize - 1)) == 0,
+                "page size must be a power of two");
+
+private:
+  /// Every page is preceded by the size of its allocation. The size cannot
+  /// be stored in the page, as it is needed to deallocate the page after
+  /// its destructor ran.
+  static constexpr size_t HeaderBytes = alignof(std::max_align_t);
+  static_assert(sizeof(size_t) <= HeaderBytes, "page header too small");
+
+  /// A page, followed by the storage for its elements. The last page of
+  /// an array only holds the remaining elements, so small arrays do not
+  /// pay for a full page.
+  class Page {
+  public:
+    class ReferenceCounter _refCount;
+
+  private:
+    unsigned count;
+
+    explicit Page(unsigned count) : count(count) {}
+
+    static size_t getAllocationSize(unsigned count) {
+      return HeaderBytes + sizeof(Page) + count * sizeof(T);
+    }
+
+    /// Allocate the memory for a page of \a count elements.
+    static void *allocate(unsigned count) {
+      size_t size = getAllocationSize(count);
+      char *memory = static_cast<char *>(Allocator::allocate(size));
+      *reinterpret_cast<size_t *>(memory) = size;
+      return memory + HeaderBytes;
+    }
+
+  public:
+    T *data() { return reinterpret_cast<T *>(this + 1); }
+
+    static Page *create(unsigned count, const T &value) {
+      Page *page = new (allocate(count)) Page(count);
+      std::uninitialized_fill_n(page->data(), count, value);
+      return page;
+    }
+
+    static Page *create(Page &page) {
+      Page *copy = new (allocate(page.count)) Page(page.count);
+      std::uninitialized_copy(page.data(), page.data() + page.count,
+                              copy->data());
+      return copy;
+    }
+
+    ~Page() {
+      for (unsigned i = 0; i != count; ++i)
+        data()[i].~T();
+    }
+
+    static void operator delete(void *memory) {
+      char *start = static_cast<char *>(memory) - HeaderBytes;
+      Allocator::deallocate(start, *reinterpret_cast<size_t *>(start));
+    }
+  };
+  static_assert(sizeof(Page) % alignof(T) == 0, "misaligned page storage");
+
+  std::vector<ref<Page> > pages;
+  unsigned size;
+
+  /// Make page \a index exclusive to this array.
+  ///
+  /// \return True if the page had to be copied.
+  bool makeUnique(unsigned index) {
+    ref<Page> &page = pages[index];
+    if (page->_refCount.getCount() == 1)
+      return false;
+    page = Page::create(*page);
+    return true;
+  }
+
+public:
+  PagedArray(unsigned size, const T &value = T()) : size(size) {
+    fill(value);
+  }
+
+  static void *operator new(size_t size) { return Allocator::allocate(size); }
+  static void operator delete(void *p, size_t size) {
+    Allocator::deallocate(p, size);
+  }
+
+  unsigned getSize() const { return size; }
+  unsigned getNumPages() const { return pages.size(); }
+
+  const T &operator[](unsigned idx) const {
+    return pages[idx / PageSize]->data()[idx % PageSize];
+  }
+
+  /// set - Set the element at \a idx, copying its page if it is shared.
+  ///
+  /// \return True if a page was copied.
+  bool set(unsigned idx, const T &value) {
+    bool copied = makeUnique(idx / PageSize);
+    pages[idx / PageSize]->data()[idx % PageSize] = value;
+    return copied;
+  }
+
+  /// fill - Set all elements to \a value, with fresh pages.
+  void fill(const T &value) {
+    pages.clear();
+    pages.reserve((size + PageSize - 1) / PageSize);
+    for (unsigned begin = 0; begin < size; begin += PageSize)
+      pages.push_back(Page::create(std::min(PageSize, size - begin), value));
+  }
+
+  /// copyOut - Copy all elements to \a dest.
+  void copyOut(T *dest) const {
+    for (unsigned i = 0, begin = 0; begin < size; ++i, begin += PageSize) {
+      const T *data = pages[i]->data();
+      std::copy(data, data + std::min(PageSize, size - begin), dest + begin);
+    }
+  }
+
+  /// equals - Check whether all elements are equal to those at \a src.
+  bool equals(const T *src) const {
+    for (unsigned i = 0, begin = 0; begin < size; ++i, begin += PageSize) {
+      const T *data = pages[i]->data();
+      if (!std::equal(data, data + std::min(PageSize, size - begin),
+                      src + begin))
+        return false;
+    }
+    return true;
+  }
+
+  /// copyIn - Copy all elements from \a src. Pages whose contents do not
+  /// change stay shared.
+  ///
+  /// \return The number of pages that were copied.
+  unsigned copyIn(const T *src) {
+    unsigned copied = 0;
+    for (unsigned i = 0, begin = 0; begin < size; ++i, begin += PageSize) {
+      unsigned count = std::min(PageSize, size - begin);
+      if (std::equal(src + begin, src + begin + count, pages[i]->data()))
+        continue;
+      copied += makeUnique(i);
+      std::copy(src + begin, src + begin + count, pages[i]->data());
+    }
+    return copied;
+  }
+
+  /// getNumSharedPages - Return the number of pages that are shared with
+  /// another array.
+  unsigned getNumSharedPages() const {
+    unsigned shared = 0;
+    for (const auto &page : pages)
+      shared += page->_refCount.getCount() > 1;
+    return shared;
+  }
+};
+
+template <typename T, typename Allocator>
+constexpr unsigned PagedArray<T, Allocator>::PageBytes;
+template <typename T, typename Allocator>
+constexpr unsigned PagedArray<T, Allocator>::PageSize;
+template <typename T, typename Allocator>
+constexpr size_t PagedArray<T, Allocator>::HeaderBytes;
+
+/// BasicPagedBitArray - A BitArray on top of a PagedArray.
+template <typename Allocator = HeapAllocator> class BasicPagedBitArray {
+  PagedArray<uint32_t, Allocator> bits;
+
+  static unsigned length(unsigned size) { return (size + 31) / 32; }
+
+public:
+  BasicPagedBitArray(unsigned size, bool value = false)
+      : bits(length(size), value ? 0xFFFFFFFF : 0) {}
+
+  static void *operator new(size_t size) { return Allocator::allocate(size); }
+  static void operator delete(void *p, size_t size) {
+    Allocator::deallocate(p, size);
+  }
+
+  unsigned getNumPages() const { return bits.getNumPages(); }
+
+  bool get(unsigned idx) const { return (bits[idx / 32] >> (idx & 0x1F)) & 1; }
+
+  /// set - Set the bit at \a idx.
+  ///
+  /// \return True if a page was copied.
+  bool set(unsigned idx) {
+    uint32_t word = bits[idx / 32];
+    uint32_t updated = word | (1U << (idx & 0x1F));
+    return updated != word && bits.set(idx / 32, updated);
+  }
+
+  /// unset - Clear the bit at \a idx.
+  ///
+  /// \return True if a page was copied.
+  bool unset(unsigned idx) {
+    uint32_t word = bits[idx / 32];
+    uint32_t updated = word & ~(1U << (idx & 0x1F));
+    return updated != word && bits.set(idx / 32, updated);
+  }
+};
+
+typedef BasicPagedBitArray<> PagedBitArray;
+
+} // End klee namespace
+
+#endif /* KLEE_PAGEDARRAY_H */
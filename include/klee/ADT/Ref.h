@@ -56,6 +56,10 @@ class ReferenceCounter {
   /// Count how often the object has been referenced.
   unsigned refCount = 0;
 
+  /// The count of objects that are never deleted. Their count is only read,
+  /// so they can be shared between threads.
+  static const unsigned immortal = ~0u;
+
 public:
   ReferenceCounter() = default;
   ~ReferenceCounter() = default;
@@ -69,6 +73,10 @@ public:
   /// \return number of references on this object
   unsigned getCount() {return refCount;}
 
+  /// Pin the object: it is never deleted, and referencing it no longer
+  /// writes to it. Must be called before the object is shared.
+  void makeImmortal() { refCount = immortal; }
+
   // Copy assignment operator
   ReferenceCounter &operator=(const ReferenceCounter &a) {
     if (this == &a)
@@ -95,12 +103,13 @@ public:
 
 private:
   void inc() const {
-    if (ptr)
+    if (ptr && ptr->_refCount.refCount != ReferenceCounter::immortal)
       ++ptr->_refCount.refCount;
   }
 
   void dec() const {
-    if (ptr && --ptr->_refCount.refCount == 0)
+    if (ptr && ptr->_refCount.refCount != ReferenceCounter::immortal &&
+        --ptr->_refCount.refCount == 0)
       delete ptr;
   }
 
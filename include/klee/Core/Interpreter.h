@@ -45,6 +45,15 @@ public:
   virtual void processTestCase(const ExecutionState &state,
                                const char *err,
                                const char *suffix) = 0;
+
+  /// Called from time to time during exploration. Returns the number of
+  /// pending states that should be passed to handOverState(), e.g. to be
+  /// explored by another process.
+  virtual unsigned getNumStatesWanted() { return 0; }
+
+  /// Take over \a state, which the interpreter drops afterwards without
+  /// terminating it. Its path stream identifies it.
+  virtual void handOverState(const ExecutionState &state) {}
 };
 
 class Interpreter {
@@ -125,6 +134,10 @@ public:
   // a user specified path. use null to reset.
   virtual void setReplayPath(const std::vector<bool> *path) = 0;
 
+  // supply a list of branch decisions to follow before exploring normally
+  // from the state they lead to. use null to reset.
+  virtual void setPathPrefix(const std::vector<bool> *prefix) = 0;
+
   // supply a set of symbolic bindings that will be used as "seeds"
   // for the search. use null to reset.
   virtual void useSeeds(const std::vector<struct KTest *> *seeds) = 0;
@@ -138,10 +151,15 @@ public:
 
   virtual void setHaltExecution(bool value) = 0;
 
+  virtual bool getHaltExecution() const = 0;
+
   virtual void setInhibitForking(bool value) = 0;
 
   virtual void prepareForEarlyExit() = 0;
 
+  // leave writing the statistics files to another process.
+  virtual void disableStatsOutput() = 0;
+
   /*** State accessor methods ***/
 
   virtual unsigned getPathStreamID(const ExecutionState &state) = 0;
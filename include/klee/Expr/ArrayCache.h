@@ -27,6 +27,26 @@ struct EquivArrayCmpFn {
   }
 };
 
+/// Hashes constant arrays by their contents, ignoring their names.
+struct ConstantArrayHashFn {
+  unsigned operator()(const Array *array) const {
+    unsigned res = array->size;
+    for (const auto &value : array->constantValues)
+      res = (res * Expr::MAGIC_HASH_CONSTANT) + value->hash();
+    return res;
+  }
+};
+
+/// Compares constant arrays by their contents, ignoring their names.
+struct EquivConstantArrayCmpFn {
+  bool operator()(const Array *array1, const Array *array2) const {
+    return array1->size == array2->size &&
+           array1->domain == array2->domain &&
+           array1->range == array2->range &&
+           array1->constantValues == array2->constantValues;
+  }
+};
+
 /// Provides an interface for creating and destroying Array objects.
 class ArrayCache {
 public:
@@ -35,8 +55,10 @@ public:
   /// Create an Array object.
   //
   /// Symbolic Arrays are cached so that only one instance exists. This
-  /// provides a limited form of "alpha-renaming". Constant arrays are not
-  /// cached.
+  /// provides a limited form of "alpha-renaming". Constant arrays are
+  /// interned by their contents, so that an array with the same contents as
+  /// an existing one is that array, under the name it was first created
+  /// with.
   ///
   /// This class retains ownership of Array object so that upon destruction
   /// of this object all allocated Array objects are deleted.
@@ -64,8 +86,10 @@ private:
                              klee::EquivArrayCmpFn>
       ArrayHashMap;
   ArrayHashMap cachedSymbolicArrays;
-  typedef std::vector<const Array *> ArrayPtrVec;
-  ArrayPtrVec concreteArrays;
+  typedef std::unordered_set<const Array *, klee::ConstantArrayHashFn,
+                             klee::EquivConstantArrayCmpFn>
+      ConstantArrayHashMap;
+  ConstantArrayHashMap cachedConstantArrays;
 };
 }
 
@@ -12,8 +12,11 @@
 
 #include "klee/Expr/Constraints.h"
 #include "klee/Expr/ExprEvaluator.h"
+#include "klee/Expr/ExprHashMap.h"
 
 #include <map>
+#include <memory>
+#include <vector>
 
 namespace klee {
   class Array;
@@ -64,6 +67,29 @@ namespace klee {
     AssignmentEvaluator(const Assignment &_a) : a(_a) {}    
   };
 
+  /// AssignmentBatchEvaluator - Evaluates expressions under several
+  /// assignments at once. Every node of the expression DAG is visited once
+  /// and yields its values under all assignments, and the results are
+  /// memoized across calls. Free values are not allowed, i.e. unbound
+  /// bytes evaluate to zero.
+  class AssignmentBatchEvaluator {
+  public:
+    /// The values of an expression, one entry per assignment. An entry is
+    /// null if the expression does not evaluate to a constant under that
+    /// assignment (e.g. because of a division by zero).
+    typedef std::vector<ref<ConstantExpr> > values_ty;
+
+  private:
+    std::vector<std::unique_ptr<AssignmentEvaluator> > evaluators;
+    ExprHashMap<values_ty> cache;
+
+  public:
+    explicit AssignmentBatchEvaluator(
+        const std::vector<const Assignment *> &assignments);
+
+    const values_ty &evaluate(const ref<Expr> &e);
+  };
+
   /***/
 
   inline ref<Expr> Assignment::evaluate(const Array *array, 
@@ -0,0 +1,107 @@
+//===-- CompiledExpr.h ------------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_COMPILEDEXPR_H
+#define KLEE_COMPILEDEXPR_H
+
+#include "klee/Expr/Expr.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace klee {
+  class Array;
+  class Assignment;
+
+  /// CompiledExpr - A conjunction of boolean expressions, flattened into a
+  /// linear program over 64-bit registers. Checking the conjunction against
+  /// an assignment runs the program once, without walking the expression
+  /// DAG or creating any expressions, and several assignments can be checked
+  /// in lockstep.
+  ///
+  /// The check is conservative: an assignment under which an expression
+  /// divides by zero, or reads a free value, does not satisfy it.
+  class CompiledExpr {
+  public:
+    /// The number of assignments checked in lockstep by the batch mode.
+    static const unsigned BatchSize = 8;
+
+    enum Opcode : uint8_t {
+      Const, Read, Select, Concat, Extract, SExt, Not,
+      Add, Sub, Mul, UDiv, SDiv, URem, SRem, And, Or, Xor,
+      Shl, LShr, AShr, Eq, Ult, Ule, Slt, Sle
+    };
+
+    /// A single instruction. The result of instruction i is stored in
+    /// register i, and operands refer to earlier registers.
+    struct Instruction {
+      Opcode op;
+      /// The width of the result.
+      uint8_t width;
+      uint32_t a, b, c;
+      /// A constant operand: the value for Const, the bit offset for
+      /// Extract, the width of the operands for SExt and comparisons, the
+      /// width of the low part for Concat, and the update list for Read.
+      uint64_t imm;
+    };
+
+    /// An update of an array, with the registers holding its index and
+    /// value. Update lists share their writes like UpdateNodes do.
+    struct Write {
+      uint32_t index, value;
+      /// The next older write, or -1.
+      int32_t next;
+    };
+
+    /// An update list, i.e. an array and its most recent write (or -1).
+    struct Updates {
+      unsigned array;
+      int32_t head;
+    };
+
+  private:
+    std::vector<Instruction> program;
+    std::vector<Write> writes;
+    std::vector<Updates> updateLists;
+    std::vector<const Array *> arrays;
+    /// The register of every expression of the conjunction, and the number
+    /// of instructions needed to compute it and all earlier ones.
+    std::vector<std::pair<uint32_t, uint32_t> > roots;
+
+    CompiledExpr() {}
+
+    void run(const Assignment *const *assignments, unsigned count,
+             bool *result) const;
+
+    friend class ExprCompiler;
+
+  public:
+    /// compile - Compile the conjunction of the given boolean expressions.
+    ///
+    /// \return The compiled conjunction, or null if the expressions cannot
+    /// be compiled (e.g. because they are wider than 64 bits).
+    static std::unique_ptr<CompiledExpr>
+    compile(const std::vector<ref<Expr> > &exprs);
+
+    /// satisfiedBy - Check whether all expressions are true under \a a.
+    bool satisfiedBy(const Assignment &a) const;
+
+    /// satisfiedBy - Check the assignments \a BatchSize at a time.
+    ///
+    /// \param result [out] - For every assignment, whether it satisfies all
+    /// expressions.
+    void satisfiedBy(const std::vector<const Assignment *> &assignments,
+                     std::vector<bool> &result) const;
+
+    unsigned size() const { return program.size(); }
+  };
+}
+
+#endif /* KLEE_COMPILEDEXPR_H */
@@ -19,6 +19,7 @@
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include <atomic>
 #include <sstream>
 #include <set>
 #include <vector>
@@ -90,7 +91,9 @@ Todo: Shouldn't bool \c Xor just be written as not equal?
 
 class Expr {
 public:
-  static unsigned count;
+  /// The number of expressions alive. Expressions are created on several
+  /// threads by the thread-safe solver, so this is updated atomically.
+  static std::atomic<unsigned> count;
   static const unsigned MAGIC_HASH_CONSTANT = 39;
 
   /// The type of an expression is simply its width, in bits. 
@@ -204,8 +207,8 @@ protected:
   virtual int compareContents(const Expr &b) const = 0;
 
 public:
-  Expr() { Expr::count++; }
-  virtual ~Expr() { Expr::count--; } 
+  Expr() { Expr::count.fetch_add(1, std::memory_order_relaxed); }
+  virtual ~Expr() { Expr::count.fetch_sub(1, std::memory_order_relaxed); }
 
   virtual Kind getKind() const = 0;
   virtual Width getWidth() const = 0;
@@ -1005,6 +1008,34 @@ private:
 
   ConstantExpr(const llvm::APInt &v) : value(v) {}
 
+  /// The small values of the common widths are allocated only once, so
+  /// that concrete execution mostly does not allocate. They are created
+  /// during static initialization, before any threads exist, and are
+  /// immortal, so that threads share them without touching their counts.
+  static const unsigned numSmallValues = 256;
+  static ConstantExpr *smallValues[5][numSmallValues];
+  static bool smallValuesInitialized;
+  static bool initializeSmallValues();
+
+  /// The row of smallValues for constants of width \a w, or -1 if they
+  /// are not shared.
+  static int getSmallValuesIndex(Width w) {
+    switch (w) {
+    case Bool:  return 0;
+    case Int8:  return 1;
+    case Int16: return 2;
+    case Int32: return 3;
+    case Int64: return 4;
+    default:    return -1;
+    }
+  }
+
+  static ref<ConstantExpr> allocUnshared(const llvm::APInt &v) {
+    ref<ConstantExpr> r(new ConstantExpr(v));
+    r->computeHash();
+    return r;
+  }
+
 public:
   ~ConstantExpr() {}
 
@@ -1065,9 +1096,13 @@ public:
   void toMemory(void *address);
 
   static ref<ConstantExpr> alloc(const llvm::APInt &v) {
-    ref<ConstantExpr> r(new ConstantExpr(v));
-    r->computeHash();
-    return r;
+    if (v.getBitWidth() <= 64 && v.getZExtValue() < numSmallValues) {
+      int index = getSmallValuesIndex(v.getBitWidth());
+      // Null only while static initializers of other files run first
+      if (index >= 0 && smallValues[index][v.getZExtValue()])
+        return smallValues[index][v.getZExtValue()];
+    }
+    return allocUnshared(v);
   }
 
   static ref<ConstantExpr> alloc(const llvm::APFloat &f) {
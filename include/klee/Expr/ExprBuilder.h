@@ -86,6 +86,13 @@ namespace klee {
   ///
   /// Base - The base builder to use when constructing expressions.
   ExprBuilder *createSimplifyingExprBuilder(ExprBuilder *Base);
+
+  /// createHashConsingExprBuilder - Create an expression builder which
+  /// returns a single shared node for all structurally equal expressions it
+  /// builds. The nodes stay alive as long as the builder does.
+  ///
+  /// Base - The base builder to use when constructing expressions.
+  ExprBuilder *createHashConsingExprBuilder(ExprBuilder *Base);
 }
 
 #endif /* KLEE_EXPRBUILDER_H */
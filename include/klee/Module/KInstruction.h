@@ -10,6 +10,7 @@
 #ifndef KLEE_KINSTRUCTION_H
 #define KLEE_KINSTRUCTION_H
 
+#include "klee/ADT/Ref.h"
 #include "klee/Config/Version.h"
 #include "klee/Module/InstructionInfoTable.h"
 
@@ -23,6 +24,7 @@ namespace llvm {
 }
 
 namespace klee {
+  class ConstantExpr;
   class Executor;
   struct InstructionInfo;
   class KModule;
@@ -42,6 +44,11 @@ namespace klee {
     /// Destination register index.
     unsigned dest;
 
+    /// For binary operators and integer comparisons, the operation on two
+    /// constant operands, so that the executor can compute the result
+    /// without going through the expression builder. Null otherwise.
+    ref<ConstantExpr> (ConstantExpr::*constantOp)(const ref<ConstantExpr> &);
+
   public:
     virtual ~KInstruction();
     std::string getSourceLocation() const;
@@ -14,11 +14,15 @@
 #include "klee/System/Time.h"
 #include "klee/Solver/SolverCmdLine.h"
 
+#include <functional>
+#include <memory>
 #include <vector>
 
 namespace klee {
+  class Assignment;
   class ConstraintSet;
   class Expr;
+  class SharedQueryCache;
   class SolverImpl;
 
   /// Collection of meta data that a solver can have access to. This is
@@ -27,6 +31,14 @@ namespace klee {
   struct SolverQueryMetaData {
     /// @brief Costs for all queries issued for this state
     time::Span queryCost;
+
+    /// @brief Recent models of the state's constraints, most recent first.
+    /// Queries are checked against these before the solver is called.
+    std::vector<std::shared_ptr<const Assignment>> models;
+
+    /// @brief The constraints all of the models are known to satisfy, so
+    /// that only constraints added since have to be checked.
+    std::vector<ref<Expr>> modelConstraints;
   };
 
   struct Query {
@@ -235,6 +247,39 @@ namespace klee {
   /// \param s - The underlying solver to use.
   Solver *createCachingSolver(Solver *s);
 
+  /// createPersistentCachingSolver - Create a solver which caches query
+  /// validity results in a memory-mapped file below \a directory, so that
+  /// they can be reused by later runs and by concurrent KLEE processes.
+  ///
+  /// \param s - The underlying solver to use.
+  /// \param directory - The directory holding the cache file.
+  Solver *createPersistentCachingSolver(Solver *s,
+                                        const std::string &directory);
+
+  /// createSharedCachingSolver - Create a solver which caches query validity
+  /// results in \a cache. The cache is keyed by structural hashes and holds
+  /// no expressions, so solver chains running on different threads may
+  /// share it.
+  ///
+  /// \param s - The underlying solver to use.
+  /// \param cache - The cache to use, owned by the caller.
+  Solver *createSharedCachingSolver(Solver *s, SharedQueryCache &cache);
+
+  /// Builds the private solver chain of one thread. The chain should contain
+  /// a solver created with createSharedCachingSolver() for the given cache.
+  typedef std::function<Solver *(SharedQueryCache &)>
+      ThreadSafeSolverChainConstructor;
+
+  /// createThreadSafeSolver - Create a solver which can be used by several
+  /// threads at once. Each thread gets its own solver chain, including its
+  /// own core solver, which is built by \a constructChain when the thread
+  /// issues its first query. The chains share one SharedQueryCache. Core
+  /// solvers must not run in forked mode, as the forking solvers keep their
+  /// shared memory in global state.
+  ///
+  /// \param constructChain - Builds the chain for a thread.
+  Solver *createThreadSafeSolver(ThreadSafeSolverChainConstructor constructChain);
+
   /// createCexCachingSolver - Create a counterexample caching solver. This is a
   /// more sophisticated cache which records counterexamples for a constraint
   /// set and uses subset/superset relations among constraints to try and
@@ -28,8 +28,16 @@ extern llvm::cl::opt<bool> UseCexCache;
 
 extern llvm::cl::opt<bool> UseBranchCache;
 
+extern llvm::cl::opt<bool> BranchCacheSubsumption;
+
+extern llvm::cl::opt<std::string> QueryCacheDir;
+
 extern llvm::cl::opt<bool> UseIndependentSolver;
 
+extern llvm::cl::opt<unsigned> IndependentSolverJobs;
+
+extern llvm::cl::opt<unsigned> IndependentSolverParallelMinConstraints;
+
 extern llvm::cl::opt<bool> DebugValidateSolver;
 
 extern llvm::cl::opt<std::string> MinQueryTimeToLog;
@@ -40,6 +48,8 @@ extern llvm::cl::opt<std::string> MaxCoreSolverTime;
 
 extern llvm::cl::opt<bool> UseForkedCoreSolver;
 
+extern llvm::cl::opt<bool> SolverIncremental;
+
 extern llvm::cl::opt<bool> CoreSolverOptimizeDivides;
 
 extern llvm::cl::opt<bool> UseAssignmentValidatingSolver;
@@ -59,11 +69,14 @@ enum CoreSolverType {
   METASMT_SOLVER,
   DUMMY_SOLVER,
   Z3_SOLVER,
+  PORTFOLIO_SOLVER,
   NO_SOLVER
 };
 
 extern llvm::cl::opt<CoreSolverType> CoreSolverToUse;
 
+extern llvm::cl::list<CoreSolverType> PortfolioSolvers;
+
 extern llvm::cl::opt<CoreSolverType> DebugCrossCheckCoreSolverWith;
 
 #ifdef ENABLE_METASMT
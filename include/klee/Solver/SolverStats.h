@@ -21,11 +21,22 @@ namespace stats {
   extern Statistic queriesValid;
   extern Statistic queryCacheHits;
   extern Statistic queryCacheMisses;
+  extern Statistic queryCacheExactHits;
+  extern Statistic queryCacheSubsumptionHits;
   extern Statistic queryCexCacheHits;
   extern Statistic queryCexCacheMisses;
+  extern Statistic queryPersistentCacheHits;
+  extern Statistic queryPersistentCacheMisses;
+  extern Statistic querySharedCacheHits;
+  extern Statistic querySharedCacheMisses;
   extern Statistic queryConstructs;
   extern Statistic queryCounterexamples;
   extern Statistic queryTime;
+  extern Statistic portfolioWinsSTP;
+  extern Statistic portfolioWinsMetaSMT;
+  extern Statistic portfolioWinsZ3;
+  extern Statistic solverIncrementalHits;
+  extern Statistic solverIncrementalMisses;
   
 #ifdef KLEE_ARRAY_DEBUG
   extern Statistic arrayHashTime;
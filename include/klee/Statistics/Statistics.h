@@ -40,18 +40,59 @@ namespace klee {
   class StatisticManager {
   private:
     bool enabled;
+    bool threadSafe;
+    bool shared;
     std::vector<Statistic*> stats;
     uint64_t *globalStats;
     uint64_t *indexedStats;
+    unsigned totalIndices;
     StatisticRecord *contextStats;
     unsigned index;
 
+    /// Updates of shared statistics that are not yet in the shared memory,
+    /// laid out like it: the global statistics followed by the indexed
+    /// ones. Updating the shared memory right away makes the processes
+    /// contend for its cache lines on every instruction.
+    uint64_t *pendingStats;
+    /// The indices with pending updates.
+    std::vector<bool> pendingIndices;
+    std::vector<unsigned> dirtyIndices;
+    unsigned numPendingUpdates;
+
+    /// Number of updates after which the pending ones are flushed.
+    static const unsigned maxPendingUpdates = 4096;
+
+    void addPendingIndexed(const Statistic &s, unsigned index,
+                           uint64_t addend);
+
   public:
     StatisticManager();
     ~StatisticManager();
 
     void useIndexedStats(unsigned totalIndices);
 
+    /// setThreadSafe - Make statistic updates atomic, so that statistics
+    /// can be incremented from several threads at once.
+    void setThreadSafe(bool value) {
+      // Pending updates are only made by a single thread
+      if (value)
+        flushStatistics();
+      threadSafe = value;
+    }
+
+    /// shareBetweenProcesses - Move the global and indexed statistics into
+    /// memory that is shared with processes forked afterwards, so that all
+    /// of them update the same statistics. Each process collects its
+    /// updates and adds them to the shared memory in batches.
+    ///
+    /// \return True if the statistics are shared.
+    bool shareBetweenProcesses();
+    bool isShared() const { return shared; }
+
+    /// flushStatistics - Add the pending updates of this process to the
+    /// shared statistics. Needed before the process forks or exits.
+    void flushStatistics();
+
     StatisticRecord *getContext();
     void setContext(StatisticRecord *sr); /* null to reset */
 
@@ -62,9 +103,15 @@ namespace klee {
     
     void registerStatistic(Statistic &s);
     void incrementStatistic(Statistic &s, uint64_t addend);
+    /// claimStatistic - Increment \a s by one, but only if its value at the
+    /// current index is zero. Of several concurrent claims only one
+    /// succeeds.
+    ///
+    /// \return True if the statistic was incremented.
+    bool claimStatistic(Statistic &s);
     uint64_t getValue(const Statistic &s) const;
     void incrementIndexedValue(const Statistic &s, unsigned index, 
-                               uint64_t addend) const;
+                               uint64_t addend);
     uint64_t getIndexedValue(const Statistic &s, unsigned index) const;
     void setIndexedValue(const Statistic &s, unsigned index, uint64_t value);
     int getStatisticID(const std::string &name) const;
@@ -75,14 +122,66 @@ namespace klee {
 
   inline void StatisticManager::incrementStatistic(Statistic &s, 
                                                    uint64_t addend) {
-    if (enabled) {
-      globalStats[s.id] += addend;
+    if (!enabled)
+      return;
+    if (threadSafe) {
+      __atomic_fetch_add(&globalStats[s.id], addend, __ATOMIC_RELAXED);
+      if (indexedStats) {
+        __atomic_fetch_add(&indexedStats[index*stats.size() + s.id], addend,
+                           __ATOMIC_RELAXED);
+        if (contextStats)
+          __atomic_fetch_add(&contextStats->data[s.id], addend,
+                             __ATOMIC_RELAXED);
+      }
+      return;
+    }
+    if (shared) {
+      pendingStats[s.id] += addend;
       if (indexedStats) {
-        indexedStats[index*stats.size() + s.id] += addend;
+        addPendingIndexed(s, index, addend);
         if (contextStats)
           contextStats->data[s.id] += addend;
       }
+      if (++numPendingUpdates >= maxPendingUpdates)
+        flushStatistics();
+      return;
+    }
+    globalStats[s.id] += addend;
+    if (indexedStats) {
+      indexedStats[index*stats.size() + s.id] += addend;
+      if (contextStats)
+        contextStats->data[s.id] += addend;
+    }
+  }
+
+  inline void StatisticManager::addPendingIndexed(const Statistic &s,
+                                                  unsigned index,
+                                                  uint64_t addend) {
+    if (!pendingIndices[index]) {
+      pendingIndices[index] = true;
+      dirtyIndices.push_back(index);
     }
+    pendingStats[(1 + index)*stats.size() + s.id] += addend;
+  }
+
+  inline bool StatisticManager::claimStatistic(Statistic &s) {
+    if (!enabled)
+      return false;
+    uint64_t *value = &indexedStats[index*stats.size() + s.id];
+    if (threadSafe || shared) {
+      uint64_t expected = 0;
+      if (!__atomic_compare_exchange_n(value, &expected, 1, false,
+                                       __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        return false;
+      __atomic_fetch_add(&globalStats[s.id], 1, __ATOMIC_RELAXED);
+      if (contextStats)
+        __atomic_fetch_add(&contextStats->data[s.id], 1, __ATOMIC_RELAXED);
+      return true;
+    }
+    if (*value)
+      return false;
+    incrementStatistic(s, 1);
+    return true;
   }
 
   inline StatisticRecord *StatisticManager::getContext() {
@@ -130,23 +229,42 @@ namespace klee {
   }
 
   inline uint64_t StatisticManager::getValue(const Statistic &s) const {
-    return globalStats[s.id];
+    uint64_t value = __atomic_load_n(&globalStats[s.id], __ATOMIC_RELAXED);
+    if (shared)
+      value += pendingStats[s.id];
+    return value;
   }
 
   inline void StatisticManager::incrementIndexedValue(const Statistic &s, 
                                                       unsigned index,
-                                                      uint64_t addend) const {
+                                                      uint64_t addend) {
+    if (threadSafe) {
+      __atomic_fetch_add(&indexedStats[index*stats.size() + s.id], addend,
+                         __ATOMIC_RELAXED);
+      return;
+    }
+    if (shared) {
+      addPendingIndexed(s, index, addend);
+      if (++numPendingUpdates >= maxPendingUpdates)
+        flushStatistics();
+      return;
+    }
     indexedStats[index*stats.size() + s.id] += addend;
   }
 
   inline uint64_t StatisticManager::getIndexedValue(const Statistic &s, 
                                                     unsigned index) const {
-    return indexedStats[index*stats.size() + s.id];
+    uint64_t value = indexedStats[index*stats.size() + s.id];
+    if (shared)
+      value += pendingStats[(1 + index)*stats.size() + s.id];
+    return value;
   }
 
   inline void StatisticManager::setIndexedValue(const Statistic &s, 
                                                 unsigned index,
                                                 uint64_t value) {
+    if (shared)
+      pendingStats[(1 + index)*stats.size() + s.id] = 0;
     indexedStats[index*stats.size() + s.id] = value;
   }
 }
@@ -9,30 +9,105 @@
 
 #include "klee/Statistics/Statistics.h"
 
+#include <cassert>
 #include <vector>
 
+#include <sys/mman.h>
+
 using namespace klee;
 
 StatisticManager::StatisticManager()
   : enabled(true),
+    threadSafe(false),
+    shared(false),
     globalStats(0),
     indexedStats(0),
+    totalIndices(0),
     contextStats(0),
-    index(0) {
+    index(0),
+    pendingStats(0),
+    numPendingUpdates(0) {
 }
 
 StatisticManager::~StatisticManager() {
+  if (shared) {
+    munmap(globalStats,
+           sizeof(*globalStats) * (1 + totalIndices) * stats.size());
+    delete[] pendingStats;
+    return;
+  }
   delete[] globalStats;
   delete[] indexedStats;
 }
 
 void StatisticManager::useIndexedStats(unsigned totalIndices) {  
+  assert(!shared && "statistics are already shared");
   delete[] indexedStats;
+  this->totalIndices = totalIndices;
   indexedStats = new uint64_t[totalIndices * stats.size()];
   memset(indexedStats, 0, sizeof(*indexedStats) * totalIndices * stats.size());
 }
 
+bool StatisticManager::shareBetweenProcesses() {
+  if (shared)
+    return true;
+
+  // The global statistics come first, followed by the indexed ones.
+  size_t globalSize = sizeof(*globalStats) * stats.size();
+  size_t indexedSize = indexedStats ? globalSize * totalIndices : 0;
+  void *mapping = mmap(nullptr, globalSize + indexedSize,
+                       PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1,
+                       0);
+  if (mapping == MAP_FAILED)
+    return false;
+
+  uint64_t *sharedStats = static_cast<uint64_t *>(mapping);
+  memcpy(sharedStats, globalStats, globalSize);
+  delete[] globalStats;
+  globalStats = sharedStats;
+  if (indexedStats) {
+    memcpy(sharedStats + stats.size(), indexedStats, indexedSize);
+    delete[] indexedStats;
+    indexedStats = sharedStats + stats.size();
+  } else {
+    totalIndices = 0;
+  }
+
+  pendingStats = new uint64_t[(1 + totalIndices) * stats.size()];
+  memset(pendingStats, 0,
+         sizeof(*pendingStats) * (1 + totalIndices) * stats.size());
+  pendingIndices.assign(totalIndices, false);
+
+  shared = true;
+  return true;
+}
+
+void StatisticManager::flushStatistics() {
+  if (!shared || !numPendingUpdates)
+    return;
+
+  auto flush = [](uint64_t *from, uint64_t *to, unsigned count) {
+    for (unsigned i = 0; i < count; ++i) {
+      if (from[i]) {
+        __atomic_fetch_add(&to[i], from[i], __ATOMIC_RELAXED);
+        from[i] = 0;
+      }
+    }
+  };
+
+  unsigned numStats = stats.size();
+  flush(pendingStats, globalStats, numStats);
+  for (unsigned index : dirtyIndices) {
+    flush(pendingStats + (1 + index) * numStats,
+          indexedStats + index * numStats, numStats);
+    pendingIndices[index] = false;
+  }
+  dirtyIndices.clear();
+  numPendingUpdates = 0;
+}
+
 void StatisticManager::registerStatistic(Statistic &s) {
+  assert(!shared && "statistics are already shared");
   delete[] globalStats;
   s.id = stats.size();
   stats.push_back(&s);
@@ -11,6 +11,7 @@
 
 #include "ExecutionState.h"
 #include "Memory.h"
+#include "PointerRangeEvaluator.h"
 #include "TimingSolver.h"
 
 #include "klee/Expr/Expr.h"
@@ -18,8 +19,34 @@
 
 #include "CoreStats.h"
 
+#include <algorithm>
+#include <utility>
+
 using namespace klee;
 
+namespace {
+
+/// Number of candidate objects up to which every candidate is checked,
+/// rather than narrowing them down by binary search first.
+const unsigned NarrowingThreshold = 8;
+
+/// Order objects by their distance from \a address: the objects below it
+/// in descending order, then the ones above it in ascending order.
+void orderAroundAddress(std::vector<ObjectPair> &objects, uint64_t address) {
+  auto split = std::partition_point(
+      objects.begin(), objects.end(),
+      [address](const ObjectPair &op) { return op.first->address <= address; });
+  std::reverse(objects.begin(), split);
+}
+
+/// The number of bytes a pointer into the object may be above its base.
+uint64_t getExtent(const MemoryObject *mo) {
+  // A zero-sized object can still be pointed to by its address.
+  return std::max<uint64_t>(mo->size, 1);
+}
+
+} // namespace
+
 ///
 
 void AddressSpace::bindObject(const MemoryObject *mo, ObjectState *os) {
@@ -45,6 +72,17 @@ ObjectState *AddressSpace::getWriteable(const MemoryObject *mo,
   if (cowKey == os->copyOnWriteOwner)
     return const_cast<ObjectState*>(os);
 
+  // Initialize a lazily initialized object before copying it, so that all
+  // copies share its contents.
+  os->initialize();
+
+  // Attribute the copy to the fork that made the object shared.
+  StatisticManager &sm = *theStatisticManager;
+  unsigned index = sm.getIndex();
+  sm.setIndex(forkIndex);
+  stats::forkCopyBytes += os->size;
+  sm.setIndex(index);
+
   // Add a copy of this object state that can be updated
   ref<ObjectState> newObjectState(new ObjectState(*os));
   newObjectState->copyOnWriteOwner = cowKey;
@@ -104,62 +142,24 @@ bool AddressSpace::resolveOne(ExecutionState &state,
       }
     }
 
-    // didn't work, now we have to search
-       
-    MemoryMap::iterator oi = objects.upper_bound(&hack);
-    MemoryMap::iterator begin = objects.begin();
-    MemoryMap::iterator end = objects.end();
-      
-    MemoryMap::iterator start = oi;
-    while (oi!=begin) {
-      --oi;
-      const auto &mo = oi->first;
+    // didn't work, now we have to search, starting with the objects next
+    // to the example
+
+    std::vector<ObjectPair> candidates;
+    if (!getCandidates(state, solver, address, nullptr, candidates))
+      return false;
+    orderAroundAddress(candidates, example);
 
+    for (const auto &op : candidates) {
       bool mayBeTrue;
       if (!solver->mayBeTrue(state.constraints,
-                             mo->getBoundsCheckPointer(address), mayBeTrue,
-                             state.queryMetaData))
+                             op.first->getBoundsCheckPointer(address),
+                             mayBeTrue, state.queryMetaData))
         return false;
       if (mayBeTrue) {
-        result.first = oi->first;
-        result.second = oi->second.get();
+        result = op;
         success = true;
         return true;
-      } else {
-        bool mustBeTrue;
-        if (!solver->mustBeTrue(state.constraints,
-                                UgeExpr::create(address, mo->getBaseExpr()),
-                                mustBeTrue, state.queryMetaData))
-          return false;
-        if (mustBeTrue)
-          break;
-      }
-    }
-
-    // search forwards
-    for (oi=start; oi!=end; ++oi) {
-      const auto &mo = oi->first;
-
-      bool mustBeTrue;
-      if (!solver->mustBeTrue(state.constraints,
-                              UltExpr::create(address, mo->getBaseExpr()),
-                              mustBeTrue, state.queryMetaData))
-        return false;
-      if (mustBeTrue) {
-        break;
-      } else {
-        bool mayBeTrue;
-
-        if (!solver->mayBeTrue(state.constraints,
-                               mo->getBoundsCheckPointer(address), mayBeTrue,
-                               state.queryMetaData))
-          return false;
-        if (mayBeTrue) {
-          result.first = oi->first;
-          result.second = oi->second.get();
-          success = true;
-          return true;
-        }
       }
     }
 
@@ -204,6 +204,83 @@ int AddressSpace::checkPointerInObject(ExecutionState &state,
   return 2;
 }
 
+void AddressSpace::getObjectsInRange(uint64_t min, uint64_t max,
+                                     std::vector<ObjectPair> &result) const {
+  MemoryObject hack(min);
+  MemoryMap::iterator oi = objects.upper_bound(&hack);
+  MemoryMap::iterator begin = objects.begin();
+  MemoryMap::iterator end = objects.end();
+
+  // The object before the first one starting above min may reach into the
+  // range.
+  if (oi != begin) {
+    MemoryMap::iterator prev = oi;
+    --prev;
+    if (min - prev->first->address < getExtent(prev->first))
+      oi = prev;
+  }
+
+  for (; oi != end && oi->first->address <= max; ++oi)
+    result.push_back(std::make_pair(oi->first, oi->second.get()));
+}
+
+bool AddressSpace::getCandidates(ExecutionState &state, TimingSolver *solver,
+                                 ref<Expr> p, const MemoryObject *except,
+                                 std::vector<ObjectPair> &candidates) const {
+  PointerRange range = PointerRangeEvaluator().evaluate(p);
+  getObjectsInRange(range.first, range.second, candidates);
+  if (except)
+    candidates.erase(std::remove_if(candidates.begin(), candidates.end(),
+                                    [except](const ObjectPair &op) {
+                                      return op.first == except;
+                                    }),
+                     candidates.end());
+
+  if (candidates.size() <= NarrowingThreshold)
+    return true;
+
+  // Objects do not overlap, so "p is above object i" holds for a prefix of
+  // the candidates and "p is below object i" for a suffix.
+  unsigned low = 0, high = candidates.size();
+  while (low < high) {
+    unsigned mid = low + (high - low) / 2;
+    const MemoryObject *mo = candidates[mid].first;
+    bool above;
+    if (!solver->mustBeTrue(
+            state.constraints,
+            UgeExpr::create(p, ConstantExpr::create(mo->address + getExtent(mo),
+                                                    p->getWidth())),
+            above, state.queryMetaData))
+      return false;
+    if (above)
+      low = mid + 1;
+    else
+      high = mid;
+  }
+  unsigned first = low;
+
+  high = candidates.size();
+  while (low < high) {
+    unsigned mid = low + (high - low) / 2;
+    const MemoryObject *mo = candidates[mid].first;
+    bool below;
+    if (!solver->mustBeTrue(
+            state.constraints,
+            UltExpr::create(p, ConstantExpr::create(mo->address,
+                                                    p->getWidth())),
+            below, state.queryMetaData))
+      return false;
+    if (below)
+      high = mid;
+    else
+      low = mid + 1;
+  }
+
+  candidates.erase(candidates.begin() + low, candidates.end());
+  candidates.erase(candidates.begin(), candidates.begin() + first);
+  return true;
+}
+
 bool AddressSpace::resolve(ExecutionState &state, TimingSolver *solver,
                            ref<Expr> p, ResolutionList &rl,
                            unsigned maxResolutions, time::Span timeout) const {
@@ -221,65 +298,32 @@ bool AddressSpace::resolve(ExecutionState &state, TimingSolver *solver,
     // not the first, find a cex assuming not the second...
     // etc.
 
-    // XXX how do we smartly amortize the cost of checking to
-    // see if we need to keep searching up/down, in bad cases?
-    // maybe we don't care?
-
-    // XXX we really just need a smart place to start (although
-    // if its a known solution then the code below is guaranteed
-    // to hit the fast path with exactly 2 queries). we could also
-    // just get this by inspection of the expr.
-
     ref<ConstantExpr> cex;
     if (!solver->getValue(state.constraints, p, cex, state.queryMetaData))
       return true;
     uint64_t example = cex->getZExtValue();
     MemoryObject hack(example);
 
-    MemoryMap::iterator oi = objects.upper_bound(&hack);
-    MemoryMap::iterator begin = objects.begin();
-    MemoryMap::iterator end = objects.end();
-
-    MemoryMap::iterator start = oi;
-    // search backwards, start with one minus because this
-    // is the object that p *should* be within, which means we
-    // get write off the end with 4 queries
-    while (oi != begin) {
-      --oi;
-      const MemoryObject *mo = oi->first;
-      if (timeout && timeout < timer.delta())
-        return true;
-
-      auto op = std::make_pair<>(mo, oi->second.get());
-
-      int incomplete =
-          checkPointerInObject(state, solver, p, op, rl, maxResolutions);
+    // Start with the object that p *should* be within, if the pointer is
+    // in bounds this needs only 2 queries.
+    const MemoryObject *first = nullptr;
+    if (const auto res = objects.lookup_previous(&hack)) {
+      first = res->first;
+      int incomplete = checkPointerInObject(
+          state, solver, p, std::make_pair(first, res->second.get()), rl,
+          maxResolutions);
       if (incomplete != 2)
         return incomplete ? true : false;
-
-      bool mustBeTrue;
-      if (!solver->mustBeTrue(state.constraints,
-                              UgeExpr::create(p, mo->getBaseExpr()), mustBeTrue,
-                              state.queryMetaData))
-        return true;
-      if (mustBeTrue)
-        break;
     }
 
-    // search forwards
-    for (oi = start; oi != end; ++oi) {
-      const MemoryObject *mo = oi->first;
-      if (timeout && timeout < timer.delta())
-        return true;
+    std::vector<ObjectPair> candidates;
+    if (!getCandidates(state, solver, p, first, candidates))
+      return true;
+    orderAroundAddress(candidates, example);
 
-      bool mustBeTrue;
-      if (!solver->mustBeTrue(state.constraints,
-                              UltExpr::create(p, mo->getBaseExpr()), mustBeTrue,
-                              state.queryMetaData))
+    for (const auto &op : candidates) {
+      if (timeout && timeout < timer.delta())
         return true;
-      if (mustBeTrue)
-        break;
-      auto op = std::make_pair<>(mo, oi->second.get());
 
       int incomplete =
           checkPointerInObject(state, solver, p, op, rl, maxResolutions);
@@ -297,6 +341,13 @@ bool AddressSpace::resolve(ExecutionState &state, TimingSolver *solver,
 // transparently avoid screwing up symbolics (if the byte is symbolic
 // then its concrete cache byte isn't being used) but is just a hack.
 
+bool AddressSpace::isFullyConcrete() const {
+  for (const auto &obj : objects)
+    if (!obj.second->isFullyConcrete())
+      return false;
+  return true;
+}
+
 void AddressSpace::copyOutConcretes() {
   for (MemoryMap::iterator it = objects.begin(), ie = objects.end(); 
        it != ie; ++it) {
@@ -306,8 +357,9 @@ void AddressSpace::copyOutConcretes() {
       const auto &os = it->second;
       auto address = reinterpret_cast<std::uint8_t*>(mo->address);
 
-      if (!os->readOnly)
-        memcpy(address, os->concreteStore, mo->size);
+      // Read-only objects are copied out when they are initialized.
+      if (!os->readOnly || os->isLazy())
+        os->copyOutConcreteStore(address);
     }
   }
 }
@@ -330,12 +382,12 @@ bool AddressSpace::copyInConcretes() {
 bool AddressSpace::copyInConcrete(const MemoryObject *mo, const ObjectState *os,
                                   uint64_t src_address) {
   auto address = reinterpret_cast<std::uint8_t*>(src_address);
-  if (memcmp(address, os->concreteStore, mo->size) != 0) {
+  if (!os->equalsConcreteStore(address)) {
     if (os->readOnly) {
       return false;
     } else {
       ObjectState *wos = getWriteable(mo, os);
-      memcpy(wos->concreteStore, address, mo->size);
+      wos->copyInConcreteStore(address);
     }
   }
   return true;
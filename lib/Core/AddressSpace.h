@@ -54,6 +54,22 @@ namespace klee {
                              ref<Expr> p, const ObjectPair &op,
                              ResolutionList &rl, unsigned maxResolutions) const;
 
+    /// Collect the objects that overlap the address range [min, max], in
+    /// address order. No queries are issued.
+    void getObjectsInRange(uint64_t min, uint64_t max,
+                           std::vector<ObjectPair> &result) const;
+
+    /// Collect the objects pointer `p` may point into, in address order.
+    /// The objects are first limited to a conservative range of the values
+    /// of `p`, and if many remain, the ones at either end that `p` cannot
+    /// point into are dropped by binary search.
+    ///
+    /// \param except An object that is not included in the result.
+    /// \return false iff a query failed.
+    bool getCandidates(ExecutionState &state, TimingSolver *solver,
+                       ref<Expr> p, const MemoryObject *except,
+                       std::vector<ObjectPair> &candidates) const;
+
   public:
     /// The MemoryObject -> ObjectState map that constitutes the
     /// address space.
@@ -64,8 +80,14 @@ namespace klee {
     /// \invariant forall o in objects, o->copyOnWriteOwner <= cowKey
     MemoryMap objects;
 
-    AddressSpace() : cowKey(1) {}
-    AddressSpace(const AddressSpace &b) : cowKey(++b.cowKey), objects(b.objects) { }
+    /// The instruction level statistics index of the instruction at which
+    /// the state last forked. Copies made by getWriteable are attributed to
+    /// it.
+    unsigned forkIndex;
+
+    AddressSpace() : cowKey(1), forkIndex(0) {}
+    AddressSpace(const AddressSpace &b)
+        : cowKey(++b.cowKey), objects(b.objects), forkIndex(b.forkIndex) {}
     ~AddressSpace() {}
 
     /// Resolve address to an ObjectPair in result.
@@ -124,6 +146,10 @@ namespace klee {
     /// \return A writeable ObjectState (\a os or a copy).
     ObjectState *getWriteable(const MemoryObject *mo, const ObjectState *os);
 
+    /// Check whether all bytes of all managed ObjectStates are concrete,
+    /// so that copying them out loses nothing.
+    bool isFullyConcrete() const;
+
     /// Copy the concrete values of all managed ObjectStates into the
     /// actual system memory location they were allocated at.
     void copyOutConcretes();
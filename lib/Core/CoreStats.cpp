@@ -14,6 +14,9 @@ using namespace klee;
 Statistic stats::allocations("Allocations", "Alloc");
 Statistic stats::coveredInstructions("CoveredInstructions", "Icov");
 Statistic stats::falseBranches("FalseBranches", "Bf");
+Statistic stats::forkCopyBytes("ForkCopyBytes", "FCbytes");
+Statistic stats::forkCopyTime("ForkCopyTime", "FCtime");
+Statistic stats::forkQueryTime("ForkQueryTime", "FQtime");
 Statistic stats::forkTime("ForkTime", "Ftime");
 Statistic stats::forks("Forks", "Forks");
 Statistic stats::instructionRealTime("InstructionRealTimes", "Ireal");
@@ -21,9 +24,21 @@ Statistic stats::instructionTime("InstructionTimes", "Itime");
 Statistic stats::instructions("Instructions", "I");
 Statistic stats::minDistToReturn("MinDistToReturn", "Rdist");
 Statistic stats::minDistToUncovered("MinDistToUncovered", "UCdist");
+Statistic stats::modelReuseHits("ModelReuseHits", "MRhits");
+Statistic stats::modelReuseMisses("ModelReuseMisses", "MRmisses");
+Statistic stats::nativeCalls("NativeCalls", "NCalls");
+Statistic stats::nativeCallsFailed("NativeCallsFailed", "NCfailed");
+Statistic stats::objectStatePageCopies("ObjectStatePageCopies", "OSPcopies");
+Statistic stats::objectStatePagesShared("ObjectStatePagesShared",
+                                        "OSPshared");
 Statistic stats::reachableUncovered("ReachableUncovered", "IuncovReach");
 Statistic stats::resolveTime("ResolveTime", "Rtime");
+Statistic stats::snapshotCompactions("SnapshotCompactions", "SScompact");
 Statistic stats::solverTime("SolverTime", "Stime");
+Statistic stats::solverTimeoutRetries("SolverTimeoutRetries", "STretries");
 Statistic stats::states("States", "States");
+Statistic stats::statesSwappedIn("StatesSwappedIn", "SwapIn");
+Statistic stats::statesSwappedOut("StatesSwappedOut", "SwapOut");
 Statistic stats::trueBranches("TrueBranches", "Bt");
 Statistic stats::uncoveredInstructions("UncoveredInstructions", "Iuncov");
+Statistic stats::updateNodesCompacted("UpdateNodesCompacted", "ULcompacted");
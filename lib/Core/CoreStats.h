@@ -27,9 +27,44 @@ namespace stats {
   extern Statistic forkTime;
   extern Statistic solverTime;
 
+  /// The number of branch queries that were cut off by the adaptive solver
+  /// timeout and rescheduled.
+  extern Statistic solverTimeoutRetries;
+
+  /// The number of queries answered (or not) by the recent models of the
+  /// querying state.
+  extern Statistic modelReuseHits;
+  extern Statistic modelReuseMisses;
+
+  /// The number of object state pages shared by copying object states, and
+  /// the number of them that were copied later on because of a write.
+  extern Statistic objectStatePagesShared;
+  extern Statistic objectStatePageCopies;
+
+  /// The number of update nodes removed from update lists by compaction.
+  extern Statistic updateNodesCompacted;
+
+  /// The number of calls executed natively, and the number of them that
+  /// did not complete and were interpreted instead.
+  extern Statistic nativeCalls;
+  extern Statistic nativeCallsFailed;
+
+  /// The number of states written to and restored from the state snapshot
+  /// file, and the number of times the file was compacted.
+  extern Statistic statesSwappedIn;
+  extern Statistic statesSwappedOut;
+  extern Statistic snapshotCompactions;
+
   /// The number of process forks.
   extern Statistic forks;
 
+  /// The cost of forks, attributed to the forking instruction: the time
+  /// spent copying states and on the branch query, and the bytes of object
+  /// states the forked states copied on write later on.
+  extern Statistic forkCopyBytes;
+  extern Statistic forkCopyTime;
+  extern Statistic forkQueryTime;
+
   /// Number of states, this is a "fake" statistic used by istats, it
   /// isn't normally up-to-date.
   extern Statistic states;
@@ -16,6 +16,7 @@
 #include "klee/Module/InstructionInfoTable.h"
 #include "klee/Module/KInstruction.h"
 #include "klee/Module/KModule.h"
+#include "klee/Statistics/Statistics.h"
 #include "klee/Support/OptionCategories.h"
 
 #include "llvm/IR/Function.h"
@@ -108,12 +109,18 @@ ExecutionState::ExecutionState(const ExecutionState& state):
     instsSinceCovNew(state.instsSinceCovNew),
     coveredNew(state.coveredNew),
     forkDisabled(state.forkDisabled) {
+  // Query costs are accounted per state, but the models of the constraints
+  // remain valid for the copy.
+  queryMetaData.models = state.queryMetaData.models;
+  queryMetaData.modelConstraints = state.queryMetaData.modelConstraints;
+
   for (const auto &cur_mergehandler: openMergeStack)
     cur_mergehandler->addOpenState(this);
 }
 
 ExecutionState *ExecutionState::branch() {
   depth++;
+  addressSpace.forkIndex = theStatisticManager->getIndex();
 
   auto *falseState = new ExecutionState(*this);
   falseState->setID();
@@ -153,6 +153,10 @@ public:
   /// @brief Disables forking for this state. Set by user code
   bool forkDisabled;
 
+  /// @brief Number of times the query of the current branch was cut off by
+  /// the adaptive solver timeout
+  std::uint32_t solverTimeoutRetries = 0;
+
 public:
   #ifdef KLEE_UNITTEST
   // provide this function only in the context of unittests
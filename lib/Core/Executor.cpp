@@ -17,10 +17,13 @@
 #include "ImpliedValue.h"
 #include "Memory.h"
 #include "MemoryManager.h"
+#include "NativeDispatcher.h"
 #include "PTree.h"
+#include "ParallelExploration.h"
 #include "Searcher.h"
 #include "SeedInfo.h"
 #include "SpecialFunctionHandler.h"
+#include "StateSnapshot.h"
 #include "StatsTracker.h"
 #include "TimingSolver.h"
 #include "UserSearcher.h"
@@ -45,6 +48,7 @@
 #include "klee/Module/KModule.h"
 #include "klee/Solver/SolverCmdLine.h"
 #include "klee/Solver/SolverStats.h"
+#include "klee/Statistics/Statistics.h"
 #include "klee/Support/ErrorHandling.h"
 #include "klee/Support/FileHandling.h"
 #include "klee/Support/FloatEvaluation.h"
@@ -86,6 +90,7 @@ typedef unsigned TypeSize;
 #include <sstream>
 #include <string>
 #include <sys/mman.h>
+#include <unistd.h>
 #include <vector>
 
 using namespace llvm;
@@ -164,6 +169,21 @@ cl::opt<bool>
                                   "querying the solver (default=true)"),
                          cl::cat(SolvingCat));
 
+cl::opt<bool> WriteQueryTimeHistogram(
+    "write-query-time-histogram", cl::init(false),
+    cl::desc("Write a histogram of solver query times to query-times.txt "
+             "(default=false)"),
+    cl::cat(SolvingCat));
+
+
+/*** Module options ***/
+
+cl::opt<bool> LazyGlobals(
+    "lazy-globals", cl::init(true),
+    cl::desc("Initialize global variables from their initializers when they "
+             "are first used rather than at startup (default=true)"),
+    cl::cat(ModuleCat));
+
 
 /*** External call policy options ***/
 
@@ -205,6 +225,16 @@ cl::opt<bool> AllExternalWarnings(
              "as opposed to once per function (default=false)"),
     cl::cat(ExtCallsCat));
 
+cl::list<std::string> NativeFunctions(
+    "native-function",
+    cl::desc("Execute calls to the given functions natively when their "
+             "arguments and all of memory are concrete (comma-separated "
+             "list). They must only call functions defined in the module "
+             "and must not use function pointers."),
+    cl::CommaSeparated,
+    cl::value_desc("function"),
+    cl::cat(ExtCallsCat));
+
 
 /*** Seeding options ***/
 
@@ -313,6 +343,21 @@ cl::opt<unsigned> MaxMemory("max-memory",
                             cl::init(2000),
                             cl::cat(TerminationCat));
 
+cl::opt<bool> SwapStates(
+    "swap-states",
+    cl::desc("Write states to disk when over the memory cap (see "
+             "-max-memory) instead of terminating them, and read them back "
+             "when they are selected (default=false)"),
+    cl::init(false),
+    cl::cat(TerminationCat));
+
+cl::opt<unsigned> ExplorationJobs(
+    "exploration-jobs",
+    cl::desc("Explore states in up to this many processes, which share "
+             "statistics, coverage and test numbering (default=1)"),
+    cl::init(1),
+    cl::cat(MiscCat));
+
 cl::opt<bool> MaxMemoryInhibit(
     "max-memory-inhibit",
     cl::desc(
@@ -361,6 +406,13 @@ cl::opt<std::string> TimerInterval(
     cl::init("1s"),
     cl::cat(TerminationCat));
 
+cl::opt<std::string> StateHandOverInterval(
+    "state-handover-interval",
+    cl::desc("Interval at which a worker hands states over to idle workers. "
+             "Only used with --workers (default=1s)"),
+    cl::init("1s"),
+    cl::cat(TerminationCat));
+
 
 /*** Debugging options ***/
 
@@ -439,9 +491,10 @@ const char *Executor::TerminateReasonNames[] = {
 Executor::Executor(LLVMContext &ctx, const InterpreterOptions &opts,
                    InterpreterHandler *ih)
     : Interpreter(opts), interpreterHandler(ih), searcher(0),
-      externalDispatcher(new ExternalDispatcher(ctx)), statsTracker(0),
+      externalDispatcher(new ExternalDispatcher(ctx)), nativeDispatcher(0),
+      statsTracker(0),
       pathWriter(0), symPathWriter(0), specialFunctionHandler(0), timers{time::Span(TimerInterval)},
-      replayKTest(0), replayPath(0), usingSeeds(0),
+      replayKTest(0), replayPath(0), replayPathIsPrefix(false), handOverTimerAdded(false), usingSeeds(0),
       atMemoryLimit(false), inhibitForking(false), haltExecution(false),
       ivcEnabled(false), debugLogBuffer(debugBufferString), 
       polycheck(new Polycheck()) {
@@ -454,6 +507,7 @@ Executor::Executor(LLVMContext &ctx, const InterpreterOptions &opts,
         setHaltExecution(true);
       }));
 
+
   coreSolverTimeout = time::Span{MaxCoreSolverTime};
   if (coreSolverTimeout) UseForkedCoreSolver = true;
   Solver *coreSolver = klee::createCoreSolver(CoreSolverToUse);
@@ -470,6 +524,7 @@ Executor::Executor(LLVMContext &ctx, const InterpreterOptions &opts,
 
   this->solver = new TimingSolver(solver, EqualitySubstitution);
   memory = new MemoryManager(&arrayCache);
+  memory->setObjectInitializer(this);
 
   initializeSearchOptions();
 
@@ -547,6 +602,26 @@ Executor::setModule(std::vector<std::unique_ptr<llvm::Module>> &modules,
 
   specialFunctionHandler->bind();
 
+  if (!NativeFunctions.empty()) {
+    nativeDispatcher = new NativeDispatcher(
+        *kmodule->module, [this](const llvm::GlobalValue *gv) -> uint64_t {
+          auto it = globalAddresses.find(gv);
+          return it == globalAddresses.end() ? 0 : it->second->getZExtValue();
+        });
+    for (const auto &name : NativeFunctions) {
+      Function *f = kmodule->module->getFunction(name);
+      if (!f || f->isDeclaration()) {
+        klee_warning("cannot execute %s natively: not defined in the module",
+                     name.c_str());
+        continue;
+      }
+      std::string reason = nativeDispatcher->addFunction(f);
+      if (!reason.empty())
+        klee_warning("cannot execute %s natively: %s", name.c_str(),
+                     reason.c_str());
+    }
+  }
+
   if (StatsTracker::useStatistics() || userSearcherRequiresMD2U()) {
     statsTracker = 
       new StatsTracker(*this,
@@ -563,8 +638,10 @@ Executor::setModule(std::vector<std::unique_ptr<llvm::Module>> &modules,
 }
 
 Executor::~Executor() {
+  snapshotStore = nullptr;
   delete memory;
   delete externalDispatcher;
+  delete nativeDispatcher;
   delete specialFunctionHandler;
   delete statsTracker;
   delete solver;
@@ -573,16 +650,14 @@ Executor::~Executor() {
 
 /***/
 
-void Executor::initializeGlobalObject(ExecutionState &state, ObjectState *os,
-                                      const Constant *c, 
+void Executor::initializeGlobalObject(ObjectState *os, const Constant *c,
                                       unsigned offset) {
   const auto targetData = kmodule->targetData.get();
   if (const ConstantVector *cp = dyn_cast<ConstantVector>(c)) {
     unsigned elementSize =
       targetData->getTypeStoreSize(cp->getType()->getElementType());
     for (unsigned i=0, e=cp->getNumOperands(); i != e; ++i)
-      initializeGlobalObject(state, os, cp->getOperand(i), 
-			     offset + i*elementSize);
+      initializeGlobalObject(os, cp->getOperand(i), offset + i*elementSize);
   } else if (isa<ConstantAggregateZero>(c)) {
     unsigned i, size = targetData->getTypeStoreSize(c->getType());
     for (i=0; i<size; i++)
@@ -591,20 +666,19 @@ void Executor::initializeGlobalObject(ExecutionState &state, ObjectState *os,
     unsigned elementSize =
       targetData->getTypeStoreSize(ca->getType()->getElementType());
     for (unsigned i=0, e=ca->getNumOperands(); i != e; ++i)
-      initializeGlobalObject(state, os, ca->getOperand(i), 
-			     offset + i*elementSize);
+      initializeGlobalObject(os, ca->getOperand(i), offset + i*elementSize);
   } else if (const ConstantStruct *cs = dyn_cast<ConstantStruct>(c)) {
     const StructLayout *sl =
       targetData->getStructLayout(cast<StructType>(cs->getType()));
     for (unsigned i=0, e=cs->getNumOperands(); i != e; ++i)
-      initializeGlobalObject(state, os, cs->getOperand(i), 
-			     offset + sl->getElementOffset(i));
+      initializeGlobalObject(os, cs->getOperand(i),
+                             offset + sl->getElementOffset(i));
   } else if (const ConstantDataSequential *cds =
                dyn_cast<ConstantDataSequential>(c)) {
     unsigned elementSize =
       targetData->getTypeStoreSize(cds->getElementType());
     for (unsigned i=0, e=cds->getNumElements(); i != e; ++i)
-      initializeGlobalObject(state, os, cds->getElementAsConstant(i),
+      initializeGlobalObject(os, cds->getElementAsConstant(i),
                              offset + i*elementSize);
   } else if (!isa<UndefValue>(c) && !isa<MetadataAsValue>(c)) {
     unsigned StoreBits = targetData->getTypeStoreSizeInBits(c->getType());
@@ -619,6 +693,11 @@ void Executor::initializeGlobalObject(ExecutionState &state, ObjectState *os,
   }
 }
 
+void Executor::initialize(ObjectState &os) {
+  const auto *v = cast<GlobalVariable>(os.getObject()->allocSite);
+  initializeGlobalObject(&os, v->getInitializer(), 0);
+}
+
 MemoryObject * Executor::addExternalObject(ExecutionState &state, 
                                            void *addr, unsigned size, 
                                            bool isReadOnly) {
@@ -826,8 +905,14 @@ void Executor::initializeGlobalObjects(ExecutionState &state) {
       for (unsigned offset = 0; offset < mo->size; offset++) {
         os->write8(offset, static_cast<unsigned char *>(addr)[offset]);
       }
+    } else if (v.hasInitializer() && LazyGlobals) {
+      // The contents are only initialized when first used. Constant
+      // objects are copied out to program memory then.
+      os->initializeLazily();
+      if (v.isConstant())
+        os->setReadOnly(true);
     } else if (v.hasInitializer()) {
-      initializeGlobalObject(state, os, v.getInitializer(), 0);
+      initializeGlobalObject(os, v.getInitializer(), 0);
       if (v.isConstant())
         constantObjects.emplace_back(os);
     } else {
@@ -840,9 +925,11 @@ void Executor::initializeGlobalObjects(ExecutionState &state) {
     // initialise the actual memory with constant values
     state.addressSpace.copyOutConcretes();
 
-    // mark constant objects as read-only
-    for (auto obj : constantObjects)
+    // mark constant objects as read-only, and share identical contents
+    for (auto obj : constantObjects) {
       obj->setReadOnly(true);
+      obj->internContents();
+    }
   }
 }
 
@@ -875,7 +962,16 @@ void Executor::branch(ExecutionState &state,
   unsigned N = conditions.size();
   assert(N);
 
-  if (!branchingPermitted(state)) {
+  // Path prefixes record the index of the taken branch in unary: as many
+  // ones as it is large, terminated by a zero unless it is the last one.
+  if (replayPathIsPrefix && isReplayingPath()) {
+    unsigned next = 0;
+    while (next < N - 1 && replayPosition < replayPath->size() &&
+           (*replayPath)[replayPosition++])
+      ++next;
+    for (unsigned i=0; i<N; ++i)
+      result.push_back(i == next ? &state : nullptr);
+  } else if (!branchingPermitted(state)) {
     unsigned next = theRNG.getInt32() % N;
     for (unsigned i=0; i<N; ++i) {
       if (i == next) {
@@ -891,7 +987,11 @@ void Executor::branch(ExecutionState &state,
     result.push_back(&state);
     for (unsigned i=1; i<N; ++i) {
       ExecutionState *es = result[theRNG.getInt32() % i];
-      ExecutionState *ns = es->branch();
+      ExecutionState *ns;
+      {
+        TimerStatIncrementer copyTimer(stats::forkCopyTime);
+        ns = es->branch();
+      }
       addedStates.push_back(ns);
       result.push_back(ns);
       processTree->attach(es->ptreeNode, ns, es);
@@ -945,6 +1045,29 @@ void Executor::branch(ExecutionState &state,
     }
   }
 
+  if (replayPathIsPrefix && N > 1) {
+    // Every branch needs a stream of its own, as in fork()
+    for (unsigned i=1; i<N; ++i) {
+      if (!result[i] || result[i] == &state)
+        continue;
+      if (pathWriter)
+        result[i]->pathOS = pathWriter->open(state.pathOS);
+      if (symPathWriter)
+        result[i]->symPathOS = symPathWriter->open(state.symPathOS);
+    }
+    for (unsigned i=0; i<N; ++i) {
+      if (!result[i])
+        continue;
+      std::string decisions(i, '1');
+      if (i < N - 1)
+        decisions += '0';
+      if (pathWriter)
+        result[i]->pathOS << decisions;
+      if (symPathWriter)
+        result[i]->symPathOS << decisions;
+    }
+  }
+
   for (unsigned i=0; i<N; ++i)
     if (result[i])
       addConstraint(*result[i], conditions[i]);
@@ -985,21 +1108,53 @@ Executor::fork(ExecutionState &current, ref<Expr> condition, bool isInternal) {
     }
   }
 
+  // Only branch queries can be retried, so internal forks (e.g. bounds
+  // checks) always get the full budget.
+  bool isAdaptive =
+      !isSeeding && !isInternal && isa<BranchInst>(current.prevPC->inst);
   time::Span timeout = coreSolverTimeout;
-  if (isSeeding)
+  if (isSeeding) {
     timeout *= static_cast<unsigned>(it->second.size());
-  solver->setTimeout(timeout);
-  bool success = solver->evaluate(current.constraints, condition, res,
-                                  current.queryMetaData);
+    solver->setTimeout(timeout);
+  } else if (isAdaptive) {
+    timeout = solver->setAdaptiveTimeout(coreSolverTimeout, current.prevPC,
+                                         current.solverTimeoutRetries);
+  } else {
+    solver->setTimeout(timeout);
+  }
+  bool success;
+  {
+    TimerStatIncrementer queryTimer(stats::forkQueryTime);
+    success = solver->evaluate(current.constraints, condition, res,
+                               current.queryMetaData);
+  }
   solver->setTimeout(time::Span());
   if (!success) {
     current.pc = current.prevPC;
+    bool cutOffEarly =
+        timeout && (!coreSolverTimeout || timeout < coreSolverTimeout) &&
+        solver->getOperationStatusCode() ==
+            SolverImpl::SOLVER_RUN_STATUS_TIMEOUT;
+    if (isAdaptive && cutOffEarly) {
+      // Cut off by the adaptive timeout: leave the state at the branch so
+      // that it is re-executed later with a larger budget.
+      klee_warning_once(current.prevPC,
+                        "retrying query cut off by the adaptive solver "
+                        "timeout with a larger budget");
+      ++current.solverTimeoutRetries;
+      ++stats::solverTimeoutRetries;
+      return StatePair(0, 0);
+    }
     terminateStateEarly(current, "Query timed out (fork).");
     return StatePair(0, 0);
   }
+  current.solverTimeoutRetries = 0;
+
+  // Whether the decision is part of the path
+  bool isRecorded = !isInternal || replayPathIsPrefix;
 
   if (!isSeeding) {
-    if (replayPath && !isInternal) {
+    if (isReplayingPath() && isRecorded) {
       assert(replayPosition<replayPath->size() &&
              "ran out of branches in replay path mode");
       bool branch = (*replayPath)[replayPosition++];
@@ -1074,7 +1229,7 @@ Executor::fork(ExecutionState &current, ref<Expr> condition, bool isInternal) {
   // hint to just use the single constraint instead of all the binary
   // search ones. If that makes sense.
   if (res==Solver::True) {
-    if (!isInternal) {
+    if (isRecorded) {
       if (pathWriter) {
         current.pathOS << "1";
       }
@@ -1082,7 +1237,7 @@ Executor::fork(ExecutionState &current, ref<Expr> condition, bool isInternal) {
 
     return StatePair(&current, 0);
   } else if (res==Solver::False) {
-    if (!isInternal) {
+    if (isRecorded) {
       if (pathWriter) {
         current.pathOS << "0";
       }
@@ -1095,7 +1250,10 @@ Executor::fork(ExecutionState &current, ref<Expr> condition, bool isInternal) {
 
     ++stats::forks;
 
-    falseState = trueState->branch();
+    {
+      TimerStatIncrementer copyTimer(stats::forkCopyTime);
+      falseState = trueState->branch();
+    }
     addedStates.push_back(falseState);
 
     if (it != seedMap.end()) {
@@ -1139,14 +1297,14 @@ Executor::fork(ExecutionState &current, ref<Expr> condition, bool isInternal) {
       // Need to update the pathOS.id field of falseState, otherwise the same id
       // is used for both falseState and trueState.
       falseState->pathOS = pathWriter->open(current.pathOS);
-      if (!isInternal) {
+      if (isRecorded) {
         trueState->pathOS << "1";
         falseState->pathOS << "0";
       }
     }
     if (symPathWriter) {
       falseState->symPathOS = symPathWriter->open(current.symPathOS);
-      if (!isInternal) {
+      if (isRecorded) {
         trueState->symPathOS << "1";
         falseState->symPathOS << "0";
       }
@@ -1379,8 +1537,12 @@ void Executor::stepInstruction(ExecutionState &state) {
   if (statsTracker)
     statsTracker->stepInstruction(state);
 
-  ++stats::instructions;
-  ++state.steppedInstructions;
+  // A branch retried after the adaptive solver timeout cut off its query
+  // was counted when it was first executed
+  if (!state.solverTimeoutRetries) {
+    ++stats::instructions;
+    ++state.steppedInstructions;
+  }
   state.prevPC = state.pc;
   ++state.pc;
 
@@ -1522,6 +1684,14 @@ void Executor::executeCall(ExecutionState &state, KInstruction *ki, Function *f,
     if (InvokeInst *ii = dyn_cast<InvokeInst>(i))
       transferToBasicBlock(ii->getNormalDest(), i->getParent(), state);
   } else {
+    // Some library functions are executed natively when possible
+    if (specialFunctionHandler->handleFastPath(state, f, ki, arguments) ||
+        callNativeFunction(state, ki, f, arguments)) {
+      if (InvokeInst *ii = dyn_cast<InvokeInst>(i))
+        transferToBasicBlock(ii->getNormalDest(), i->getParent(), state);
+      return;
+    }
+
     // Check if maximum stack size was reached.
     // We currently only count the number of stack frames
     if (RuntimeMaxStackFrames && state.stack.size() > RuntimeMaxStackFrames) {
@@ -1735,6 +1905,16 @@ Function* Executor::getTargetFunction(Value *calledVal, ExecutionState &state) {
 }
 
 void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
+  if (ki->constantOp) {
+    const Cell &left = eval(ki, 0, state);
+    const Cell &right = eval(ki, 1, state);
+    if (ConstantExpr *cl = dyn_cast<ConstantExpr>(left.value))
+      if (ConstantExpr *cr = dyn_cast<ConstantExpr>(right.value)) {
+        bindLocal(ki, state, (cl->*ki->constantOp)(cr));
+        return;
+      }
+  }
+
   Instruction *i = ki->inst;
   switch (i->getOpcode()) {
     // Control flow
@@ -2921,6 +3101,8 @@ void Executor::computeOffsets(KGEPInstruction *kgepi, TypeIt ib, TypeIt ie) {
 }
 
 void Executor::bindInstructionConstants(KInstruction *KI) {
+  KI->constantOp = getConstantOp(KI->inst);
+
   KGEPInstruction *kgepi = static_cast<KGEPInstruction*>(KI);
 
   if (GetElementPtrInst *gepi = dyn_cast<GetElementPtrInst>(KI->inst)) {
@@ -2934,6 +3116,41 @@ void Executor::bindInstructionConstants(KInstruction *KI) {
   }
 }
 
+Executor::ConstantOp Executor::getConstantOp(const Instruction *inst) {
+  // The same operations the expression builder folds two constants with
+  switch (inst->getOpcode()) {
+  case Instruction::Add: return &ConstantExpr::Add;
+  case Instruction::Sub: return &ConstantExpr::Sub;
+  case Instruction::Mul: return &ConstantExpr::Mul;
+  case Instruction::UDiv: return &ConstantExpr::UDiv;
+  case Instruction::SDiv: return &ConstantExpr::SDiv;
+  case Instruction::URem: return &ConstantExpr::URem;
+  case Instruction::SRem: return &ConstantExpr::SRem;
+  case Instruction::And: return &ConstantExpr::And;
+  case Instruction::Or: return &ConstantExpr::Or;
+  case Instruction::Xor: return &ConstantExpr::Xor;
+  case Instruction::Shl: return &ConstantExpr::Shl;
+  case Instruction::LShr: return &ConstantExpr::LShr;
+  case Instruction::AShr: return &ConstantExpr::AShr;
+  case Instruction::ICmp:
+    switch (cast<ICmpInst>(inst)->getPredicate()) {
+    case ICmpInst::ICMP_EQ: return &ConstantExpr::Eq;
+    case ICmpInst::ICMP_NE: return &ConstantExpr::Ne;
+    case ICmpInst::ICMP_UGT: return &ConstantExpr::Ugt;
+    case ICmpInst::ICMP_UGE: return &ConstantExpr::Uge;
+    case ICmpInst::ICMP_ULT: return &ConstantExpr::Ult;
+    case ICmpInst::ICMP_ULE: return &ConstantExpr::Ule;
+    case ICmpInst::ICMP_SGT: return &ConstantExpr::Sgt;
+    case ICmpInst::ICMP_SGE: return &ConstantExpr::Sge;
+    case ICmpInst::ICMP_SLT: return &ConstantExpr::Slt;
+    case ICmpInst::ICMP_SLE: return &ConstantExpr::Sle;
+    default: return nullptr;
+    }
+  default:
+    return nullptr;
+  }
+}
+
 void Executor::bindModuleConstants() {
   for (auto &kfp : kmodule->functions) {
     KFunction *kf = kfp.get();
@@ -2949,9 +3166,21 @@ void Executor::bindModuleConstants() {
   }
 }
 
+size_t Executor::getMemoryUsage() {
+  const auto mallocUsage = util::GetTotalMallocUsage() >> 20U;
+  const auto mmapUsage = memory->getUsedDeterministicSize() >> 20U;
+  return mallocUsage + mmapUsage;
+}
+
 bool Executor::checkMemoryUsage() {
   if (!MaxMemory) return true;
 
+  // The memory manager keeps running totals of the memory of all objects,
+  // which are part of the total usage and cheap to check, so forking is
+  // inhibited as soon as they alone go over the cap.
+  if ((memory->getUsedSize() >> 20U) > MaxMemory)
+    atMemoryLimit = true;
+
   // We need to avoid calling GetTotalMallocUsage() often because it
   // is O(elts on freelist). This is really bad since we start
   // to pummel the freelist once we hit the memory cap.
@@ -2959,13 +3188,17 @@ bool Executor::checkMemoryUsage() {
     return true;
 
   // check memory limit
-  const auto mallocUsage = util::GetTotalMallocUsage() >> 20U;
-  const auto mmapUsage = memory->getUsedDeterministicSize() >> 20U;
-  const auto totalUsage = mallocUsage + mmapUsage;
+  auto totalUsage = getMemoryUsage();
   atMemoryLimit = totalUsage > MaxMemory; // inhibit forking
   if (!atMemoryLimit)
     return true;
 
+  if (snapshotStore) {
+    swapOutStates();
+    totalUsage = getMemoryUsage();
+    atMemoryLimit = totalUsage > MaxMemory;
+  }
+
   // only terminate states when threshold (+100MB) exceeded
   if (totalUsage <= MaxMemory + 100)
     return true;
@@ -2991,6 +3224,30 @@ bool Executor::checkMemoryUsage() {
   return false;
 }
 
+void Executor::swapOutStates() {
+  // states in a merge group are merged with each other, so they stay
+  std::vector<ExecutionState *> candidates;
+  for (const auto &state : states)
+    if (!snapshotStore->isSwappedOut(*state) && state->openMergeStack.empty())
+      candidates.push_back(state);
+
+  // swap out in random order until 10% below the cap, as memory that is
+  // shared with other states is not freed by swapping out one of them
+  unsigned swapped = 0;
+  for (unsigned N = candidates.size(); N; --N) {
+    if (getMemoryUsage() <= MaxMemory - MaxMemory / 10)
+      break;
+    unsigned idx = theRNG.getInt32() % N;
+    std::swap(candidates[idx], candidates[N - 1]);
+    snapshotStore->swapOut(*candidates[N - 1]);
+    ++swapped;
+  }
+
+  if (swapped)
+    klee_message("swapped out %u states (%zu on disk, over memory cap)",
+                 swapped, snapshotStore->getNumSwappedOut());
+}
+
 void Executor::doDumpStates() {
   if (!DumpStatesOnHalt || states.empty())
     return;
@@ -3074,12 +3331,34 @@ void Executor::run(ExecutionState &initialState) {
 
   searcher = constructUserSearcher(*this);
 
+  if (SwapStates && MaxMemory)
+    snapshotStore = std::make_unique<SnapshotStore>(
+        interpreterHandler->getOutputFilename("states.snapshot"));
+
+  if (ExplorationJobs > 1) {
+    if (snapshotStore)
+      klee_error("--swap-states cannot be used with --exploration-jobs");
+    if (pathWriter || symPathWriter)
+      klee_error("--exploration-jobs cannot be used with --write-paths, "
+                 "--write-sym-paths or --workers");
+    if (theStatisticManager->shareBetweenProcesses())
+      parallelExploration = ParallelExploration::create(ExplorationJobs);
+    if (!parallelExploration)
+      klee_warning("unable to allocate shared memory for parallel "
+                   "exploration, using a single process");
+  }
+
   std::vector<ExecutionState *> newStates(states.begin(), states.end());
   searcher->update(0, newStates, std::vector<ExecutionState *>());
 
   // main interpreter loop
   while (!states.empty() && !haltExecution) {
+    if (parallelExploration)
+      splitStates();
+
     ExecutionState &state = searcher->selectState();
+    if (snapshotStore)
+      snapshotStore->swapIn(state);
     KInstruction *ki = state.pc;
     stepInstruction(state);
 
@@ -3094,12 +3373,106 @@ void Executor::run(ExecutionState &initialState) {
       // update searchers when states were terminated early due to memory pressure
       updateStates(nullptr);
     }
+
+    if (parallelExploration)
+      haltExecution = parallelExploration->checkHalt(haltExecution);
   }
 
   delete searcher;
   searcher = nullptr;
 
   doDumpStates();
+
+  if (parallelExploration)
+    finishParallelExploration();
+}
+
+void Executor::splitStates() {
+  if (states.size() < 2 || !parallelExploration->hasFreeSlot())
+    return;
+
+  // Buffered output and pending statistics would be written by both
+  // processes
+  theStatisticManager->flushStatistics();
+  interpreterHandler->getInfoStream().flush();
+  llvm::outs().flush();
+  llvm::errs().flush();
+  fflush(nullptr);
+
+  ParallelExploration::Side side = parallelExploration->fork();
+  if (side == ParallelExploration::Side::Failed)
+    return;
+
+  if (side == ParallelExploration::Side::Child && statsTracker)
+    statsTracker->disableOutput();
+
+  // Both processes keep every other state in the order of their ids, so
+  // that each gets a mix of old and new states. The others are dropped
+  // without terminating them, as they live on in the other process.
+  bool keepOdd = side == ParallelExploration::Side::Child;
+  unsigned n = 0;
+  for (ExecutionState *es : states)
+    if ((n++ % 2 == 1) != keepOdd)
+      removedStates.push_back(es);
+  updateStates(nullptr);
+}
+
+void Executor::finishParallelExploration() {
+  theStatisticManager->flushStatistics();
+  parallelExploration->finish([this]() {
+    timers.invoke();
+    haltExecution = parallelExploration->checkHalt(haltExecution);
+  });
+
+  if (parallelExploration->isWorker()) {
+    theStatisticManager->flushStatistics();
+    llvm::outs().flush();
+    llvm::errs().flush();
+    fflush(nullptr);
+    _exit(0);
+  }
+  parallelExploration = nullptr;
+}
+
+void Executor::setPathPrefix(const std::vector<bool> *prefix) {
+  setReplayPath(prefix);
+  replayPathIsPrefix = true;
+
+  // Prefixes are only explored by workers, which hand states over
+  if (prefix && !handOverTimerAdded) {
+    timers.add(std::make_unique<Timer>(time::Span(StateHandOverInterval),
+                                       [&] { handOverStates(); }));
+    handOverTimerAdded = true;
+  }
+}
+
+void Executor::handOverStates() {
+  // Only while exploring, and only states that their paths identify
+  if (!searcher || !seedMap.empty() || !replayPathIsPrefix || !pathWriter ||
+      isReplayingPath())
+    return;
+
+  unsigned wanted = interpreterHandler->getNumStatesWanted();
+  if (!wanted)
+    return;
+
+  // The oldest states are handed over first, as they tend to have the
+  // most left to explore. One state is always kept.
+  size_t remaining = states.size() - removedStates.size();
+  for (ExecutionState *es : states) {
+    if (!wanted || remaining <= 1)
+      break;
+    if (!es->openMergeStack.empty() ||
+        std::find(removedStates.begin(), removedStates.end(), es) !=
+            removedStates.end())
+      continue;
+    if (snapshotStore)
+      snapshotStore->swapIn(*es);
+    interpreterHandler->handOverState(*es);
+    removedStates.push_back(es);
+    --remaining;
+    --wanted;
+  }
 }
 
 std::string Executor::getAddressInfo(ExecutionState &state, 
@@ -3156,6 +3529,10 @@ std::string Executor::getAddressInfo(ExecutionState &state,
 
 
 void Executor::terminateState(ExecutionState &state) {
+  // What is left of the state is not needed anymore
+  if (snapshotStore)
+    snapshotStore->drop(state);
+
   if (replayKTest && replayPosition!=replayKTest->numObjects) {
     klee_warning_once(replayKTest,
                       "replay did not consume all objects in test input.");
@@ -3184,9 +3561,19 @@ void Executor::terminateState(ExecutionState &state) {
 void Executor::terminateStateEarly(ExecutionState &state, 
                                    const Twine &message) {
   if (!OnlyOutputStatesCoveringNew || state.coveredNew ||
-      (AlwaysOutputSeeds && seedMap.count(&state)))
-    interpreterHandler->processTestCase(state, (message + "\n").str().c_str(),
-                                        "early");
+      (AlwaysOutputSeeds && seedMap.count(&state))) {
+    if (snapshotStore && snapshotStore->isSwappedOut(state) &&
+        atMemoryLimit) {
+      // Reading the state back would only add to the memory pressure
+      klee_warning_once(0, "not generating tests for swapped out states "
+                           "terminated over the memory cap");
+    } else {
+      if (snapshotStore)
+        snapshotStore->swapIn(state);
+      interpreterHandler->processTestCase(
+          state, (message + "\n").str().c_str(), "early");
+    }
+  }
   terminateState(state);
 }
 
@@ -3436,6 +3823,51 @@ void Executor::callExternalFunction(ExecutionState &state,
   }
 }
 
+bool Executor::callNativeFunction(ExecutionState &state, KInstruction *target,
+                                  Function *function,
+                                  std::vector<ref<Expr> > &arguments) {
+  if (!nativeDispatcher || !nativeDispatcher->hasFunction(function) ||
+      arguments.size() != function->arg_size())
+    return false;
+
+  // The native code sees the concrete contents of memory only
+  if (!state.addressSpace.isFullyConcrete())
+    return false;
+
+  uint64_t *args = (uint64_t*) alloca(sizeof(*args) * (arguments.size() + 2));
+  memset(args, 0, sizeof(*args) * (arguments.size() + 2));
+  unsigned wordIndex = 2;
+  for (const auto &arg : arguments) {
+    ConstantExpr *ce = dyn_cast<ConstantExpr>(arg);
+    if (!ce)
+      return false;
+    ce->toMemory(&args[wordIndex++]);
+  }
+
+  state.addressSpace.copyOutConcretes();
+  if (!nativeDispatcher->executeCall(function, args)) {
+    // The call crashed or reported an error, which the interpreter
+    // reproduces from the unchanged state.
+    ++stats::nativeCallsFailed;
+    return false;
+  }
+  ++stats::nativeCalls;
+
+  if (!state.addressSpace.copyInConcretes()) {
+    terminateStateOnError(state, "native call modified read-only object",
+                          External);
+    return true;
+  }
+
+  Type *resultType = target->inst->getType();
+  if (!resultType->isVoidTy()) {
+    ref<Expr> e = ConstantExpr::fromMemory((void*) args,
+                                           getWidthForLLVMType(resultType));
+    bindLocal(target, state, e);
+  }
+  return true;
+}
+
 /***/
 
 ref<Expr> Executor::replaceReadWithSymbolic(ExecutionState &state, 
@@ -3962,13 +4394,23 @@ void Executor::runFunctionAsMain(Function *f,
   processTree = std::make_unique<PTree>(state);
   run(*state);
   processTree = nullptr;
+  snapshotStore = nullptr;
 
   // hack to clear memory objects
   delete memory;
-  memory = new MemoryManager(NULL);
+  memory = new MemoryManager(&arrayCache);
+  memory->setObjectInitializer(this);
 
   globalObjects.clear();
   globalAddresses.clear();
+  // The native code refers to the addresses of the globals
+  if (nativeDispatcher)
+    nativeDispatcher->reset();
+
+  if (WriteQueryTimeHistogram) {
+    if (auto os = interpreterHandler->openOutputFile("query-times.txt"))
+      solver->printQueryTimeHistogram(*os);
+  }
 
   if (statsTracker)
     statsTracker->done();
@@ -4194,6 +4636,11 @@ void Executor::prepareForEarlyExit() {
   }
 }
 
+void Executor::disableStatsOutput() {
+  if (statsTracker)
+    statsTracker->disableOutput();
+}
+
 /// Returns the errno location in memory
 int *Executor::getErrnoLocation(const ExecutionState &state) const {
 #if !defined(__APPLE__) && !defined(__FreeBSD__)
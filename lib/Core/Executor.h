@@ -16,6 +16,7 @@
 #define KLEE_EXECUTOR_H
 
 #include "ExecutionState.h"
+#include "MemoryManager.h"
 #include "UserSearcher.h"
 
 #include "klee/ADT/RNG.h"
@@ -66,10 +67,13 @@ namespace klee {
   class KModule;
   class MemoryManager;
   class MemoryObject;
+  class NativeDispatcher;
   class ObjectState;
+  class ParallelExploration;
   class PTree;
   class Searcher;
   class SeedInfo;
+  class SnapshotStore;
   class SpecialFunctionHandler;
   struct StackFrame;
   class StatsTracker;
@@ -86,7 +90,7 @@ namespace klee {
   /// during an instruction step. Should contain addedStates,
   /// removedStates, and haltExecution, among others.
 
-class Executor : public Interpreter {
+class Executor : public Interpreter, private ObjectInitializer {
   friend class OwningSearcher;
   friend class WeightedRandomSearcher;
   friend class SpecialFunctionHandler;
@@ -125,6 +129,8 @@ private:
   Searcher *searcher;
 
   ExternalDispatcher *externalDispatcher;
+  /// Executes the functions given with --native-function, or null.
+  NativeDispatcher *nativeDispatcher;
   TimingSolver *solver;
   MemoryManager *memory;
   Polycheck *polycheck;
@@ -135,6 +141,12 @@ private:
   TimerGroup timers;
   std::unique_ptr<PTree> processTree;
 
+  /// Holds the states that were swapped out to disk (see -swap-states).
+  std::unique_ptr<SnapshotStore> snapshotStore;
+
+  /// Coordinates the worker processes (see -exploration-jobs).
+  std::unique_ptr<ParallelExploration> parallelExploration;
+
   /// Used to track states that have been added during the current
   /// instructions step. 
   /// \invariant \ref addedStates is a subset of \ref states. 
@@ -177,6 +189,15 @@ private:
   /// object.
   unsigned replayPosition;
 
+  /// Whether \ref replayPath is only a prefix, after which execution goes
+  /// on to explore normally. Paths are then meant to identify a single
+  /// state, so internal forks and multi-way branches are recorded in and
+  /// replayed from them as well.
+  bool replayPathIsPrefix;
+
+  /// Whether the timer handing states over to other workers is set up.
+  bool handOverTimerAdded;
+
   /// When non-null a list of "seed" inputs which will be used to
   /// drive execution.
   const std::vector<struct KTest *> *usingSeeds;  
@@ -235,9 +256,10 @@ private:
                                   unsigned size, bool isReadOnly);
 
   void initializeGlobalAlias(const llvm::Constant *c);
-  void initializeGlobalObject(ExecutionState &state, ObjectState *os, 
-			      const llvm::Constant *c,
-			      unsigned offset);
+  void initializeGlobalObject(ObjectState *os, const llvm::Constant *c,
+                              unsigned offset);
+  /// Initialize a lazily initialized global variable from its initializer.
+  void initialize(ObjectState &os) override;
   void initializeGlobals(ExecutionState &state);
   void allocateGlobalObjects(ExecutionState &state);
   void initializeGlobalAliases();
@@ -254,6 +276,15 @@ private:
                             llvm::Function *function,
                             std::vector< ref<Expr> > &arguments);
 
+  /// Execute a call to \a function natively, if it was selected for
+  /// native execution and both its arguments and the whole address space
+  /// are concrete.
+  ///
+  /// \return False if the call has to be interpreted instead.
+  bool callNativeFunction(ExecutionState &state, KInstruction *target,
+                          llvm::Function *function,
+                          std::vector<ref<Expr> > &arguments);
+
   ObjectState *bindObjectInState(ExecutionState &state, const MemoryObject *mo,
                                  bool isLocal, const Array *array = 0);
 
@@ -440,14 +471,45 @@ private:
   /// constant values.
   void bindInstructionConstants(KInstruction *KI);
 
+  typedef ref<ConstantExpr> (ConstantExpr::*ConstantOp)(
+      const ref<ConstantExpr> &);
+
+  /// getConstantOp - Return the operation \a inst performs on constant
+  /// operands, if it is a binary operator or an integer comparison.
+  static ConstantOp getConstantOp(const llvm::Instruction *inst);
+
   void doImpliedValueConcretization(ExecutionState &state,
                                     ref<Expr> e,
                                     ref<ConstantExpr> value);
 
+  /// Return the memory used by KLEE in MB, including the deterministic
+  /// allocation space. This is expensive to compute.
+  size_t getMemoryUsage();
+
   /// check memory usage and terminate states when over threshold of -max-memory + 100MB
   /// \return true if below threshold, false otherwise (states were terminated)
   bool checkMemoryUsage();
 
+  /// Swap out random states until the memory usage is below the cap.
+  void swapOutStates();
+
+  /// Hand half of the states over to a new worker process, if there is a
+  /// free slot for one.
+  void splitStates();
+
+  /// Wait for the worker processes started by this one. Workers exit here.
+  void finishParallelExploration();
+
+  /// Hand the states the interpreter handler asks for over to it, see
+  /// InterpreterHandler::getNumStatesWanted().
+  void handOverStates();
+
+  /// Whether the branch decisions are currently taken from \ref replayPath.
+  bool isReplayingPath() const {
+    return replayPath &&
+           (!replayPathIsPrefix || replayPosition < replayPath->size());
+  }
+
   /// check if branching/forking is allowed
   bool branchingPermitted(const ExecutionState &state) const;
 
@@ -482,9 +544,12 @@ public:
   void setReplayPath(const std::vector<bool> *path) override {
     assert(!replayKTest && "cannot replay both buffer and path");
     replayPath = path;
+    replayPathIsPrefix = false;
     replayPosition = 0;
   }
 
+  void setPathPrefix(const std::vector<bool> *prefix) override;
+
   llvm::Module *setModule(std::vector<std::unique_ptr<llvm::Module>> &modules,
                           const ModuleOptions &opts) override;
 
@@ -499,10 +564,14 @@ public:
 
   void setHaltExecution(bool value) override { haltExecution = value; }
 
+  bool getHaltExecution() const override { return haltExecution; }
+
   void setInhibitForking(bool value) override { inhibitForking = value; }
 
   void prepareForEarlyExit() override;
 
+  void disableStatsOutput() override;
+
   /*** State accessor methods ***/
 
   unsigned getPathStreamID(const ExecutionState &state) override;
@@ -10,10 +10,10 @@
 #include "Memory.h"
 
 #include "Context.h"
+#include "CoreStats.h"
 #include "ExecutionState.h"
 #include "MemoryManager.h"
 
-#include "klee/ADT/BitArray.h"
 #include "klee/Expr/ArrayCache.h"
 #include "klee/Expr/Expr.h"
 #include "klee/Support/OptionCategories.h"
@@ -26,8 +26,12 @@
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include <algorithm>
 #include <cassert>
 #include <sstream>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 using namespace llvm;
 using namespace klee;
@@ -38,6 +42,18 @@ namespace {
                     cl::desc("Use constant arrays instead of updates when possible (default=true)\n"),
                     cl::init(true),
                     cl::cat(SolvingCat));
+
+  cl::opt<bool> CompactUpdateLists(
+      "compact-update-lists",
+      cl::desc("Drop overwritten updates of symbolic memory and fold "
+               "updates at concrete offsets into constant arrays when update "
+               "lists grow (default=true)"),
+      cl::init(true), cl::cat(SolvingCat));
+
+  /// The length of update lists from which on they are compacted, and
+  /// reads at concrete offsets use an index.
+  const unsigned MinCompactionSize = 64;
+  const unsigned MinIndexSize = 32;
 }
 
 /***/
@@ -73,14 +89,28 @@ void MemoryObject::getAllocInfo(std::string &result) const {
 
 /***/
 
+/// The newest updates at concrete offsets that follow the newest write at a
+/// symbolic offset, by offset.
+struct ObjectState::UpdateIndex {
+  /// The head of the updates that were indexed.
+  ref<UpdateNode> head;
+  /// The newest write at a symbolic offset, or null if there is none.
+  ref<UpdateNode> barrier;
+  std::unordered_map<uint64_t, const UpdateNode *> nodes;
+};
+
 ObjectState::ObjectState(const MemoryObject *mo)
   : copyOnWriteOwner(0),
     object(mo),
-    concreteStore(new uint8_t[mo->size]),
+    concreteStore(mo->size),
     concreteMask(0),
     flushMask(0),
     knownSymbolics(0),
+    allSymbolic(false),
+    lazy(false),
+    compactedSize(0),
     updates(0, 0),
+    updateIndex(0),
     size(mo->size),
     readOnly(false) {
   if (!UseConstantArrays) {
@@ -89,49 +119,74 @@ ObjectState::ObjectState(const MemoryObject *mo)
         getArrayCache()->CreateArray("tmp_arr" + llvm::utostr(++id), size);
     updates = UpdateList(array, 0);
   }
-  memset(concreteStore, 0, size);
 }
 
 
 ObjectState::ObjectState(const MemoryObject *mo, const Array *array)
   : copyOnWriteOwner(0),
     object(mo),
-    concreteStore(new uint8_t[mo->size]),
+    concreteStore(0),
     concreteMask(0),
     flushMask(0),
     knownSymbolics(0),
+    allSymbolic(false),
+    lazy(false),
+    compactedSize(0),
     updates(array, 0),
+    updateIndex(0),
     size(mo->size),
     readOnly(false) {
   makeSymbolic();
-  memset(concreteStore, 0, size);
+}
+
+ObjectState::ObjectState(const MemoryObject *mo, const UpdateList &updates)
+  : copyOnWriteOwner(0),
+    object(mo),
+    concreteStore(0),
+    concreteMask(0),
+    flushMask(0),
+    knownSymbolics(0),
+    allSymbolic(false),
+    lazy(false),
+    compactedSize(0),
+    updates(updates),
+    updateIndex(0),
+    size(mo->size),
+    readOnly(false) {
 }
 
 ObjectState::ObjectState(const ObjectState &os) 
   : copyOnWriteOwner(0),
     object(os.object),
-    concreteStore(new uint8_t[os.size]),
-    concreteMask(os.concreteMask ? new BitArray(*os.concreteMask, os.size) : 0),
-    flushMask(os.flushMask ? new BitArray(*os.flushMask, os.size) : 0),
-    knownSymbolics(0),
+    concreteStore(os.concreteStore),
+    concreteMask(os.concreteMask ? new BitMask(*os.concreteMask) : 0),
+    flushMask(os.flushMask ? new BitMask(*os.flushMask) : 0),
+    knownSymbolics(os.knownSymbolics
+                       ? new ExprArray(*os.knownSymbolics)
+                       : 0),
+    allSymbolic(os.allSymbolic),
+    lazy(os.lazy),
+    compactedSize(os.compactedSize),
     updates(os.updates),
+    updateIndex(0),
     size(os.size),
     readOnly(false) {
   assert(!os.readOnly && "no need to copy read only object?");
-  if (os.knownSymbolics) {
-    knownSymbolics = new ref<Expr>[size];
-    for (unsigned i=0; i<size; i++)
-      knownSymbolics[i] = os.knownSymbolics[i];
-  }
 
-  memcpy(concreteStore, os.concreteStore, size*sizeof(*concreteStore));
+  stats::objectStatePagesShared += concreteStore.getNumPages();
+  if (concreteMask)
+    stats::objectStatePagesShared += concreteMask->getNumPages();
+  if (flushMask)
+    stats::objectStatePagesShared += flushMask->getNumPages();
+  if (knownSymbolics)
+    stats::objectStatePagesShared += knownSymbolics->getNumPages();
 }
 
 ObjectState::~ObjectState() {
   delete concreteMask;
   delete flushMask;
-  delete[] knownSymbolics;
-  delete[] concreteStore;
+  delete knownSymbolics;
+  delete updateIndex;
 }
 
 ArrayCache *ObjectState::getArrayCache() const {
@@ -178,22 +233,135 @@ const UpdateList &ObjectState::getUpdates() const {
       Contents[Index->getZExtValue()] = Value;
     }
 
-    static unsigned id = 0;
-    const Array *array = getArrayCache()->CreateArray(
-        "const_arr" + llvm::utostr(++id), size, &Contents[0],
-        &Contents[0] + Contents.size());
-    updates = UpdateList(array, 0);
+    updates = UpdateList(createConstantArray(Contents), 0);
 
     // Apply the remaining (non-constant) writes.
     for (; Begin != End; ++Begin)
       updates.extend(Writes[Begin].first, Writes[Begin].second);
   }
 
+  // Compact the updates whenever they doubled in length, so that the cost
+  // of compaction is linear in the number of updates.
+  if (CompactUpdateLists &&
+      updates.getSize() >= std::max(2 * compactedSize, MinCompactionSize))
+    compactUpdates();
+
   return updates;
 }
 
+const Array *ObjectState::createConstantArray(
+    const std::vector<ref<ConstantExpr> > &contents) const {
+  static unsigned id = 0;
+  return getArrayCache()->CreateArray("const_arr" + llvm::utostr(++id), size,
+                                      &contents[0],
+                                      &contents[0] + contents.size());
+}
+
+void ObjectState::compactUpdates() const {
+  // Collect the updates, with the oldest first.
+  std::vector<const UpdateNode *> nodes(updates.getSize());
+  const UpdateNode *un = updates.head.get();
+  for (unsigned i = nodes.size(); i != 0; un = un->next.get())
+    nodes[--i] = un;
+
+  // An update is dead if a later update writes the same concrete offset
+  // before any write at a symbolic offset.
+  std::vector<bool> live(nodes.size(), true);
+  std::unordered_set<uint64_t> written;
+  for (unsigned i = nodes.size(); i != 0;) {
+    --i;
+    ConstantExpr *index = dyn_cast<ConstantExpr>(nodes[i]->index);
+    if (!index)
+      written.clear();
+    else if (!written.insert(index->getZExtValue()).second)
+      live[i] = false;
+  }
+
+  // The live updates of constant values at concrete offsets that precede
+  // all writes at symbolic offsets are folded into a new constant array,
+  // if that removes enough updates to pay for the array.
+  const Array *root = updates.root;
+  if (root->isConstantArray()) {
+    unsigned end = 0, folded = 0;
+    for (; end != nodes.size(); ++end) {
+      ConstantExpr *index = dyn_cast<ConstantExpr>(nodes[end]->index);
+      if (!index)
+        break;
+      folded += live[end] && isa<ConstantExpr>(nodes[end]->value) &&
+                index->getZExtValue() < root->size;
+    }
+
+    if (folded >= MinCompactionSize / 2 && folded * 16 >= size) {
+      std::vector<ref<ConstantExpr> > contents(root->constantValues);
+      for (unsigned i = 0; i != end; ++i) {
+        uint64_t index = cast<ConstantExpr>(nodes[i]->index)->getZExtValue();
+        ConstantExpr *value = dyn_cast<ConstantExpr>(nodes[i]->value);
+        if (live[i] && value && index < root->size) {
+          contents[index] = value;
+          live[i] = false;
+        }
+      }
+      root = createConstantArray(contents);
+    }
+  }
+
+  UpdateList compacted(root, 0);
+  for (unsigned i = 0; i != nodes.size(); ++i)
+    if (live[i])
+      compacted.extend(nodes[i]->index, nodes[i]->value);
+
+  stats::updateNodesCompacted += nodes.size() - compacted.getSize();
+  updates = compacted;
+  compactedSize = updates.getSize();
+  delete updateIndex;
+  updateIndex = 0;
+}
+
+ref<Expr> ObjectState::readFromUpdates(unsigned offset) const {
+  const UpdateList &ul = getUpdates();
+  ref<Expr> index = ConstantExpr::create(offset, Expr::Int32);
+  if (ul.getSize() < MinIndexSize)
+    return ReadExpr::create(ul, index);
+
+  if (!updateIndex)
+    updateIndex = new UpdateIndex();
+  UpdateIndex &ui = *updateIndex;
+
+  // Index the updates that were added since the index was last used, up to
+  // the newest write at a symbolic offset.
+  if (ui.head.get() != ul.head.get()) {
+    std::vector<const UpdateNode *> added;
+    const UpdateNode *un = ul.head.get();
+    for (; un && un != ui.head.get(); un = un->next.get()) {
+      if (!isa<ConstantExpr>(un->index))
+        break;
+      added.push_back(un);
+    }
+
+    // Start over if the indexed updates are not part of the list anymore,
+    // or were followed by a write at a symbolic offset.
+    if (un != ui.head.get()) {
+      ui.nodes.clear();
+      ui.barrier = const_cast<UpdateNode *>(un);
+    }
+    for (auto it = added.rbegin(), ie = added.rend(); it != ie; ++it)
+      ui.nodes[cast<ConstantExpr>((*it)->index)->getZExtValue()] = *it;
+    ui.head = ul.head;
+  }
+
+  // This mirrors ReadExpr::create, which walks the list for the same result.
+  auto it = ui.nodes.find(offset);
+  if (it != ui.nodes.end())
+    return it->second->value;
+  if (ui.barrier.isNull() && ul.root->isConstantArray() &&
+      offset < ul.root->size)
+    return ul.root->constantValues[offset];
+  return ReadExpr::alloc(UpdateList(ul.root, ui.barrier), index);
+}
+
 void ObjectState::flushToConcreteStore(TimingSolver *solver,
                                        const ExecutionState &state) const {
+  initialize();
   for (unsigned i = 0; i < size; i++) {
     if (isByteKnownSymbolic(i)) {
       ref<ConstantExpr> ce;
@@ -204,45 +372,113 @@ void ObjectState::flushToConcreteStore(TimingSolver *solver,
                      "byte %p+%u will have random value",
                      (void *)object->address, i);
       else
-        ce->toMemory(concreteStore + i);
+        setConcreteByte(i, ce->getZExtValue(8));
     }
   }
 }
 
+void ObjectState::copyOutConcreteStore(uint8_t *dest) const {
+  initialize();
+  if (concreteStore.getSize() != size)
+    std::fill(dest, dest + size, 0);
+  else
+    concreteStore.copyOut(dest);
+}
+
+bool ObjectState::equalsConcreteStore(const uint8_t *src) const {
+  initialize();
+  if (concreteStore.getSize() != size)
+    return std::all_of(src, src + size, [](uint8_t b) { return b == 0; });
+  return concreteStore.equals(src);
+}
+
+void ObjectState::copyInConcreteStore(const uint8_t *src) {
+  initialize();
+  if (concreteStore.getSize() != size) {
+    if (equalsConcreteStore(src))
+      return;
+    materializeConcreteStore();
+  }
+  stats::objectStatePageCopies += concreteStore.copyIn(src);
+}
+
+void ObjectState::materializeConcreteStore() const {
+  if (concreteStore.getSize() != size)
+    concreteStore = ByteArray(size);
+}
+
 void ObjectState::makeConcrete() {
+  lazy = false;
   delete concreteMask;
   delete flushMask;
-  delete[] knownSymbolics;
+  delete knownSymbolics;
   concreteMask = 0;
   flushMask = 0;
   knownSymbolics = 0;
+  allSymbolic = false;
+  materializeConcreteStore();
 }
 
 void ObjectState::makeSymbolic() {
   assert(updates.head.isNull() &&
          "XXX makeSymbolic of objects with symbolic values is unsupported");
 
-  // XXX simplify this, can just delete various arrays I guess
-  for (unsigned i=0; i<size; i++) {
-    markByteSymbolic(i);
-    setKnownSymbolic(i, 0);
-    markByteFlushed(i);
-  }
+  delete concreteMask;
+  delete flushMask;
+  delete knownSymbolics;
+  concreteMask = 0;
+  flushMask = 0;
+  knownSymbolics = 0;
+  allSymbolic = true;
+}
+
+void ObjectState::makeMixed() {
+  assert(allSymbolic && "object is not all symbolic");
+  materializeConcreteStore();
+  concreteMask = new BitMask(size, false);
+  flushMask = new BitMask(size, false);
+  allSymbolic = false;
 }
 
 void ObjectState::initializeToZero() {
   makeConcrete();
-  memset(concreteStore, 0, size);
+  concreteStore.fill(0);
 }
 
 void ObjectState::initializeToRandom() {  
   makeConcrete();
-  for (unsigned i=0; i<size; i++) {
-    // randomly selected by 256 sided die
-    concreteStore[i] = 0xAB;
+  // randomly selected by 256 sided die
+  concreteStore.fill(0xAB);
+}
+
+void ObjectState::initializeLazily() {
+  makeConcrete();
+  concreteStore = ByteArray(0);
+  lazy = true;
+}
+
+void ObjectState::runInitializer() const {
+  ObjectState *self = const_cast<ObjectState *>(this);
+  self->lazy = false;
+  self->makeConcrete();
+  ObjectInitializer *initializer = object->parent->getObjectInitializer();
+  assert(initializer && "lazily initialized object without initializer");
+  initializer->initialize(*self);
+
+  // Read-only objects are only copied out to program memory once, which
+  // has to wait until their contents are known.
+  if (readOnly) {
+    self->internContents();
+    copyOutConcreteStore(reinterpret_cast<uint8_t *>(object->address));
   }
 }
 
+void ObjectState::internContents() {
+  assert(readOnly && "interning contents of writeable object");
+  if (isFullyConcrete() && concreteStore.getSize() == size)
+    object->parent->internReadOnlyContents(concreteStore);
+}
+
 /*
 Cache Invariants
 --
@@ -260,7 +496,11 @@ void ObjectState::fastRangeCheckOffset(ref<Expr> offset,
 
 void ObjectState::flushRangeForRead(unsigned rangeBase, 
                                     unsigned rangeSize) const {
-  if (!flushMask) flushMask = new BitArray(size, true);
+  // all bytes are already in the updates
+  if (allSymbolic)
+    return;
+
+  if (!flushMask) flushMask = new BitMask(size, true);
  
   for (unsigned offset=rangeBase; offset<rangeBase+rangeSize; offset++) {
     if (!isByteFlushed(offset)) {
@@ -270,17 +510,22 @@ void ObjectState::flushRangeForRead(unsigned rangeBase,
       } else {
         assert(isByteKnownSymbolic(offset) && "invalid bit set in flushMask");
         updates.extend(ConstantExpr::create(offset, Expr::Int32),
-                       knownSymbolics[offset]);
+                       (*knownSymbolics)[offset]);
       }
 
-      flushMask->unset(offset);
+      if (flushMask->unset(offset))
+        ++stats::objectStatePageCopies;
     }
   } 
 }
 
 void ObjectState::flushRangeForWrite(unsigned rangeBase, 
                                      unsigned rangeSize) {
-  if (!flushMask) flushMask = new BitArray(size, true);
+  // all bytes are already in the updates, and stay symbolic
+  if (allSymbolic)
+    return;
+
+  if (!flushMask) flushMask = new BitMask(size, true);
 
   for (unsigned offset=rangeBase; offset<rangeBase+rangeSize; offset++) {
     if (!isByteFlushed(offset)) {
@@ -291,11 +536,11 @@ void ObjectState::flushRangeForWrite(unsigned rangeBase,
       } else {
         assert(isByteKnownSymbolic(offset) && "invalid bit set in flushMask");
         updates.extend(ConstantExpr::create(offset, Expr::Int32),
-                       knownSymbolics[offset]);
+                       (*knownSymbolics)[offset]);
         setKnownSymbolic(offset, 0);
       }
 
-      flushMask->unset(offset);
+      markByteFlushed(offset);
     } else {
       // flushed bytes that are written over still need
       // to be marked out
@@ -309,65 +554,73 @@ void ObjectState::flushRangeForWrite(unsigned rangeBase,
 }
 
 bool ObjectState::isByteConcrete(unsigned offset) const {
-  return !concreteMask || concreteMask->get(offset);
+  return !allSymbolic && (!concreteMask || concreteMask->get(offset));
 }
 
 bool ObjectState::isByteFlushed(unsigned offset) const {
-  return flushMask && !flushMask->get(offset);
+  return allSymbolic || (flushMask && !flushMask->get(offset));
 }
 
 bool ObjectState::isByteKnownSymbolic(unsigned offset) const {
-  return knownSymbolics && knownSymbolics[offset].get();
+  return knownSymbolics && (*knownSymbolics)[offset].get();
 }
 
 void ObjectState::markByteConcrete(unsigned offset) {
-  if (concreteMask)
-    concreteMask->set(offset);
+  if (concreteMask && concreteMask->set(offset))
+    ++stats::objectStatePageCopies;
 }
 
 void ObjectState::markByteSymbolic(unsigned offset) {
   if (!concreteMask)
-    concreteMask = new BitArray(size, true);
-  concreteMask->unset(offset);
+    concreteMask = new BitMask(size, true);
+  if (concreteMask->unset(offset))
+    ++stats::objectStatePageCopies;
 }
 
 void ObjectState::markByteUnflushed(unsigned offset) {
-  if (flushMask)
-    flushMask->set(offset);
+  if (flushMask && flushMask->set(offset))
+    ++stats::objectStatePageCopies;
 }
 
 void ObjectState::markByteFlushed(unsigned offset) {
   if (!flushMask) {
-    flushMask = new BitArray(size, false);
-  } else {
-    flushMask->unset(offset);
+    flushMask = new BitMask(size, false);
+  } else if (flushMask->unset(offset)) {
+    ++stats::objectStatePageCopies;
   }
 }
 
 void ObjectState::setKnownSymbolic(unsigned offset, 
                                    Expr *value /* can be null */) {
   if (knownSymbolics) {
-    knownSymbolics[offset] = value;
+    if ((*knownSymbolics)[offset].get() != value &&
+        knownSymbolics->set(offset, value))
+      ++stats::objectStatePageCopies;
   } else {
     if (value) {
-      knownSymbolics = new ref<Expr>[size];
-      knownSymbolics[offset] = value;
+      knownSymbolics = new ExprArray(size);
+      knownSymbolics->set(offset, value);
     }
   }
 }
 
+void ObjectState::setConcreteByte(unsigned offset, uint8_t value) const {
+  if (concreteStore[offset] != value && concreteStore.set(offset, value))
+    ++stats::objectStatePageCopies;
+}
+
 /***/
 
 ref<Expr> ObjectState::read8(unsigned offset) const {
+  initialize();
   if (isByteConcrete(offset)) {
     return ConstantExpr::create(concreteStore[offset], Expr::Int8);
   } else if (isByteKnownSymbolic(offset)) {
-    return knownSymbolics[offset];
+    return (*knownSymbolics)[offset];
   } else {
     assert(isByteFlushed(offset) && "unflushed byte without cache value");
-    
-    return ReadExpr::create(getUpdates(), 
-                            ConstantExpr::create(offset, Expr::Int32));
+
+    return readFromUpdates(offset);
   }    
 }
 
@@ -389,8 +642,11 @@ ref<Expr> ObjectState::read8(ref<Expr> offset) const {
 }
 
 void ObjectState::write8(unsigned offset, uint8_t value) {
+  initialize();
   //assert(read_only == false && "writing to read-only object!");
-  concreteStore[offset] = value;
+  if (allSymbolic)
+    makeMixed();
+  setConcreteByte(offset, value);
   setKnownSymbolic(offset, 0);
 
   markByteConcrete(offset);
@@ -402,6 +658,8 @@ void ObjectState::write8(unsigned offset, ref<Expr> value) {
   if (ConstantExpr *CE = dyn_cast<ConstantExpr>(value)) {
     write8(offset, (uint8_t) CE->getZExtValue(8));
   } else {
+    if (allSymbolic)
+      makeMixed();
     setKnownSymbolic(offset, value.get());
       
     markByteSymbolic(offset);
@@ -429,6 +687,8 @@ void ObjectState::write8(ref<Expr> offset, ref<Expr> value) {
 /***/
 
 ref<Expr> ObjectState::read(ref<Expr> offset, Expr::Width width) const {
+  initialize();
+
   // Truncate offset to 32-bits.
   offset = ZExtExpr::create(offset, Expr::Int32);
 
@@ -456,13 +716,26 @@ ref<Expr> ObjectState::read(ref<Expr> offset, Expr::Width width) const {
 }
 
 ref<Expr> ObjectState::read(unsigned offset, Expr::Width width) const {
+  initialize();
+
   // Treat bool specially, it is the only non-byte sized write we allow.
   if (width == Expr::Bool)
     return ExtractExpr::create(read8(offset), 0, Expr::Bool);
 
-  // Otherwise, follow the slow general case.
   unsigned NumBytes = width / 8;
   assert(width == NumBytes * 8 && "Invalid width for read size!");
+
+  // Fast path for concrete objects, which builds a single constant.
+  if (width <= Expr::Int64 && isFullyConcrete()) {
+    uint64_t value = 0;
+    for (unsigned i = 0; i != NumBytes; ++i) {
+      unsigned idx = Context::get().isLittleEndian() ? i : (NumBytes - i - 1);
+      value |= (uint64_t) concreteStore[offset + idx] << (8 * i);
+    }
+    return ConstantExpr::create(value, width);
+  }
+
+  // Otherwise, follow the slow general case.
   ref<Expr> Res(0);
   for (unsigned i = 0; i != NumBytes; ++i) {
     unsigned idx = Context::get().isLittleEndian() ? i : (NumBytes - i - 1);
@@ -474,6 +747,8 @@ ref<Expr> ObjectState::read(unsigned offset, Expr::Width width) const {
 }
 
 void ObjectState::write(ref<Expr> offset, ref<Expr> value) {
+  initialize();
+
   // Truncate offset to 32-bits.
   offset = ZExtExpr::create(offset, Expr::Int32);
 
@@ -501,6 +776,8 @@ void ObjectState::write(ref<Expr> offset, ref<Expr> value) {
 }
 
 void ObjectState::write(unsigned offset, ref<Expr> value) {
+  initialize();
+
   // Check for writes of constant values.
   if (ConstantExpr *CE = dyn_cast<ConstantExpr>(value)) {
     Expr::Width w = CE->getWidth();
@@ -557,7 +834,44 @@ void ObjectState::write64(unsigned offset, uint64_t value) {
   }
 }
 
+void ObjectState::copyBytes(unsigned offset, const ObjectState &src,
+                            unsigned srcOffset, unsigned count) {
+  initialize();
+  src.initialize();
+
+  // Read the whole source range before writing, as it may overlap the
+  // destination range.
+  if (src.isFullyConcrete()) {
+    std::vector<uint8_t> bytes(count);
+    for (unsigned i = 0; i != count; ++i)
+      bytes[i] = src.concreteStore[srcOffset + i];
+    for (unsigned i = 0; i != count; ++i)
+      write8(offset + i, bytes[i]);
+  } else {
+    std::vector<ref<Expr> > bytes(count);
+    for (unsigned i = 0; i != count; ++i)
+      bytes[i] = src.read8(srcOffset + i);
+    for (unsigned i = 0; i != count; ++i)
+      write8(offset + i, bytes[i]);
+  }
+}
+
+void ObjectState::fillBytes(unsigned offset, ref<Expr> value,
+                            unsigned count) {
+  initialize();
+  assert(value->getWidth() == Expr::Int8 && "invalid fill value width");
+  if (ConstantExpr *CE = dyn_cast<ConstantExpr>(value)) {
+    uint8_t byte = CE->getZExtValue(8);
+    for (unsigned i = 0; i != count; ++i)
+      write8(offset + i, byte);
+  } else {
+    for (unsigned i = 0; i != count; ++i)
+      write8(offset + i, value);
+  }
+}
+
 void ObjectState::print() const {
+  initialize();
   llvm::errs() << "-- ObjectState --\n";
   llvm::errs() << "\tMemoryObject ID: " << object->id << "\n";
   llvm::errs() << "\tRoot Object: " << updates.root << "\n";
@@ -13,6 +13,9 @@
 #include "Context.h"
 #include "TimingSolver.h"
 
+#include "MemoryArena.h"
+
+#include "klee/ADT/PagedArray.h"
 #include "klee/Expr/Expr.h"
 
 #include "llvm/ADT/StringExtras.h"
@@ -27,7 +30,6 @@ namespace llvm {
 namespace klee {
 
 class ArrayCache;
-class BitArray;
 class ExecutionState;
 class MemoryManager;
 class Solver;
@@ -105,6 +107,13 @@ public:
 
   ~MemoryObject();
 
+  static void *operator new(size_t size) {
+    return ArenaAllocator::allocate(size);
+  }
+  static void operator delete(void *p, size_t size) {
+    ArenaAllocator::deallocate(p, size);
+  }
+
   /// Get an identifying string for this allocation.
   void getAllocInfo(std::string &result) const;
 
@@ -169,6 +178,9 @@ public:
 class ObjectState {
 private:
   friend class AddressSpace;
+  friend class SnapshotReader;
+  friend class SnapshotStore;
+  friend class SnapshotWriter;
   friend class ref<ObjectState>;
 
   unsigned copyOnWriteOwner; // exclusively for AddressSpace
@@ -178,19 +190,50 @@ private:
 
   ref<const MemoryObject> object;
 
-  uint8_t *concreteStore;
+  // The contents are stored in pages that are shared between copies of an
+  // object state until they are written to. All of them, like the object
+  // state itself, live in the memory arena.
+  //
+  // Only what the contents need is allocated: while all bytes are concrete
+  // only concreteStore exists, and the masks and knownSymbolics are null.
+  // An object that was made symbolic as a whole (allSymbolic) only has its
+  // updates, until a byte is written at a concrete offset. Only objects
+  // with a mix of concrete and symbolic bytes use all of them.
+  typedef PagedArray<uint8_t, ArenaAllocator> ByteArray;
+  typedef BasicPagedBitArray<ArenaAllocator> BitMask;
+  typedef PagedArray<ref<Expr>, ArenaAllocator> ExprArray;
+
+  // mutable because symbolic bytes may be concretized in a const object
+  mutable ByteArray concreteStore;
 
   // XXX cleanup name of flushMask (its backwards or something)
-  BitArray *concreteMask;
+  BitMask *concreteMask;
 
   // mutable because may need flushed during read of const
-  mutable BitArray *flushMask;
+  mutable BitMask *flushMask;
 
-  ref<Expr> *knownSymbolics;
+  ExprArray *knownSymbolics;
+
+  // All bytes are read from the updates, and concreteStore may be empty.
+  // mutable because the concrete store may be materialized in a const object
+  mutable bool allSymbolic;
+
+  // The contents are provided by the object initializer of the memory
+  // manager when they are first used, and concreteStore is empty until
+  // then. mutable because the contents may be initialized in a const object
+  mutable bool lazy;
+
+  // The length of the updates after they were last compacted.
+  mutable unsigned compactedSize;
 
   // mutable because we may need flush during read of const
   mutable UpdateList updates;
 
+  // An index of the updates by concrete offset, built on demand for long
+  // update lists.
+  struct UpdateIndex;
+  mutable UpdateIndex *updateIndex;
+
 public:
   unsigned size;
 
@@ -209,6 +252,13 @@ public:
   ObjectState(const ObjectState &os);
   ~ObjectState();
 
+  static void *operator new(size_t size) {
+    return ArenaAllocator::allocate(size);
+  }
+  static void operator delete(void *p, size_t size) {
+    ArenaAllocator::deallocate(p, size);
+  }
+
   const MemoryObject *getObject() const { return object.get(); }
 
   void setReadOnly(bool ro) { readOnly = ro; }
@@ -217,6 +267,15 @@ public:
   void initializeToZero();
   // make contents all concrete and random
   void initializeToRandom();
+  // make contents all concrete, as provided by the object initializer of
+  // the memory manager on first use
+  void initializeLazily();
+
+  bool isLazy() const { return lazy; }
+
+  /// Share the contents of a read-only object with the other read-only
+  /// objects that have the same contents.
+  void internContents();
 
   ref<Expr> read(ref<Expr> offset, Expr::Width width) const;
   ref<Expr> read(unsigned offset, Expr::Width width) const;
@@ -230,6 +289,15 @@ public:
   void write16(unsigned offset, uint16_t value);
   void write32(unsigned offset, uint32_t value);
   void write64(unsigned offset, uint64_t value);
+
+  /// Copy \a count bytes at \a srcOffset of \a src to \a offset. As with
+  /// memmove, the ranges may overlap if \a src is this object state.
+  void copyBytes(unsigned offset, const ObjectState &src, unsigned srcOffset,
+                 unsigned count);
+
+  /// Set \a count bytes at \a offset to the byte \a value.
+  void fillBytes(unsigned offset, ref<Expr> value, unsigned count);
+
   void print() const;
 
   /*
@@ -239,13 +307,60 @@ public:
   void flushToConcreteStore(TimingSolver *solver,
                             const ExecutionState &state) const;
 
+  /// Copy the concrete contents to \a dest.
+  void copyOutConcreteStore(uint8_t *dest) const;
+
+  /// Check whether the concrete contents are equal to those at \a src.
+  bool equalsConcreteStore(const uint8_t *src) const;
+
+  /// Replace the concrete contents with those at \a src.
+  void copyInConcreteStore(const uint8_t *src);
+
 private:
+  /// Create an object state with the given updates and no other contents,
+  /// to be filled in by SnapshotReader.
+  ObjectState(const MemoryObject *mo, const UpdateList &updates);
+
   const UpdateList &getUpdates() const;
 
+  /// Create a constant array with the given contents for the updates.
+  const Array *
+  createConstantArray(const std::vector<ref<ConstantExpr> > &contents) const;
+
+  /// Drop the updates that are overwritten at the same concrete offset
+  /// before any write at a symbolic offset, and fold the updates at
+  /// concrete offsets that precede all writes at symbolic offsets into a
+  /// new constant array.
+  void compactUpdates() const;
+
+  /// Read the byte at \a offset from the updates, using the index for long
+  /// update lists instead of walking them.
+  ref<Expr> readFromUpdates(unsigned offset) const;
+
+  /// Provide the contents of a lazily initialized object.
+  void initialize() const {
+    if (lazy)
+      runInitializer();
+  }
+  void runInitializer() const;
+
   void makeConcrete();
 
   void makeSymbolic();
 
+  /// Switch an allSymbolic object to the general representation, with
+  /// every byte marked symbolic and flushed.
+  void makeMixed();
+
+  /// Allocate the concrete store of an allSymbolic object, which has
+  /// undefined (zero) contents.
+  void materializeConcreteStore() const;
+
+  /// Whether all bytes are concrete and can be read from concreteStore.
+  bool isFullyConcrete() const {
+    return !allSymbolic && !concreteMask && !knownSymbolics;
+  }
+
   ref<Expr> read8(ref<Expr> offset) const;
   void write8(unsigned offset, ref<Expr> value);
   void write8(ref<Expr> offset, ref<Expr> value);
@@ -264,6 +379,8 @@ private:
   void markByteFlushed(unsigned offset);
   void markByteUnflushed(unsigned offset);
   void setKnownSymbolic(unsigned offset, Expr *value);
+  // const because symbolic bytes may be concretized in a const object
+  void setConcreteByte(unsigned offset, uint8_t value) const;
 
   ArrayCache *getArrayCache() const;
 };
@@ -0,0 +1,155 @@
+//===-- MemoryArena.cpp ---------------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "MemoryArena.h"
+
+#include "klee/Support/ErrorHandling.h"
+
+#include <cassert>
+#include <cstdlib>
+#include <new>
+
+using namespace klee;
+
+constexpr size_t MemoryArena::ChunkSize;
+constexpr size_t MemoryArena::Granularity;
+constexpr size_t MemoryArena::MaxSlotSize;
+
+/// The header at the start of every chunk. Chunks are aligned to their
+/// size, so the chunk of a slot is found by masking its address.
+struct MemoryArena::Chunk {
+  /// Links of the list of chunks with free slots in the size class.
+  Chunk *prev, *next;
+  /// Slots that were freed, linked through their first word.
+  void *freeList;
+  /// The slots that were never used start here.
+  char *unused;
+  unsigned sizeClass;
+  unsigned slotSize;
+  unsigned capacity;
+  unsigned used;
+};
+
+MemoryArena::Chunk *MemoryArena::createChunk(unsigned sizeClass) {
+  const size_t HeaderSize =
+      (sizeof(Chunk) + Granularity - 1) & ~(Granularity - 1);
+
+  void *memory = spare;
+  if (memory) {
+    spare->~Chunk();
+    spare = nullptr;
+  } else {
+    if (posix_memalign(&memory, ChunkSize, ChunkSize))
+      klee_error("Could not allocate memory arena chunk");
+    bytesReserved += ChunkSize;
+  }
+
+  Chunk *chunk = new (memory) Chunk();
+  chunk->freeList = nullptr;
+  chunk->unused = static_cast<char *>(memory) + HeaderSize;
+  chunk->sizeClass = sizeClass;
+  chunk->slotSize = (sizeClass + 1) * Granularity;
+  chunk->capacity = (ChunkSize - HeaderSize) / chunk->slotSize;
+  chunk->used = 0;
+
+  SizeClass &c = classes[sizeClass];
+  chunk->prev = nullptr;
+  chunk->next = c.available;
+  if (c.available)
+    c.available->prev = chunk;
+  c.available = chunk;
+  return chunk;
+}
+
+void MemoryArena::releaseChunk(Chunk *chunk) {
+  assert(chunk->used == 0 && "releasing chunk in use");
+  SizeClass &c = classes[chunk->sizeClass];
+  if (chunk->prev)
+    chunk->prev->next = chunk->next;
+  else
+    c.available = chunk->next;
+  if (chunk->next)
+    chunk->next->prev = chunk->prev;
+
+  if (!spare) {
+    spare = chunk;
+    return;
+  }
+  chunk->~Chunk();
+  free(chunk);
+  bytesReserved -= ChunkSize;
+}
+
+void *MemoryArena::allocate(size_t size) {
+  if (size > MaxSlotSize) {
+    bytesAllocated += size;
+    bytesReserved += size;
+    return ::operator new(size);
+  }
+
+  SizeClass &c = classes[getSizeClass(size)];
+  Chunk *chunk = c.available;
+  if (!chunk)
+    chunk = createChunk(getSizeClass(size));
+
+  void *p;
+  if (chunk->freeList) {
+    p = chunk->freeList;
+    chunk->freeList = *static_cast<void **>(p);
+  } else {
+    p = chunk->unused;
+    chunk->unused += chunk->slotSize;
+  }
+  bytesAllocated += chunk->slotSize;
+
+  // A full chunk leaves the list until one of its slots is freed.
+  if (++chunk->used == chunk->capacity) {
+    c.available = chunk->next;
+    if (chunk->next)
+      chunk->next->prev = nullptr;
+  }
+  return p;
+}
+
+void MemoryArena::deallocate(void *p, size_t size) {
+  if (size > MaxSlotSize) {
+    bytesAllocated -= size;
+    bytesReserved -= size;
+    ::operator delete(p);
+    return;
+  }
+
+  Chunk *chunk = reinterpret_cast<Chunk *>(reinterpret_cast<uintptr_t>(p) &
+                                           ~(uintptr_t)(ChunkSize - 1));
+  assert(chunk->sizeClass == getSizeClass(size) && "size class mismatch");
+  SizeClass &c = classes[chunk->sizeClass];
+
+  *static_cast<void **>(p) = chunk->freeList;
+  chunk->freeList = p;
+  bytesAllocated -= chunk->slotSize;
+
+  if (chunk->used-- == chunk->capacity) {
+    chunk->prev = nullptr;
+    chunk->next = c.available;
+    if (c.available)
+      c.available->prev = chunk;
+    c.available = chunk;
+  }
+
+  // Release empty chunks. One of them is kept as a spare, so that an
+  // object that is allocated and freed repeatedly does not take a chunk
+  // from the system every time.
+  if (chunk->used == 0)
+    releaseChunk(chunk);
+}
+
+MemoryArena &MemoryArena::get() {
+  static MemoryArena *arena = new MemoryArena();
+  return *arena;
+}
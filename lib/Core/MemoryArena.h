@@ -0,0 +1,87 @@
+//===-- MemoryArena.h -------------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_MEMORYARENA_H
+#define KLEE_MEMORYARENA_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace klee {
+
+/// MemoryArena - A slab allocator for the many small objects that make up
+/// the memory of execution states: memory objects, object states and the
+/// pages of their contents.
+///
+/// Allocations are grouped by size class into chunks of ChunkSize bytes. A
+/// chunk is returned to the system as soon as all of its slots are free
+/// (except for a single spare chunk), so terminating states releases whole
+/// chunks rather than leaving behind a fragmented heap. Allocations larger
+/// than MaxSlotSize go to the global heap, but are still accounted for.
+class MemoryArena {
+public:
+  static constexpr size_t ChunkSize = 64 * 1024;
+  static constexpr size_t Granularity = 16;
+  static constexpr size_t MaxSlotSize = 8 * 1024;
+
+private:
+  struct Chunk;
+
+  /// The chunks of a size class that have free slots.
+  struct SizeClass {
+    Chunk *available = nullptr;
+  };
+
+  SizeClass classes[MaxSlotSize / Granularity];
+
+  /// An empty chunk that is kept for the next size class that needs one.
+  Chunk *spare = nullptr;
+
+  /// Bytes of all live allocations, rounded up to their size classes.
+  size_t bytesAllocated = 0;
+  /// Bytes taken from the system, i.e. all chunks and large allocations.
+  size_t bytesReserved = 0;
+
+  static unsigned getSizeClass(size_t size) {
+    return (size + Granularity - 1) / Granularity - 1;
+  }
+
+  Chunk *createChunk(unsigned sizeClass);
+  void releaseChunk(Chunk *chunk);
+
+public:
+  MemoryArena() = default;
+  MemoryArena(const MemoryArena &) = delete;
+  MemoryArena &operator=(const MemoryArena &) = delete;
+
+  void *allocate(size_t size);
+  void deallocate(void *p, size_t size);
+
+  size_t getBytesAllocated() const { return bytesAllocated; }
+  size_t getBytesReserved() const { return bytesReserved; }
+
+  /// The arena shared by all execution states. It is never destroyed, as
+  /// objects may be released during static destruction.
+  static MemoryArena &get();
+};
+
+/// ArenaAllocator - An allocation policy for PagedArray and class-specific
+/// operator new that takes memory from the shared MemoryArena.
+struct ArenaAllocator {
+  static void *allocate(size_t size) {
+    return MemoryArena::get().allocate(size);
+  }
+  static void deallocate(void *p, size_t size) {
+    MemoryArena::get().deallocate(p, size);
+  }
+};
+
+} // End klee namespace
+
+#endif /* KLEE_MEMORYARENA_H */
@@ -11,6 +11,7 @@
 
 #include "CoreStats.h"
 #include "Memory.h"
+#include "MemoryArena.h"
 
 #include "klee/Expr/Expr.h"
 #include "klee/Support/ErrorHandling.h"
@@ -20,6 +21,7 @@
 
 #include <inttypes.h>
 #include <sys/mman.h>
+#include <vector>
 
 using namespace klee;
 
@@ -60,7 +62,9 @@ llvm::cl::opt<unsigned long long> DeterministicStartAddress(
 
 /***/
 MemoryManager::MemoryManager(ArrayCache *_arrayCache)
-    : arrayCache(_arrayCache), deterministicSpace(0), nextFreeSlot(0),
+    : arrayCache(_arrayCache), objectInitializer(0), heapSize(0),
+      deterministicSpace(0),
+      nextFreeSlot(0),
       spaceSize(DeterministicAllocationSize.getValue() * 1024 * 1024) {
   if (DeterministicAllocation) {
     // Page boundary
@@ -150,6 +154,8 @@ MemoryObject *MemoryManager::allocate(uint64_t size, bool isLocal,
   if (!address)
     return 0;
 
+  if (!DeterministicAllocation)
+    heapSize += size;
   ++stats::allocations;
   MemoryObject *res = new MemoryObject(address, size, isLocal, isGlobal, false,
                                        allocSite, this);
@@ -179,8 +185,10 @@ void MemoryManager::deallocate(const MemoryObject *mo) { assert(0); }
 
 void MemoryManager::markFreed(MemoryObject *mo) {
   if (objects.find(mo) != objects.end()) {
-    if (!mo->isFixed && !DeterministicAllocation)
+    if (!mo->isFixed && !DeterministicAllocation) {
       free((void *)mo->address);
+      heapSize -= mo->size;
+    }
     objects.erase(mo);
   }
 }
@@ -188,3 +196,30 @@ void MemoryManager::markFreed(MemoryObject *mo) {
 size_t MemoryManager::getUsedDeterministicSize() {
   return nextFreeSlot - deterministicSpace;
 }
+
+void MemoryManager::internReadOnlyContents(
+    PagedArray<uint8_t, ArenaAllocator> &contents) {
+  std::vector<uint8_t> bytes(contents.getSize());
+  contents.copyOut(bytes.data());
+
+  // FNV-1a
+  uint64_t hash = 14695981039346656037ULL;
+  for (uint8_t byte : bytes)
+    hash = (hash ^ byte) * 1099511628211ULL;
+
+  auto range = readOnlyContents.equal_range(hash);
+  for (auto it = range.first; it != range.second; ++it) {
+    if (it->second.getSize() == bytes.size() &&
+        it->second.equals(bytes.data())) {
+      contents = it->second;
+      stats::objectStatePagesShared += contents.getNumPages();
+      return;
+    }
+  }
+  readOnlyContents.emplace(hash, contents);
+}
+
+size_t MemoryManager::getUsedSize() {
+  return heapSize + getUsedDeterministicSize() +
+         MemoryArena::get().getBytesReserved();
+}
@@ -10,9 +10,15 @@
 #ifndef KLEE_MEMORYMANAGER_H
 #define KLEE_MEMORYMANAGER_H
 
+#include "MemoryArena.h"
+
+#include "klee/ADT/PagedArray.h"
+
+#include "llvm/ADT/DenseSet.h"
+
 #include <cstddef>
-#include <set>
 #include <cstdint>
+#include <unordered_map>
 
 namespace llvm {
 class Value;
@@ -20,13 +26,32 @@ class Value;
 
 namespace klee {
 class MemoryObject;
+class ObjectState;
 class ArrayCache;
 
+/// ObjectInitializer - Provides the contents of lazily initialized object
+/// states when they are first used.
+class ObjectInitializer {
+public:
+  virtual ~ObjectInitializer() = default;
+
+  /// Write the initial contents of the object to \a os, which is all zero.
+  virtual void initialize(ObjectState &os) = 0;
+};
+
 class MemoryManager {
 private:
-  typedef std::set<MemoryObject *> objects_ty;
+  typedef llvm::DenseSet<MemoryObject *> objects_ty;
   objects_ty objects;
   ArrayCache *const arrayCache;
+  ObjectInitializer *objectInitializer;
+
+  /// The contents of read-only objects by their hash.
+  std::unordered_multimap<uint64_t, PagedArray<uint8_t, ArenaAllocator> >
+      readOnlyContents;
+
+  /// Bytes of program memory taken from the heap for live objects.
+  size_t heapSize;
 
   char *deterministicSpace;
   char *nextFreeSlot;
@@ -48,10 +73,26 @@ public:
   void markFreed(MemoryObject *mo);
   ArrayCache *getArrayCache() const { return arrayCache; }
 
+  /// Make \a contents of a read-only object share the pages of earlier
+  /// read-only contents that are equal to them, if there are any.
+  void internReadOnlyContents(PagedArray<uint8_t, ArenaAllocator> &contents);
+
+  ObjectInitializer *getObjectInitializer() const { return objectInitializer; }
+  void setObjectInitializer(ObjectInitializer *initializer) {
+    objectInitializer = initializer;
+  }
+
   /*
    * Returns the size used by deterministic allocation in bytes
    */
   size_t getUsedDeterministicSize();
+
+  /*
+   * Returns the memory used by all live objects in bytes: their program
+   * memory, and the memory arena holding their metadata and contents.
+   * This is cheap to compute.
+   */
+  size_t getUsedSize();
 };
 
 } // End klee namespace
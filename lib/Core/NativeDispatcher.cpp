@@ -0,0 +1,323 @@
+//===-- NativeDispatcher.cpp ----------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "NativeDispatcher.h"
+
+#include "klee/Support/ErrorHandling.h"
+
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/ExecutionEngine/ExecutionEngine.h"
+#include "llvm/ExecutionEngine/MCJIT.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DebugInfo.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Intrinsics.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include "llvm/Transforms/Utils/ValueMapper.h"
+
+#include <csetjmp>
+#include <csignal>
+
+using namespace llvm;
+using namespace klee;
+
+/***/
+
+static sigjmp_buf escapeNativeCallJmpBuf;
+
+extern "C" {
+
+static void native_sigsegv_handler(int signal, siginfo_t *info,
+                                   void *context) {
+  siglongjmp(escapeNativeCallJmpBuf, 1);
+}
+
+/// Called by native code in place of the functions that report errors.
+static void native_escape() { siglongjmp(escapeNativeCallJmpBuf, 1); }
+}
+
+// Native code that calls one of these gives up, so that the call is
+// interpreted and the error reported by the executor.
+static const char *escapeFunctionsList[] = {"abort", "__assert_fail",
+                                            "klee_abort", "klee_report_error"};
+
+static bool isEscapeFunction(const Function *f) {
+  for (const char *name : escapeFunctionsList)
+    if (f->getName() == name)
+      return true;
+  return false;
+}
+
+// Whether values of type t are passed the same way to native code and to
+// the executor.
+static bool isPassable(Type *t) {
+  return t->isPointerTy() ||
+         (t->isIntegerTy() && t->getPrimitiveSizeInBits() <= 64);
+}
+
+static bool refersToFunction(const Value *v) {
+  if (isa<Function>(v))
+    return true;
+  if (const GlobalAlias *ga = dyn_cast<GlobalAlias>(v))
+    return refersToFunction(ga->getAliasee());
+  // The initializers of global variables do not matter, as the native code
+  // uses the executor's memory for them.
+  if (isa<GlobalValue>(v) || !isa<Constant>(v))
+    return false;
+  for (const Use &op : cast<Constant>(v)->operands())
+    if (refersToFunction(op.get()))
+      return true;
+  return false;
+}
+
+/***/
+
+NativeDispatcher::NativeDispatcher(Module &module,
+                                   AddressResolver resolveAddress)
+    : module(module), resolveAddress(std::move(resolveAddress)) {}
+
+NativeDispatcher::~NativeDispatcher() = default;
+
+std::string NativeDispatcher::collect(const Function *f) {
+  if (!compiled.insert(f).second)
+    return "";
+
+  std::string name = f->getName().str();
+  if (f->isDeclaration())
+    return "calls the undefined function " + name;
+  if (f->isVarArg())
+    return "calls the variadic function " + name;
+
+  for (const BasicBlock &bb : *f) {
+    for (const Instruction &inst : bb) {
+      if (isa<InvokeInst>(inst) || isa<LandingPadInst>(inst) ||
+          isa<ResumeInst>(inst))
+        return "uses exceptions in " + name;
+      if (isa<VAArgInst>(inst))
+        return "uses variable arguments in " + name;
+
+      unsigned numOperands = inst.getNumOperands();
+      if (const CallInst *ci = dyn_cast<CallInst>(&inst)) {
+        if (ci->isInlineAsm())
+          return "uses inline assembly in " + name;
+        const Function *callee =
+            dyn_cast<Function>(ci->getCalledValue()->stripPointerCasts());
+        if (!callee)
+          return "makes an indirect call in " + name;
+
+        if (callee->isIntrinsic()) {
+          switch (callee->getIntrinsicID()) {
+          case Intrinsic::vastart:
+          case Intrinsic::vaend:
+          case Intrinsic::vacopy:
+            return "uses variable arguments in " + name;
+          default:
+            break;
+          }
+        } else if (!isEscapeFunction(callee)) {
+          std::string reason = collect(callee);
+          if (!reason.empty())
+            return reason;
+        }
+        // The callee is the last operand
+        numOperands = ci->getNumArgOperands();
+      }
+
+      for (unsigned i = 0; i < numOperands; ++i)
+        if (refersToFunction(inst.getOperand(i)))
+          return "uses a function pointer in " + name;
+    }
+  }
+
+  return "";
+}
+
+std::string NativeDispatcher::addFunction(const Function *f) {
+  if (entryPoints.count(f))
+    return "";
+
+  FunctionType *type = f->getFunctionType();
+  if (!type->getReturnType()->isVoidTy() &&
+      !isPassable(type->getReturnType()))
+    return "returns a value of an unsupported type";
+  for (Type *param : type->params())
+    if (!isPassable(param))
+      return "takes an argument of an unsupported type";
+
+  std::set<const Function *> previous = compiled;
+  std::string reason = collect(f);
+  if (!reason.empty()) {
+    compiled = std::move(previous);
+    return reason;
+  }
+
+  entryPoints.insert(f);
+  reset();
+  return "";
+}
+
+void NativeDispatcher::reset() {
+  stubs.clear();
+  executionEngine.reset();
+}
+
+bool NativeDispatcher::compile() {
+  LLVMContext &ctx = module.getContext();
+  std::unique_ptr<Module> native(new Module("NativeDispatcherModule", ctx));
+  native->setDataLayout(module.getDataLayout());
+  native->setTargetTriple(module.getTargetTriple());
+
+  ValueToValueMapTy vmap;
+  std::vector<std::pair<const GlobalValue *, uint64_t> > mappings;
+
+  // The globals are declared under fresh names and mapped to the addresses
+  // the executor allocated them at.
+  unsigned id = 0;
+  auto declare = [&](const GlobalValue &gv) {
+    GlobalVariable *decl = new GlobalVariable(
+        *native, gv.getValueType(), false, GlobalValue::ExternalLinkage,
+        nullptr, "klee_native_global_" + llvm::utostr(id++));
+    vmap[&gv] = decl;
+    mappings.emplace_back(decl, resolveAddress(&gv));
+  };
+  for (const GlobalVariable &gv : module.globals())
+    declare(gv);
+  for (const GlobalAlias &ga : module.aliases())
+    if (!refersToFunction(&ga))
+      declare(ga);
+
+  for (const Function *f : compiled) {
+    Function *clone = Function::Create(f->getFunctionType(),
+                                       GlobalValue::InternalLinkage,
+                                       f->getName(), native.get());
+    clone->copyAttributesFrom(f);
+    clone->setLinkage(GlobalValue::InternalLinkage);
+    vmap[f] = clone;
+  }
+
+  for (const Function &f : module) {
+    if (compiled.count(&f))
+      continue;
+    if (f.isIntrinsic()) {
+      vmap[&f] = Function::Create(f.getFunctionType(),
+                                  GlobalValue::ExternalLinkage, f.getName(),
+                                  native.get());
+    } else if (isEscapeFunction(&f)) {
+      Function *decl = Function::Create(
+          f.getFunctionType(), GlobalValue::ExternalLinkage,
+          "klee_native_escape_" + f.getName().str(), native.get());
+      vmap[&f] = decl;
+      mappings.emplace_back(decl, reinterpret_cast<uint64_t>(&native_escape));
+    }
+  }
+
+  for (const Function *f : compiled) {
+    Function *clone = cast<Function>(vmap[f]);
+    Function::arg_iterator cloneArg = clone->arg_begin();
+    for (const Argument &arg : f->args())
+      vmap[&arg] = &*cloneArg++;
+
+    SmallVector<ReturnInst *, 8> returns;
+    CloneFunctionInto(clone, f, vmap, /*ModuleLevelChanges=*/true, returns);
+  }
+  StripDebugInfo(*native);
+
+  // Each entry point gets a stub that takes the arguments from, and
+  // writes the result to, the array of words prepared by the executor.
+  Type *wordType = Type::getInt64Ty(ctx);
+  FunctionType *stubType = FunctionType::get(
+      Type::getVoidTy(ctx), {PointerType::getUnqual(wordType)}, false);
+  std::map<const Function *, std::string> stubNames;
+  for (const Function *f : entryPoints) {
+    Function *target = cast<Function>(vmap[f]);
+    std::string stubName = "klee_native_stub_" + f->getName().str();
+    Function *stub = Function::Create(stubType, GlobalValue::ExternalLinkage,
+                                      stubName, native.get());
+    stubNames[f] = stub->getName().str();
+
+    IRBuilder<> builder(BasicBlock::Create(ctx, "entry", stub));
+    Value *args = &*stub->arg_begin();
+    std::vector<Value *> params;
+    unsigned wordIndex = 2;
+    for (Type *type : target->getFunctionType()->params()) {
+      Value *word =
+          builder.CreateLoad(builder.CreateConstGEP1_32(args, wordIndex++));
+      params.push_back(type->isPointerTy() ? builder.CreateIntToPtr(word, type)
+                                           : builder.CreateTrunc(word, type));
+    }
+
+    CallInst *result = builder.CreateCall(target, params);
+    result->setCallingConv(target->getCallingConv());
+    Type *resultType = result->getType();
+    if (!resultType->isVoidTy()) {
+      Value *word = resultType->isPointerTy()
+                        ? builder.CreatePtrToInt(result, wordType)
+                        : builder.CreateZExt(result, wordType);
+      builder.CreateStore(word, args);
+    }
+    builder.CreateRetVoid();
+  }
+
+  std::string error;
+  executionEngine.reset(EngineBuilder(std::move(native))
+                            .setErrorStr(&error)
+                            .setEngineKind(EngineKind::JIT)
+                            .create());
+  if (!executionEngine) {
+    klee_warning("unable to compile functions for native execution: %s",
+                 error.c_str());
+    // Do not try again on every call
+    entryPoints.clear();
+    return false;
+  }
+
+  for (const auto &mapping : mappings)
+    executionEngine->addGlobalMapping(
+        mapping.first, reinterpret_cast<void *>(mapping.second));
+
+  for (const auto &stubName : stubNames)
+    stubs[stubName.first] = reinterpret_cast<void (*)(uint64_t *)>(
+        executionEngine->getFunctionAddress(stubName.second));
+  executionEngine->finalizeObject();
+
+  return true;
+}
+
+bool NativeDispatcher::executeCall(const Function *f, uint64_t *args) {
+  if (!executionEngine && !compile())
+    return false;
+
+  auto it = stubs.find(f);
+  if (it == stubs.end() || !it->second)
+    return false;
+  void (*stub)(uint64_t *) = it->second;
+
+  struct sigaction segvAction, segvActionOld;
+  bool res;
+
+  segvAction.sa_handler = nullptr;
+  sigemptyset(&(segvAction.sa_mask));
+  sigaddset(&(segvAction.sa_mask), SIGSEGV);
+  segvAction.sa_flags = SA_SIGINFO;
+  segvAction.sa_sigaction = ::native_sigsegv_handler;
+  sigaction(SIGSEGV, &segvAction, &segvActionOld);
+
+  if (sigsetjmp(escapeNativeCallJmpBuf, 1)) {
+    res = false;
+  } else {
+    stub(args);
+    res = true;
+  }
+
+  sigaction(SIGSEGV, &segvActionOld, nullptr);
+  return res;
+}
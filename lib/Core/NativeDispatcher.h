@@ -0,0 +1,105 @@
+//===-- NativeDispatcher.h --------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_NATIVEDISPATCHER_H
+#define KLEE_NATIVEDISPATCHER_H
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace llvm {
+class ExecutionEngine;
+class Function;
+class GlobalValue;
+class Module;
+}
+
+namespace klee {
+
+/// NativeDispatcher - Compiles functions of the module under test to
+/// native code with the MCJIT, so that calls to them can be executed
+/// natively rather than interpreted.
+///
+/// The native code works on the memory of the executor: the globals it
+/// refers to are resolved to the addresses the executor allocated them at,
+/// and the caller copies the concrete contents of the address space out
+/// before and back in after a call, as for external calls.
+///
+/// Only functions that are known to behave the same natively can be
+/// compiled: they and everything they call must be defined in the module,
+/// must not use function pointers (which the executor represents by the
+/// address of the llvm::Function) and must pass only integers and
+/// pointers. Calls that report errors (such as failed division by zero and
+/// overshift checks) abort the native execution instead, so that the
+/// caller can interpret the call to report them.
+class NativeDispatcher {
+public:
+  /// Returns the address of a global variable or alias in the executor's
+  /// memory.
+  typedef std::function<uint64_t(const llvm::GlobalValue *)> AddressResolver;
+
+private:
+  llvm::Module &module;
+  AddressResolver resolveAddress;
+
+  /// The functions that can be called natively.
+  std::set<const llvm::Function *> entryPoints;
+  /// The functions that are compiled: the entry points and their callees.
+  std::set<const llvm::Function *> compiled;
+
+  std::unique_ptr<llvm::ExecutionEngine> executionEngine;
+  /// The compiled stubs of the entry points, by entry point.
+  std::map<const llvm::Function *, void (*)(uint64_t *)> stubs;
+
+  /// Add \a f and its callees to \a compiled.
+  ///
+  /// \return An empty string on success, the reason why \a f cannot be
+  /// compiled otherwise.
+  std::string collect(const llvm::Function *f);
+
+  /// Compile the entry points.
+  bool compile();
+
+public:
+  NativeDispatcher(llvm::Module &module, AddressResolver resolveAddress);
+  ~NativeDispatcher();
+
+  NativeDispatcher(const NativeDispatcher &) = delete;
+  NativeDispatcher &operator=(const NativeDispatcher &) = delete;
+
+  /// Make calls to \a f native.
+  ///
+  /// \return An empty string on success, the reason why \a f cannot be
+  /// executed natively otherwise.
+  std::string addFunction(const llvm::Function *f);
+
+  bool hasFunction(const llvm::Function *f) const {
+    return entryPoints.count(f);
+  }
+
+  /// Drop the native code, e.g. because the globals moved. The functions
+  /// are compiled again when they are called next.
+  void reset();
+
+  /// Call \a f natively, passing its arguments in args[2], args[3], ...
+  /// and writing the result into args[0], as for external calls.
+  ///
+  /// \return False if the call did not complete, because it crashed or
+  /// tried to report an error.
+  bool executeCall(const llvm::Function *f, uint64_t *args);
+};
+
+} // End klee namespace
+
+#endif /* KLEE_NATIVEDISPATCHER_H */
@@ -0,0 +1,95 @@
+//===-- ParallelExploration.cpp -------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "ParallelExploration.h"
+
+#include "klee/Support/ErrorHandling.h"
+
+#include "llvm/Support/Errno.h"
+
+#include <cerrno>
+#include <new>
+
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace klee;
+
+ParallelExploration::ParallelExploration(SharedState *shared)
+    : shared(shared), worker(false) {}
+
+std::unique_ptr<ParallelExploration>
+ParallelExploration::create(unsigned jobs) {
+  void *mapping = mmap(nullptr, sizeof(SharedState), PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (mapping == MAP_FAILED)
+    return nullptr;
+
+  SharedState *shared = new (mapping) SharedState();
+  // This process takes the first slot.
+  shared->freeSlots = jobs - 1;
+  shared->halt = false;
+  return std::unique_ptr<ParallelExploration>(new ParallelExploration(shared));
+}
+
+ParallelExploration::~ParallelExploration() {
+  shared->~SharedState();
+  munmap(shared, sizeof(SharedState));
+}
+
+ParallelExploration::Side ParallelExploration::fork() {
+  int free = shared->freeSlots.load(std::memory_order_relaxed);
+  do {
+    if (free <= 0)
+      return Side::Failed;
+  } while (!shared->freeSlots.compare_exchange_weak(free, free - 1));
+
+  pid_t pid = ::fork();
+  if (pid == -1) {
+    klee_warning("fork failed (for parallel exploration) - %s",
+                 llvm::sys::StrError(errno).c_str());
+    ++shared->freeSlots;
+    return Side::Failed;
+  }
+  if (pid == 0) {
+    workers.clear();
+    worker = true;
+    return Side::Child;
+  }
+  workers.push_back(pid);
+  return Side::Parent;
+}
+
+bool ParallelExploration::checkHalt(bool halt) {
+  if (halt) {
+    shared->halt.store(true, std::memory_order_relaxed);
+    return true;
+  }
+  return shared->halt.load(std::memory_order_relaxed);
+}
+
+void ParallelExploration::finish(const std::function<void()> &whileWaiting) {
+  ++shared->freeSlots;
+
+  while (!workers.empty()) {
+    int status;
+    pid_t pid = waitpid(workers.back(), &status, WNOHANG);
+    if (pid == 0) {
+      whileWaiting();
+      usleep(100000);
+      continue;
+    }
+    if (pid == -1 && errno == EINTR)
+      continue;
+    if (pid != -1 && (!WIFEXITED(status) || WEXITSTATUS(status) != 0))
+      klee_warning("parallel exploration worker %d failed", (int)pid);
+    workers.pop_back();
+  }
+}
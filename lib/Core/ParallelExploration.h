@@ -0,0 +1,85 @@
+//===-- ParallelExploration.h -----------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_PARALLELEXPLORATION_H
+#define KLEE_PARALLELEXPLORATION_H
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <sys/types.h>
+
+namespace klee {
+
+/// ParallelExploration - Spreads the exploration of states over several
+/// worker processes.
+///
+/// Threads are not an option, as neither expressions nor the solver chains
+/// are thread-safe. Instead, a process with more than one state forks
+/// whenever fewer than the requested number of processes are exploring,
+/// and the two processes split its states between them. Forking copies the
+/// states together with everything they share, and a process that runs out
+/// of states frees its slot for the next split, so that busy processes hand
+/// over work as soon as there is capacity for it.
+///
+/// Besides the slots, the processes share halting: once one of them halts,
+/// all of them do. The process that started the exploration finishes only
+/// after all workers.
+class ParallelExploration {
+  struct SharedState {
+    std::atomic<int> freeSlots;
+    std::atomic<bool> halt;
+  };
+
+  SharedState *shared;
+  /// The workers forked by this process.
+  std::vector<pid_t> workers;
+  /// Whether this process is a worker rather than the original process.
+  bool worker;
+
+  explicit ParallelExploration(SharedState *shared);
+
+public:
+  /// Which process continues after a call to fork().
+  enum class Side { Failed, Parent, Child };
+
+  /// Set up an exploration with up to \a jobs processes, or return null if
+  /// the shared memory could not be allocated.
+  static std::unique_ptr<ParallelExploration> create(unsigned jobs);
+
+  ~ParallelExploration();
+
+  ParallelExploration(const ParallelExploration &) = delete;
+  ParallelExploration &operator=(const ParallelExploration &) = delete;
+
+  bool isWorker() const { return worker; }
+
+  /// Whether another worker could be started.
+  bool hasFreeSlot() const {
+    return shared->freeSlots.load(std::memory_order_relaxed) > 0;
+  }
+
+  /// Start a worker, which is a copy of this process.
+  Side fork();
+
+  /// Make \a halt known to all processes.
+  ///
+  /// \return True if any of the processes halted.
+  bool checkHalt(bool halt);
+
+  /// Stop exploring in this process: free its slot and wait for the workers
+  /// it started, calling \a whileWaiting from time to time.
+  void finish(const std::function<void()> &whileWaiting);
+};
+
+} // End klee namespace
+
+#endif /* KLEE_PARALLELEXPLORATION_H */
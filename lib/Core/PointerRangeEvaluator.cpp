@@ -0,0 +1,135 @@
+//===-- PointerRangeEvaluator.cpp -----------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "PointerRangeEvaluator.h"
+
+#include <algorithm>
+
+using namespace klee;
+
+PointerRange PointerRangeEvaluator::compute(const ref<Expr> &e) {
+  Expr::Width width = e->getWidth();
+
+  switch (e->getKind()) {
+  case Expr::Constant: {
+    uint64_t value = cast<ConstantExpr>(e)->getZExtValue();
+    return PointerRange(value, value);
+  }
+
+  case Expr::NotOptimized:
+  case Expr::ZExt:
+    return evaluate(e->getKid(0));
+
+  case Expr::SExt: {
+    Expr::Width srcWidth = e->getKid(0)->getWidth();
+    PointerRange src = evaluate(e->getKid(0));
+    uint64_t signBit = UINT64_C(1) << (srcWidth - 1);
+    if (src.second < signBit)
+      return src;
+    if (src.first >= signBit) {
+      uint64_t ext = ~bits64::maxValueOfNBits(srcWidth);
+      return PointerRange(mask(src.first | ext, width),
+                          mask(src.second | ext, width));
+    }
+    return full(width);
+  }
+
+  case Expr::Select: {
+    PointerRange t = evaluate(e->getKid(1)), f = evaluate(e->getKid(2));
+    return PointerRange(std::min(t.first, f.first),
+                        std::max(t.second, f.second));
+  }
+
+  case Expr::Concat: {
+    PointerRange l = evaluate(e->getKid(0)), r = evaluate(e->getKid(1));
+    Expr::Width rightWidth = e->getKid(1)->getWidth();
+    return PointerRange((l.first << rightWidth) | r.first,
+                        (l.second << rightWidth) | r.second);
+  }
+
+  case Expr::Extract: {
+    if (e->getKid(0)->getWidth() > 64)
+      return full(width);
+    PointerRange src = evaluate(e->getKid(0));
+    unsigned offset = cast<ExtractExpr>(e)->offset;
+    uint64_t low = src.first >> offset, high = src.second >> offset;
+    if (width == 64 || (low >> width) == (high >> width))
+      return PointerRange(mask(low, width), mask(high, width));
+    return full(width);
+  }
+
+  case Expr::Add: {
+    PointerRange l = evaluate(e->getKid(0)), r = evaluate(e->getKid(1));
+    uint64_t low, high;
+    bool carryLow = addWithCarry(l.first, r.first, width, low);
+    bool carryHigh = addWithCarry(l.second, r.second, width, high);
+    if (carryLow == carryHigh)
+      return PointerRange(low, high);
+    return full(width);
+  }
+
+  case Expr::Sub: {
+    PointerRange l = evaluate(e->getKid(0)), r = evaluate(e->getKid(1));
+    bool borrowLow = l.first < r.second, borrowHigh = l.second < r.first;
+    if (borrowLow == borrowHigh)
+      return PointerRange(mask(l.first - r.second, width),
+                          mask(l.second - r.first, width));
+    return full(width);
+  }
+
+  case Expr::Mul: {
+    PointerRange l = evaluate(e->getKid(0)), r = evaluate(e->getKid(1));
+    if (r.second && l.second > bits64::maxValueOfNBits(width) / r.second)
+      return full(width);
+    return PointerRange(l.first * r.first, l.second * r.second);
+  }
+
+  case Expr::Shl: {
+    PointerRange l = evaluate(e->getKid(0)), r = evaluate(e->getKid(1));
+    if (r.first != r.second || r.first >= width)
+      return full(width);
+    if (r.first && (l.second >> (width - r.first)))
+      return full(width);
+    return PointerRange(l.first << r.first, l.second << r.first);
+  }
+
+  case Expr::LShr: {
+    PointerRange l = evaluate(e->getKid(0)), r = evaluate(e->getKid(1));
+    if (r.first != r.second || r.first >= width)
+      return PointerRange(0, l.second);
+    return PointerRange(l.first >> r.first, l.second >> r.first);
+  }
+
+  // Division by zero yields all ones, and the remainder of it is the
+  // dividend, so a divisor that may be zero bounds nothing.
+  case Expr::UDiv: {
+    PointerRange l = evaluate(e->getKid(0)), r = evaluate(e->getKid(1));
+    if (!r.first)
+      return full(width);
+    return PointerRange(l.first / r.second, l.second / r.first);
+  }
+
+  case Expr::URem: {
+    PointerRange l = evaluate(e->getKid(0)), r = evaluate(e->getKid(1));
+    if (!r.first)
+      return full(width);
+    if (l.second >= r.second)
+      return PointerRange(0, r.second - 1);
+    return PointerRange(0, l.second);
+  }
+
+  case Expr::And: {
+    PointerRange l = evaluate(e->getKid(0)), r = evaluate(e->getKid(1));
+    return PointerRange(0, std::min(l.second, r.second));
+  }
+
+  default:
+    return full(width);
+  }
+}
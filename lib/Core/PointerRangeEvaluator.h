@@ -0,0 +1,65 @@
+//===-- PointerRangeEvaluator.h ---------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_POINTERRANGEEVALUATOR_H
+#define KLEE_POINTERRANGEEVALUATOR_H
+
+#include "klee/ADT/Bits.h"
+#include "klee/Expr/Expr.h"
+#include "klee/Expr/ExprHashMap.h"
+
+#include <cstdint>
+#include <utility>
+
+namespace klee {
+
+typedef std::pair<uint64_t, uint64_t> PointerRange;
+
+/// PointerRangeEvaluator - Computes a conservative range [min, max] of the
+/// unsigned values of an expression, without consulting the solver. Reads
+/// of symbolic bytes can take any value, so this is mostly useful for
+/// pointers that are a known base plus a bounded offset.
+class PointerRangeEvaluator {
+  ExprHashMap<PointerRange> cache;
+
+  static PointerRange full(Expr::Width width) {
+    return PointerRange(0, bits64::maxValueOfNBits(width));
+  }
+
+  static uint64_t mask(uint64_t value, Expr::Width width) {
+    return value & bits64::maxValueOfNBits(width);
+  }
+
+  /// Add with the carry out of bit \a width.
+  static bool addWithCarry(uint64_t a, uint64_t b, Expr::Width width,
+                           uint64_t &sum) {
+    sum = a + b;
+    bool carry = width == 64 ? sum < a : (sum >> width) != 0;
+    sum = mask(sum, width);
+    return carry;
+  }
+
+  PointerRange compute(const ref<Expr> &e);
+
+public:
+  PointerRange evaluate(const ref<Expr> &e) {
+    if (e->getWidth() > 64)
+      return full(64);
+    auto it = cache.find(e);
+    if (it != cache.end())
+      return it->second;
+    PointerRange range = compute(e);
+    cache.insert(std::make_pair(e, range));
+    return range;
+  }
+};
+
+} // namespace klee
+
+#endif /* KLEE_POINTERRANGEEVALUATOR_H */
@@ -50,6 +50,14 @@ cl::opt<bool>
                               "condition given to klee_assume() rather than "
                               "emitting an error (default=false)"),
                      cl::cat(TerminationCat));
+
+cl::opt<bool>
+    BulkMemoryOps("bulk-memory-ops", cl::init(true),
+                  cl::desc("Execute memcpy, memmove and memset on whole "
+                           "objects rather than byte by byte, when their "
+                           "pointers and sizes are concrete and in bounds "
+                           "(default=true)"),
+                  cl::cat(MiscCat));
 } // namespace
 
 /// \todo Almost all of the demands in this file should be replaced
@@ -206,6 +214,20 @@ void SpecialFunctionHandler::bind() {
     if (f && (!hi.doNotOverride || f->isDeclaration()))
       handlers[f] = std::make_pair(hi.handler, hi.hasReturnValue);
   }
+
+  if (BulkMemoryOps) {
+    // memcpy also serves memmove, as it copies through a buffer anyway
+    static const std::pair<const char *, FastPath> fastPathInfo[] = {
+      { "memcpy", &SpecialFunctionHandler::handleMemcpy },
+      { "memmove", &SpecialFunctionHandler::handleMemcpy },
+      { "memset", &SpecialFunctionHandler::handleMemset },
+    };
+    for (const auto &fp : fastPathInfo) {
+      Function *f = executor.kmodule->module->getFunction(fp.first);
+      if (f && !f->isDeclaration() && f->arg_size() == 3)
+        fastPaths[f] = fp.second;
+    }
+  }
 }
 
 
@@ -230,6 +252,16 @@ bool SpecialFunctionHandler::handle(ExecutionState &state,
   }
 }
 
+bool SpecialFunctionHandler::handleFastPath(ExecutionState &state,
+                                            Function *f,
+                                            KInstruction *target,
+                                            std::vector<ref<Expr> > &arguments) {
+  fast_paths_ty::iterator it = fastPaths.find(f);
+  if (it == fastPaths.end())
+    return false;
+  return (this->*(it->second))(state, target, arguments);
+}
+
 /****/
 
 // reads a concrete string from memory
@@ -282,6 +314,23 @@ SpecialFunctionHandler::readStringAtAddress(ExecutionState &state,
   return buf.str();
 }
 
+bool SpecialFunctionHandler::resolveRange(
+    ExecutionState &state, ref<Expr> address, uint64_t count,
+    std::pair<const MemoryObject *, const ObjectState *> &op,
+    unsigned &offset) {
+  address = executor.toUnique(state, address);
+  if (!isa<ConstantExpr>(address) ||
+      !state.addressSpace.resolveOne(cast<ConstantExpr>(address), op))
+    return false;
+
+  const MemoryObject *mo = op.first;
+  uint64_t start = cast<ConstantExpr>(address)->getZExtValue() - mo->address;
+  if (count > mo->size || start > mo->size - count)
+    return false;
+  offset = start;
+  return true;
+}
+
 /****/
 
 void SpecialFunctionHandler::handleAbort(ExecutionState &state,
@@ -885,4 +934,63 @@ void SpecialFunctionHandler::handleTypecheck(
     std::vector<ref<Expr>> &arguments) {
   assert(arguments.size() == 2);
   executor.polycheck->handleTypecheck(state, executor, target, arguments[0], arguments[1]);
-}
\ No newline at end of file
+}
+
+// Bulk memory operations. They only handle calls that stay within single
+// objects and have a concrete size, which takes a single bounds check;
+// anything else, including every memory error, is left to the library
+// implementation.
+
+bool SpecialFunctionHandler::handleMemcpy(ExecutionState &state,
+                                          KInstruction *target,
+                                          std::vector<ref<Expr> > &arguments) {
+  if (arguments.size() != 3)
+    return false;
+  ref<Expr> size = executor.toUnique(state, arguments[2]);
+  if (!isa<ConstantExpr>(size))
+    return false;
+  uint64_t count = cast<ConstantExpr>(size)->getZExtValue();
+
+  if (count) {
+    ObjectPair dest, src;
+    unsigned destOffset, srcOffset;
+    if (!resolveRange(state, arguments[0], count, dest, destOffset) ||
+        dest.second->readOnly ||
+        !resolveRange(state, arguments[1], count, src, srcOffset))
+      return false;
+
+    ObjectState *wos = state.addressSpace.getWriteable(dest.first, dest.second);
+    // getWriteable may have replaced the object state of the source
+    const ObjectState *ros = src.first == dest.first ? wos : src.second;
+    wos->copyBytes(destOffset, *ros, srcOffset, count);
+  }
+
+  executor.bindLocal(target, state, arguments[0]);
+  return true;
+}
+
+bool SpecialFunctionHandler::handleMemset(ExecutionState &state,
+                                          KInstruction *target,
+                                          std::vector<ref<Expr> > &arguments) {
+  if (arguments.size() != 3)
+    return false;
+  ref<Expr> size = executor.toUnique(state, arguments[2]);
+  if (!isa<ConstantExpr>(size))
+    return false;
+  uint64_t count = cast<ConstantExpr>(size)->getZExtValue();
+
+  if (count) {
+    ObjectPair dest;
+    unsigned destOffset;
+    if (!resolveRange(state, arguments[0], count, dest, destOffset) ||
+        dest.second->readOnly)
+      return false;
+
+    ObjectState *wos = state.addressSpace.getWriteable(dest.first, dest.second);
+    wos->fillBytes(destOffset, ExtractExpr::create(arguments[1], 0, Expr::Int8),
+                   count);
+  }
+
+  executor.bindLocal(target, state, arguments[0]);
+  return true;
+}
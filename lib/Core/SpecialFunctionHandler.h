@@ -14,6 +14,7 @@
 #include <map>
 #include <vector>
 #include <string>
+#include <utility>
 
 namespace llvm {
   class Function;
@@ -24,6 +25,8 @@ namespace klee {
   class Expr;
   class ExecutionState;
   struct KInstruction;
+  class MemoryObject;
+  class ObjectState;
   template<typename T> class ref;
   
   class SpecialFunctionHandler {
@@ -35,7 +38,16 @@ namespace klee {
     typedef std::map<const llvm::Function*, 
                      std::pair<Handler,bool> > handlers_ty;
 
+    /// A handler that replaces a defined function, but may decline a call
+    /// and leave it to the function itself.
+    typedef bool (SpecialFunctionHandler::*FastPath)(ExecutionState &state,
+                                                     KInstruction *target,
+                                                     std::vector<ref<Expr> >
+                                                       &arguments);
+    typedef std::map<const llvm::Function*, FastPath> fast_paths_ty;
+
     handlers_ty handlers;
+    fast_paths_ty fastPaths;
     class Executor &executor;
 
     struct HandlerInfo {
@@ -91,9 +103,23 @@ namespace klee {
                 KInstruction *target,
                 std::vector< ref<Expr> > &arguments);
 
+    /// Execute a call to a defined function natively, if it has a fast path
+    /// that accepts the arguments. Otherwise the function is to be executed
+    /// as usual.
+    bool handleFastPath(ExecutionState &state,
+                        llvm::Function *f,
+                        KInstruction *target,
+                        std::vector< ref<Expr> > &arguments);
+
     /* Convenience routines */
 
     std::string readStringAtAddress(ExecutionState &state, ref<Expr> address);
+
+    /// Resolve a pointer to \a count bytes within a single object, if the
+    /// pointer has a unique value and the bytes are in bounds.
+    bool resolveRange(ExecutionState &state, ref<Expr> address, uint64_t count,
+                      std::pair<const MemoryObject *, const ObjectState *> &op,
+                      unsigned &offset);
     
     /* Handlers */
 
@@ -144,6 +170,15 @@ namespace klee {
     HANDLER(handleDivRemOverflow);
     HANDLER(handleTypecheck);
 #undef HANDLER
+
+    /* Fast paths */
+
+#define FAST_PATH(name) bool name(ExecutionState &state, \
+                                  KInstruction *target, \
+                                  std::vector< ref<Expr> > &arguments)
+    FAST_PATH(handleMemcpy);
+    FAST_PATH(handleMemset);
+#undef FAST_PATH
   };
 } // End klee namespace
 
@@ -0,0 +1,915 @@
+//===-- StateSnapshot.cpp -------------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "StateSnapshot.h"
+
+#include "CoreStats.h"
+#include "ExecutionState.h"
+#include "Memory.h"
+
+#include "klee/Expr/ExprHashMap.h"
+#include "klee/Module/Cell.h"
+#include "klee/Module/KModule.h"
+#include "klee/Support/ErrorHandling.h"
+
+#include "llvm/ADT/APInt.h"
+#include "llvm/ADT/ArrayRef.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace klee;
+
+namespace {
+
+/// The file starts with this, so that no record is at offset 0, which
+/// stands for a null reference.
+const char Magic[8] = {'K', 'L', 'E', 'E', 'S', 'N', 'A', 'P'};
+
+enum ObjectStateFlags {
+  ReadOnly = 1,
+  AllSymbolic = 2,
+  HasConcreteStore = 4,
+  HasConcreteMask = 8,
+  HasFlushMask = 16,
+  HasKnownSymbolics = 32,
+  Lazy = 64
+};
+
+uint64_t mix(uint64_t x) {
+  x ^= x >> 30;
+  x *= UINT64_C(0xbf58476d1ce4e5b9);
+  x ^= x >> 27;
+  x *= UINT64_C(0x94d049bb133111eb);
+  x ^= x >> 31;
+  return x;
+}
+
+SnapshotStore::Key hashBytes(const std::vector<uint8_t> &data) {
+  SnapshotStore::Key key = {UINT64_C(0x9e3779b97f4a7c15), data.size()};
+  for (size_t i = 0; i < data.size(); i += 8) {
+    uint64_t word = 0;
+    std::memcpy(&word, data.data() + i, std::min<size_t>(8, data.size() - i));
+    key.lo = mix(key.lo ^ word);
+    key.hi = mix(key.hi + word + key.lo);
+  }
+  return key;
+}
+
+void putVarint(std::vector<uint8_t> &out, uint64_t value) {
+  while (value >= 0x80) {
+    out.push_back(static_cast<uint8_t>(value) | 0x80);
+    value >>= 7;
+  }
+  out.push_back(static_cast<uint8_t>(value));
+}
+
+/// Writes a set of bits, eight per byte.
+template <typename BitArrayT>
+void putBits(std::vector<uint8_t> &out, const BitArrayT &bits, unsigned size) {
+  for (unsigned i = 0; i < size; i += 8) {
+    uint8_t byte = 0;
+    for (unsigned j = 0; j != 8 && i + j < size; ++j)
+      byte |= bits.get(i + j) << j;
+    out.push_back(byte);
+  }
+}
+
+/// RecordParser - Reads the fields of a record payload.
+class RecordParser {
+  const uint8_t *pos, *end;
+
+public:
+  explicit RecordParser(const std::vector<uint8_t> &payload)
+      : pos(payload.data()), end(payload.data() + payload.size()) {}
+
+  uint64_t varint() {
+    uint64_t value = 0;
+    for (unsigned shift = 0;; shift += 7) {
+      if (pos == end || shift > 63)
+        klee_error("Corrupt state snapshot record");
+      uint8_t byte = *pos++;
+      value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+      if (!(byte & 0x80))
+        return value;
+    }
+  }
+
+  const uint8_t *bytes(size_t size) {
+    if (static_cast<size_t>(end - pos) < size)
+      klee_error("Corrupt state snapshot record");
+    const uint8_t *result = pos;
+    pos += size;
+    return result;
+  }
+
+  bool getBit(const uint8_t *bits, unsigned idx) {
+    return (bits[idx / 8] >> (idx % 8)) & 1;
+  }
+};
+
+} // namespace
+
+namespace klee {
+
+/// SnapshotWriter - Serializes the parts of one state into a buffer, which
+/// is appended to the file as a whole.
+class SnapshotWriter {
+  SnapshotStore &store;
+  const uint64_t base;
+  std::vector<uint8_t> buffer;
+
+  /// Records written for expressions and update nodes during this write.
+  ExprHashMap<uint64_t> exprs;
+  std::unordered_map<const UpdateNode *, uint64_t> updates;
+
+public:
+  explicit SnapshotWriter(SnapshotStore &store)
+      : store(store), base(store.fileSize) {}
+
+  /// Write \a payload as a record unless an equal record exists already.
+  ///
+  /// \return The offset of the record.
+  uint64_t writeRecord(const std::vector<uint8_t> &payload) {
+    SnapshotStore::Key key = hashBytes(payload);
+    auto it = store.records.find(key);
+    if (it != store.records.end())
+      return it->second;
+
+    uint64_t offset = base + buffer.size();
+    putVarint(buffer, payload.size());
+    buffer.insert(buffer.end(), payload.begin(), payload.end());
+    store.records.insert(std::make_pair(key, offset));
+    return offset;
+  }
+
+  uint64_t writeExpr(const ref<Expr> &e);
+  uint64_t writeUpdates(const UpdateNode *head);
+  uint64_t writeObjectState(const ObjectState &os);
+
+  /// Append everything written to the file.
+  void flush() {
+    if (!buffer.empty())
+      store.append(buffer);
+  }
+};
+
+/// SnapshotReader - Rebuilds the parts of states from the file.
+class SnapshotReader {
+  SnapshotStore &store;
+  std::vector<uint8_t> payload;
+
+public:
+  explicit SnapshotReader(SnapshotStore &store) : store(store) {}
+
+  ref<Expr> readExpr(uint64_t offset);
+  ref<UpdateNode> readUpdates(uint64_t offset);
+  ref<ObjectState> readObjectState(uint64_t offset, const MemoryObject *mo);
+};
+
+/// SnapshotCompactor - Copies the records reachable from given records of
+/// the file to a new file, without rebuilding the expressions in memory.
+class SnapshotCompactor {
+  SnapshotStore &store;
+  int fd;
+  uint64_t size;
+  std::vector<uint8_t> buffer;
+
+  std::unordered_map<SnapshotStore::Key, uint64_t, SnapshotStore::KeyHash>
+      records;
+  /// The new offsets of the records copied so far, by their old offsets.
+  std::unordered_map<uint64_t, uint64_t> copied;
+
+  uint64_t writeRecord(const std::vector<uint8_t> &payload);
+
+public:
+  SnapshotCompactor(SnapshotStore &store, int fd);
+
+  uint64_t copyExpr(uint64_t offset);
+  uint64_t copyUpdates(uint64_t offset);
+  uint64_t copyObjectState(uint64_t offset);
+  uint64_t copyState(uint64_t offset, const ExecutionState &state);
+
+  /// Write what is left in the buffer and hand the records written over to
+  /// the store. \return The size of the new file.
+  uint64_t finish();
+};
+
+} // End klee namespace
+
+uint64_t SnapshotWriter::writeExpr(const ref<Expr> &e) {
+  auto it = exprs.find(e);
+  if (it != exprs.end())
+    return it->second;
+
+  std::vector<uint8_t> payload;
+  putVarint(payload, e->getKind());
+  putVarint(payload, e->getWidth());
+
+  switch (e->getKind()) {
+  case Expr::Constant: {
+    const llvm::APInt &value = cast<ConstantExpr>(e)->getAPValue();
+    putVarint(payload, value.getNumWords());
+    for (unsigned i = 0, n = value.getNumWords(); i != n; ++i)
+      putVarint(payload, value.getRawData()[i]);
+    break;
+  }
+  case Expr::Read: {
+    const ReadExpr *re = cast<ReadExpr>(e);
+    putVarint(payload, reinterpret_cast<uintptr_t>(re->updates.root));
+    putVarint(payload, writeUpdates(re->updates.head.get()));
+    putVarint(payload, writeExpr(re->index));
+    break;
+  }
+  case Expr::Extract:
+    putVarint(payload, cast<ExtractExpr>(e)->offset);
+    putVarint(payload, writeExpr(e->getKid(0)));
+    break;
+  default:
+    putVarint(payload, e->getNumKids());
+    for (unsigned i = 0, n = e->getNumKids(); i != n; ++i)
+      putVarint(payload, writeExpr(e->getKid(i)));
+    break;
+  }
+
+  uint64_t offset = writeRecord(payload);
+  exprs.insert(std::make_pair(e, offset));
+  return offset;
+}
+
+uint64_t SnapshotWriter::writeUpdates(const UpdateNode *head) {
+  // Update lists can be very long, so write the nodes that were not
+  // written yet iteratively, starting with the oldest.
+  std::vector<const UpdateNode *> chain;
+  uint64_t next = 0;
+  for (const UpdateNode *un = head; un; un = un->next.get()) {
+    auto it = updates.find(un);
+    if (it != updates.end()) {
+      next = it->second;
+      break;
+    }
+    chain.push_back(un);
+  }
+
+  for (auto it = chain.rbegin(), ie = chain.rend(); it != ie; ++it) {
+    std::vector<uint8_t> payload;
+    putVarint(payload, next);
+    putVarint(payload, writeExpr((*it)->index));
+    putVarint(payload, writeExpr((*it)->value));
+    next = writeRecord(payload);
+    updates.insert(std::make_pair(*it, next));
+  }
+  return next;
+}
+
+uint64_t SnapshotWriter::writeObjectState(const ObjectState &os) {
+  std::vector<uint8_t> payload;
+  unsigned flags = 0;
+  if (os.readOnly)
+    flags |= ReadOnly;
+  if (os.allSymbolic)
+    flags |= AllSymbolic;
+  if (os.lazy)
+    flags |= Lazy;
+  if (os.concreteStore.getSize() == os.size)
+    flags |= HasConcreteStore;
+  if (os.concreteMask)
+    flags |= HasConcreteMask;
+  if (os.flushMask)
+    flags |= HasFlushMask;
+  if (os.knownSymbolics)
+    flags |= HasKnownSymbolics;
+  putVarint(payload, os.size);
+  putVarint(payload, flags);
+
+  if (flags & HasConcreteStore) {
+    size_t start = payload.size();
+    payload.resize(start + os.size);
+    os.concreteStore.copyOut(payload.data() + start);
+  }
+  if (os.concreteMask)
+    putBits(payload, *os.concreteMask, os.size);
+  if (os.flushMask)
+    putBits(payload, *os.flushMask, os.size);
+  if (os.knownSymbolics) {
+    std::vector<std::pair<unsigned, uint64_t> > known;
+    for (unsigned i = 0; i != os.size; ++i)
+      if (!(*os.knownSymbolics)[i].isNull())
+        known.push_back(std::make_pair(i, writeExpr((*os.knownSymbolics)[i])));
+    putVarint(payload, known.size());
+    for (const auto &entry : known) {
+      putVarint(payload, entry.first);
+      putVarint(payload, entry.second);
+    }
+  }
+
+  putVarint(payload, reinterpret_cast<uintptr_t>(os.updates.root));
+  putVarint(payload, writeUpdates(os.updates.head.get()));
+  return writeRecord(payload);
+}
+
+ref<Expr> SnapshotReader::readExpr(uint64_t offset) {
+  auto it = store.exprCache.find(offset);
+  if (it != store.exprCache.end())
+    return it->second;
+
+  store.readRecord(offset, payload);
+  RecordParser parser(payload);
+  Expr::Kind kind = static_cast<Expr::Kind>(parser.varint());
+  Expr::Width width = parser.varint();
+
+  // The payload is reused by nested reads, so parse all fields first.
+  std::vector<uint64_t> fields;
+  uint64_t numFields;
+  switch (kind) {
+  case Expr::Read:
+    numFields = 3;
+    break;
+  case Expr::Extract:
+    numFields = 2;
+    break;
+  default:
+    numFields = parser.varint();
+    break;
+  }
+  for (uint64_t i = 0; i != numFields; ++i)
+    fields.push_back(parser.varint());
+
+  ref<Expr> result;
+  switch (kind) {
+  case Expr::Constant:
+    result = ConstantExpr::alloc(llvm::APInt(width, fields));
+    break;
+  case Expr::Read:
+    result = ReadExpr::create(
+        UpdateList(reinterpret_cast<const Array *>(fields[0]),
+                   readUpdates(fields[1])),
+        readExpr(fields[2]));
+    break;
+  case Expr::Extract:
+    result = ExtractExpr::create(readExpr(fields[1]), fields[0], width);
+    break;
+  case Expr::Not:
+    result = NotExpr::create(readExpr(fields[0]));
+    break;
+  case Expr::ZExt:
+  case Expr::SExt: {
+    std::vector<Expr::CreateArg> args;
+    args.push_back(Expr::CreateArg(readExpr(fields[0])));
+    args.push_back(Expr::CreateArg(width));
+    result = Expr::createFromKind(kind, args);
+    break;
+  }
+  default: {
+    std::vector<Expr::CreateArg> args;
+    for (uint64_t field : fields)
+      args.push_back(Expr::CreateArg(readExpr(field)));
+    result = Expr::createFromKind(kind, args);
+    break;
+  }
+  }
+
+  store.exprCache.insert(std::make_pair(offset, result));
+  return result;
+}
+
+ref<UpdateNode> SnapshotReader::readUpdates(uint64_t offset) {
+  // Collect the nodes that are not cached, newest first.
+  std::vector<std::pair<uint64_t, std::vector<uint64_t> > > chain;
+  ref<UpdateNode> next;
+  while (offset) {
+    auto it = store.updateCache.find(offset);
+    if (it != store.updateCache.end()) {
+      next = it->second;
+      break;
+    }
+    store.readRecord(offset, payload);
+    RecordParser parser(payload);
+    std::vector<uint64_t> fields(3);
+    for (auto &field : fields)
+      field = parser.varint();
+    chain.push_back(std::make_pair(offset, fields));
+    offset = fields[0];
+  }
+
+  for (auto it = chain.rbegin(), ie = chain.rend(); it != ie; ++it) {
+    next = new UpdateNode(next, readExpr(it->second[1]),
+                          readExpr(it->second[2]));
+    store.updateCache.insert(std::make_pair(it->first, next));
+  }
+  return next;
+}
+
+ref<ObjectState> SnapshotReader::readObjectState(uint64_t offset,
+                                                 const MemoryObject *mo) {
+  auto key = std::make_pair(offset, mo);
+  auto it = store.objectCache.find(key);
+  if (it != store.objectCache.end())
+    return it->second;
+
+  store.readRecord(offset, payload);
+  std::vector<uint8_t> record;
+  record.swap(payload);
+  RecordParser parser(record);
+  unsigned size = parser.varint();
+  unsigned flags = parser.varint();
+  assert(size == mo->size && "object state does not match memory object");
+
+  ObjectState *os = new ObjectState(mo, UpdateList(0, 0));
+  os->readOnly = flags & ReadOnly;
+  os->allSymbolic = flags & AllSymbolic;
+  os->lazy = flags & Lazy;
+  if (flags & HasConcreteStore) {
+    os->concreteStore = ObjectState::ByteArray(size);
+    os->concreteStore.copyIn(parser.bytes(size));
+  }
+  if (flags & HasConcreteMask) {
+    const uint8_t *bits = parser.bytes((size + 7) / 8);
+    os->concreteMask = new ObjectState::BitMask(size);
+    for (unsigned i = 0; i != size; ++i)
+      if (parser.getBit(bits, i))
+        os->concreteMask->set(i);
+  }
+  if (flags & HasFlushMask) {
+    const uint8_t *bits = parser.bytes((size + 7) / 8);
+    os->flushMask = new ObjectState::BitMask(size);
+    for (unsigned i = 0; i != size; ++i)
+      if (parser.getBit(bits, i))
+        os->flushMask->set(i);
+  }
+  if (flags & HasKnownSymbolics) {
+    os->knownSymbolics = new ObjectState::ExprArray(size);
+    for (uint64_t i = 0, n = parser.varint(); i != n; ++i) {
+      unsigned idx = parser.varint();
+      os->knownSymbolics->set(idx, readExpr(parser.varint()));
+    }
+  }
+  const Array *root = reinterpret_cast<const Array *>(parser.varint());
+  os->updates = UpdateList(root, readUpdates(parser.varint()));
+
+  ref<ObjectState> result(os);
+  store.objectCache.insert(std::make_pair(key, result));
+  return result;
+}
+
+SnapshotCompactor::SnapshotCompactor(SnapshotStore &store, int fd)
+    : store(store), fd(fd), size(0),
+      buffer(Magic, Magic + sizeof(Magic)) {}
+
+uint64_t SnapshotCompactor::writeRecord(const std::vector<uint8_t> &payload) {
+  SnapshotStore::Key key = hashBytes(payload);
+  auto it = records.find(key);
+  if (it != records.end())
+    return it->second;
+
+  uint64_t offset = size + buffer.size();
+  putVarint(buffer, payload.size());
+  buffer.insert(buffer.end(), payload.begin(), payload.end());
+  records.insert(std::make_pair(key, offset));
+
+  if (buffer.size() >= SnapshotStore::BlockSize) {
+    SnapshotStore::writeAll(fd, buffer, size, store.path);
+    size += buffer.size();
+    buffer.clear();
+  }
+  return offset;
+}
+
+uint64_t SnapshotCompactor::copyExpr(uint64_t offset) {
+  auto it = copied.find(offset);
+  if (it != copied.end())
+    return it->second;
+
+  std::vector<uint8_t> payload, result;
+  store.readRecord(offset, payload);
+  RecordParser parser(payload);
+  uint64_t kind = parser.varint();
+  putVarint(result, kind);
+  putVarint(result, parser.varint());
+
+  switch (kind) {
+  case Expr::Constant: {
+    uint64_t numWords = parser.varint();
+    putVarint(result, numWords);
+    for (uint64_t i = 0; i != numWords; ++i)
+      putVarint(result, parser.varint());
+    break;
+  }
+  case Expr::Read: {
+    putVarint(result, parser.varint());
+    uint64_t updates = parser.varint();
+    uint64_t index = parser.varint();
+    putVarint(result, copyUpdates(updates));
+    putVarint(result, copyExpr(index));
+    break;
+  }
+  case Expr::Extract:
+    putVarint(result, parser.varint());
+    putVarint(result, copyExpr(parser.varint()));
+    break;
+  default: {
+    uint64_t numKids = parser.varint();
+    std::vector<uint64_t> kids;
+    for (uint64_t i = 0; i != numKids; ++i)
+      kids.push_back(parser.varint());
+    putVarint(result, numKids);
+    for (uint64_t kid : kids)
+      putVarint(result, copyExpr(kid));
+    break;
+  }
+  }
+
+  uint64_t newOffset = writeRecord(result);
+  copied.insert(std::make_pair(offset, newOffset));
+  return newOffset;
+}
+
+uint64_t SnapshotCompactor::copyUpdates(uint64_t offset) {
+  // Like reading, copy the nodes that were not copied yet iteratively,
+  // starting with the oldest.
+  std::vector<std::pair<uint64_t, std::vector<uint64_t> > > chain;
+  uint64_t next = 0;
+  std::vector<uint8_t> payload;
+  while (offset) {
+    auto it = copied.find(offset);
+    if (it != copied.end()) {
+      next = it->second;
+      break;
+    }
+    store.readRecord(offset, payload);
+    RecordParser parser(payload);
+    std::vector<uint64_t> fields(3);
+    for (auto &field : fields)
+      field = parser.varint();
+    chain.push_back(std::make_pair(offset, fields));
+    offset = fields[0];
+  }
+
+  for (auto it = chain.rbegin(), ie = chain.rend(); it != ie; ++it) {
+    std::vector<uint8_t> result;
+    putVarint(result, next);
+    putVarint(result, copyExpr(it->second[1]));
+    putVarint(result, copyExpr(it->second[2]));
+    next = writeRecord(result);
+    copied.insert(std::make_pair(it->first, next));
+  }
+  return next;
+}
+
+uint64_t SnapshotCompactor::copyObjectState(uint64_t offset) {
+  auto it = copied.find(offset);
+  if (it != copied.end())
+    return it->second;
+
+  std::vector<uint8_t> payload, result;
+  store.readRecord(offset, payload);
+  RecordParser parser(payload);
+  uint64_t size = parser.varint();
+  uint64_t flags = parser.varint();
+  putVarint(result, size);
+  putVarint(result, flags);
+
+  auto copyBytes = [&](size_t count) {
+    const uint8_t *bytes = parser.bytes(count);
+    result.insert(result.end(), bytes, bytes + count);
+  };
+  if (flags & HasConcreteStore)
+    copyBytes(size);
+  if (flags & HasConcreteMask)
+    copyBytes((size + 7) / 8);
+  if (flags & HasFlushMask)
+    copyBytes((size + 7) / 8);
+  if (flags & HasKnownSymbolics) {
+    uint64_t numKnown = parser.varint();
+    std::vector<std::pair<uint64_t, uint64_t> > known;
+    for (uint64_t i = 0; i != numKnown; ++i) {
+      uint64_t idx = parser.varint();
+      known.push_back(std::make_pair(idx, parser.varint()));
+    }
+    putVarint(result, numKnown);
+    for (const auto &entry : known) {
+      putVarint(result, entry.first);
+      putVarint(result, copyExpr(entry.second));
+    }
+  }
+  putVarint(result, parser.varint());
+  putVarint(result, copyUpdates(parser.varint()));
+
+  uint64_t newOffset = writeRecord(result);
+  copied.insert(std::make_pair(offset, newOffset));
+  return newOffset;
+}
+
+uint64_t SnapshotCompactor::copyState(uint64_t offset,
+                                      const ExecutionState &state) {
+  std::vector<uint8_t> payload, result;
+  store.readRecord(offset, payload);
+  RecordParser parser(payload);
+
+  uint64_t numConstraints = parser.varint();
+  putVarint(result, numConstraints);
+  for (uint64_t i = 0; i != numConstraints; ++i)
+    putVarint(result, copyExpr(parser.varint()));
+
+  uint64_t numObjects = parser.varint();
+  putVarint(result, numObjects);
+  for (uint64_t i = 0; i != numObjects; ++i)
+    putVarint(result, copyObjectState(parser.varint()));
+
+  for (const StackFrame &sf : state.stack) {
+    for (unsigned i = 0, n = sf.kf->numRegisters; i != n; ++i) {
+      uint64_t value = parser.varint();
+      putVarint(result, value ? copyExpr(value) : 0);
+    }
+  }
+
+  return writeRecord(result);
+}
+
+uint64_t SnapshotCompactor::finish() {
+  SnapshotStore::writeAll(fd, buffer, size, store.path);
+  size += buffer.size();
+  buffer.clear();
+  store.records = std::move(records);
+  return size;
+}
+
+/***/
+
+constexpr size_t SnapshotStore::BlockSize;
+constexpr size_t SnapshotStore::MaxCachedBlocks;
+
+constexpr uint64_t SnapshotStore::DefaultMinCompactionSize;
+
+SnapshotStore::SnapshotStore(const std::string &path,
+                             uint64_t minCompactionSize)
+    : path(path), fileSize(0), minCompactionSize(minCompactionSize),
+      sizeAfterCompaction(0), cacheSizeAfterSweep(0) {
+  fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0)
+    klee_error("Could not open state snapshot file %s: %s", path.c_str(),
+               strerror(errno));
+  append(std::vector<uint8_t>(Magic, Magic + sizeof(Magic)));
+  sizeAfterCompaction = fileSize;
+}
+
+SnapshotStore::~SnapshotStore() {
+  close(fd);
+  unlink(path.c_str());
+}
+
+void SnapshotStore::writeAll(int fd, const std::vector<uint8_t> &data,
+                             uint64_t offset, const std::string &path) {
+  for (size_t written = 0; written < data.size();) {
+    ssize_t res = pwrite(fd, data.data() + written, data.size() - written,
+                         offset + written);
+    if (res < 0) {
+      if (errno == EINTR)
+        continue;
+      klee_error("Could not write state snapshot file %s: %s", path.c_str(),
+                 strerror(errno));
+    }
+    written += res;
+  }
+}
+
+uint64_t SnapshotStore::append(const std::vector<uint8_t> &data) {
+  uint64_t offset = fileSize;
+  writeAll(fd, data, offset, path);
+  fileSize += data.size();
+
+  // The last block may have been cached before it was complete.
+  blocks.erase(offset / BlockSize);
+  return offset;
+}
+
+void SnapshotStore::read(uint64_t offset, size_t size, uint8_t *dest) {
+  if (offset + size > fileSize)
+    klee_error("Corrupt state snapshot record");
+
+  while (size) {
+    uint64_t index = offset / BlockSize;
+    auto it = blocks.find(index);
+    if (it == blocks.end()) {
+      if (blocks.size() >= MaxCachedBlocks) {
+        blocks.erase(blockOrder.front());
+        blockOrder.pop_front();
+      }
+      std::vector<uint8_t> block(
+          std::min<uint64_t>(BlockSize, fileSize - index * BlockSize));
+      for (size_t done = 0; done < block.size();) {
+        ssize_t res = pread(fd, block.data() + done, block.size() - done,
+                            index * BlockSize + done);
+        if (res <= 0) {
+          if (res < 0 && errno == EINTR)
+            continue;
+          klee_error("Could not read state snapshot file %s: %s",
+                     path.c_str(), res ? strerror(errno) : "end of file");
+        }
+        done += res;
+      }
+      it = blocks.insert(std::make_pair(index, std::move(block))).first;
+      blockOrder.push_back(index);
+    }
+
+    size_t start = offset - index * BlockSize;
+    size_t count = std::min<size_t>(size, it->second.size() - start);
+    std::memcpy(dest, it->second.data() + start, count);
+    dest += count;
+    offset += count;
+    size -= count;
+  }
+}
+
+void SnapshotStore::readRecord(uint64_t offset,
+                               std::vector<uint8_t> &payload) {
+  // The length is a varint of at most 10 bytes.
+  uint8_t header[10];
+  size_t headerSize = std::min<uint64_t>(sizeof(header), fileSize - offset);
+  read(offset, headerSize, header);
+  uint64_t length = 0;
+  size_t pos = 0;
+  for (unsigned shift = 0;; shift += 7) {
+    if (pos == headerSize)
+      klee_error("Corrupt state snapshot record");
+    uint8_t byte = header[pos++];
+    length |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if (!(byte & 0x80))
+      break;
+  }
+  payload.resize(length);
+  read(offset + pos, length, payload.data());
+}
+
+void SnapshotStore::sweepCaches() {
+  size_t size = exprCache.size() + updateCache.size() + objectCache.size();
+  if (size < 2 * cacheSizeAfterSweep + 1024)
+    return;
+
+  for (auto it = objectCache.begin(); it != objectCache.end();) {
+    if (it->second->_refCount.getCount() == 1)
+      it = objectCache.erase(it);
+    else
+      ++it;
+  }
+  for (auto it = updateCache.begin(); it != updateCache.end();) {
+    if (it->second->_refCount.getCount() == 1)
+      it = updateCache.erase(it);
+    else
+      ++it;
+  }
+  for (auto it = exprCache.begin(); it != exprCache.end();) {
+    if (it->second->_refCount.getCount() == 1)
+      it = exprCache.erase(it);
+    else
+      ++it;
+  }
+  cacheSizeAfterSweep =
+      exprCache.size() + updateCache.size() + objectCache.size();
+}
+
+void SnapshotStore::clearCaches() {
+  blocks.clear();
+  blockOrder.clear();
+  records.clear();
+  exprCache.clear();
+  updateCache.clear();
+  objectCache.clear();
+  cacheSizeAfterSweep = 0;
+}
+
+void SnapshotStore::reset() {
+  assert(swapped.empty() && "the file is still in use");
+  if (ftruncate(fd, sizeof(Magic)) < 0)
+    klee_error("Could not truncate state snapshot file %s: %s", path.c_str(),
+               strerror(errno));
+  fileSize = sizeAfterCompaction = sizeof(Magic);
+  clearCaches();
+}
+
+void SnapshotStore::compact() {
+  std::string newPath = path + ".compact";
+  int newFd = open(newPath.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (newFd < 0)
+    klee_error("Could not open state snapshot file %s: %s", newPath.c_str(),
+               strerror(errno));
+
+  SnapshotCompactor compactor(*this, newFd);
+  for (auto &entry : swapped)
+    entry.second.offset = compactor.copyState(entry.second.offset,
+                                              *entry.first);
+  uint64_t newSize = compactor.finish();
+
+  if (rename(newPath.c_str(), path.c_str()) < 0)
+    klee_error("Could not replace state snapshot file %s: %s", path.c_str(),
+               strerror(errno));
+  close(fd);
+  fd = newFd;
+
+  // The records were handed over by the compactor
+  auto newRecords = std::move(records);
+  clearCaches();
+  records = std::move(newRecords);
+  fileSize = sizeAfterCompaction = newSize;
+  ++stats::snapshotCompactions;
+}
+
+void SnapshotStore::swapOut(ExecutionState &state) {
+  assert(!isSwappedOut(state) && "state is already swapped out");
+
+  SnapshotWriter writer(*this);
+  SwappedState swappedState;
+  std::vector<uint8_t> payload;
+
+  putVarint(payload, state.constraints.size());
+  for (const auto &constraint : state.constraints)
+    putVarint(payload, writer.writeExpr(constraint));
+
+  putVarint(payload, state.addressSpace.objects.size());
+  for (const auto &entry : state.addressSpace.objects) {
+    swappedState.objects.push_back(entry.first);
+    putVarint(payload, writer.writeObjectState(*entry.second));
+  }
+
+  for (const StackFrame &sf : state.stack) {
+    for (unsigned i = 0, n = sf.kf->numRegisters; i != n; ++i) {
+      const ref<Expr> &value = sf.locals[i].value;
+      putVarint(payload, value.isNull() ? 0 : writer.writeExpr(value));
+    }
+  }
+
+  swappedState.offset = writer.writeRecord(payload);
+  writer.flush();
+
+  state.constraints = ConstraintSet();
+  state.addressSpace.objects = MemoryMap();
+  for (StackFrame &sf : state.stack)
+    for (unsigned i = 0, n = sf.kf->numRegisters; i != n; ++i)
+      sf.locals[i].value = nullptr;
+  state.queryMetaData.models.clear();
+  state.queryMetaData.modelConstraints.clear();
+
+  swapped.insert(std::make_pair(&state, std::move(swappedState)));
+  ++stats::statesSwappedOut;
+
+  if (fileSize >= minCompactionSize && fileSize >= 2 * sizeAfterCompaction)
+    compact();
+}
+
+void SnapshotStore::swapIn(ExecutionState &state) {
+  auto it = swapped.find(&state);
+  if (it == swapped.end())
+    return;
+  SwappedState &swappedState = it->second;
+
+  SnapshotReader reader(*this);
+  std::vector<uint8_t> payload;
+  readRecord(swappedState.offset, payload);
+  RecordParser parser(payload);
+
+  ConstraintSet::constraints_ty constraints(parser.varint());
+  for (auto &constraint : constraints)
+    constraint = reader.readExpr(parser.varint());
+  state.constraints = ConstraintSet(std::move(constraints));
+
+  // Objects are inserted without an owner, so the state copies them on
+  // their first write, like after a fork.
+  uint64_t numObjects = parser.varint();
+  assert(numObjects == swappedState.objects.size() && "object count mismatch");
+  for (uint64_t i = 0; i != numObjects; ++i) {
+    const MemoryObject *mo = swappedState.objects[i].get();
+    state.addressSpace.objects = state.addressSpace.objects.insert(
+        std::make_pair(mo, reader.readObjectState(parser.varint(), mo)));
+  }
+
+  for (StackFrame &sf : state.stack) {
+    for (unsigned i = 0, n = sf.kf->numRegisters; i != n; ++i) {
+      uint64_t offset = parser.varint();
+      if (offset)
+        sf.locals[i].value = reader.readExpr(offset);
+    }
+  }
+
+  swapped.erase(it);
+  ++stats::statesSwappedIn;
+  if (swapped.empty())
+    reset();
+  else
+    sweepCaches();
+}
+
+void SnapshotStore::drop(const ExecutionState &state) {
+  if (!swapped.erase(&state))
+    return;
+  if (swapped.empty())
+    reset();
+}
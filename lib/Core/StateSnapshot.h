@@ -0,0 +1,167 @@
+//===-- StateSnapshot.h -----------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_STATESNAPSHOT_H
+#define KLEE_STATESNAPSHOT_H
+
+#include "klee/ADT/Ref.h"
+#include "klee/Expr/Expr.h"
+
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace klee {
+class ExecutionState;
+class MemoryObject;
+class ObjectState;
+
+/// SnapshotStore - Moves the bulk of execution states to a file, so that
+/// more states can be kept than fit into memory.
+///
+/// Swapping a state out writes its address space contents, constraints and
+/// local variables to the file and drops them from the state. Everything
+/// else, including the memory objects of the address space (whose addresses
+/// must stay allocated), stays in memory, so that searchers can keep using
+/// the state until it is swapped back in.
+///
+/// The file consists of records for expressions, update nodes, object
+/// states and states, which refer to each other by file offset. Records
+/// are identified by a hash of their contents, and each distinct record is
+/// written only once, so object states and expressions shared between
+/// states are shared on disk as well. Arrays are referred to by address,
+/// as the array cache keeps them alive for the whole run.
+///
+/// Records are not freed individually. Instead, the file is emptied once no
+/// state is swapped out, and compacted by copying the records that are
+/// still used to a new file whenever it has doubled in size.
+class SnapshotStore {
+public:
+  /// A 128-bit hash of the contents of a record.
+  struct Key {
+    uint64_t hi, lo;
+
+    bool operator==(const Key &other) const {
+      return hi == other.hi && lo == other.lo;
+    }
+  };
+
+  struct KeyHash {
+    size_t operator()(const Key &key) const { return key.lo; }
+  };
+
+private:
+  friend class SnapshotWriter;
+  friend class SnapshotReader;
+  friend class SnapshotCompactor;
+
+  /// What stays in memory of a swapped out state.
+  struct SwappedState {
+    /// The offset of the state record.
+    uint64_t offset;
+    /// The memory objects of the address space, in address order.
+    std::vector<ref<const MemoryObject> > objects;
+  };
+
+  static constexpr size_t BlockSize = 64 * 1024;
+  static constexpr size_t MaxCachedBlocks = 32;
+
+  std::string path;
+  int fd;
+  uint64_t fileSize;
+
+  /// The file is compacted once it has reached this size and doubled since
+  /// the last compaction.
+  uint64_t minCompactionSize;
+  uint64_t sizeAfterCompaction;
+
+  /// Recently read blocks of the file, by block index.
+  std::unordered_map<uint64_t, std::vector<uint8_t> > blocks;
+  std::deque<uint64_t> blockOrder;
+
+  std::unordered_map<const ExecutionState *, SwappedState> swapped;
+
+  /// The offsets of all records written so far.
+  std::unordered_map<Key, uint64_t, KeyHash> records;
+
+  /// Expressions, update nodes and object states read recently, so that
+  /// states that are swapped in one after another share them again. An
+  /// object state is only shared between states for the same memory
+  /// object. Entries that are not used anywhere else are dropped from time
+  /// to time.
+  std::unordered_map<uint64_t, ref<Expr> > exprCache;
+  std::unordered_map<uint64_t, ref<UpdateNode> > updateCache;
+  std::map<std::pair<uint64_t, const MemoryObject *>, ref<ObjectState> >
+      objectCache;
+  size_t cacheSizeAfterSweep;
+
+  /// Append \a data to the file and return its offset.
+  uint64_t append(const std::vector<uint8_t> &data);
+
+  /// Write all of \a data at \a offset of the file \a fd, named \a path.
+  static void writeAll(int fd, const std::vector<uint8_t> &data,
+                       uint64_t offset, const std::string &path);
+
+  /// Read \a size bytes at \a offset of the file into \a dest.
+  void read(uint64_t offset, size_t size, uint8_t *dest);
+
+  /// Read the record at \a offset into \a payload.
+  void readRecord(uint64_t offset, std::vector<uint8_t> &payload);
+
+  /// Drop the cache entries that are referenced by nothing else.
+  void sweepCaches();
+
+  /// Forget the cached blocks and records, e.g. as their offsets changed.
+  void clearCaches();
+
+  /// Empty the file, which must not be used by any swapped out state.
+  void reset();
+
+  /// Replace the file by one with only the records still in use.
+  void compact();
+
+public:
+  static constexpr uint64_t DefaultMinCompactionSize = 64 * 1024 * 1024;
+
+  /// Create a store backed by a new file at \a path, which is removed again
+  /// when the store is destroyed.
+  explicit SnapshotStore(const std::string &path,
+                         uint64_t minCompactionSize = DefaultMinCompactionSize);
+  ~SnapshotStore();
+
+  SnapshotStore(const SnapshotStore &) = delete;
+  SnapshotStore &operator=(const SnapshotStore &) = delete;
+
+  bool isSwappedOut(const ExecutionState &state) const {
+    return swapped.count(&state);
+  }
+
+  size_t getNumSwappedOut() const { return swapped.size(); }
+
+  uint64_t getFileSize() const { return fileSize; }
+
+  /// Write the address space contents, constraints and local variables of
+  /// \a state to the file and drop them from memory.
+  void swapOut(ExecutionState &state);
+
+  /// Restore a state that was swapped out. Resident states are left alone.
+  void swapIn(ExecutionState &state);
+
+  /// Forget a state that is about to be destroyed without reading it back.
+  /// Resident states are left alone.
+  void drop(const ExecutionState &state);
+};
+
+} // End klee namespace
+
+#endif /* KLEE_STATESNAPSHOT_H */
@@ -267,7 +267,8 @@ StatsTracker::StatsTracker(Executor &_executor, std::string _objectFilename,
 
     if (statsWriteInterval)
       executor.timers.add(std::make_unique<Timer>(statsWriteInterval, [&]{
-        writeStatsLine();
+        if (statsFile)
+          writeStatsLine();
       }));
   }
 
@@ -284,7 +285,8 @@ StatsTracker::StatsTracker(Executor &_executor, std::string _objectFilename,
     if (istatsFile) {
       if (iStatsWriteInterval)
         executor.timers.add(std::make_unique<Timer>(iStatsWriteInterval, [&]{
-          writeIStats();
+          if (istatsFile)
+            writeIStats();
         }));
     } else {
       klee_error("Unable to open instruction level stats file (run.istats).");
@@ -306,6 +308,13 @@ StatsTracker::~StatsTracker() {
   }
 }
 
+void StatsTracker::disableOutput() {
+  // The database connection and the stream are left alone: closing them
+  // would flush or finalize them on behalf of the process that opened them.
+  statsFile = nullptr;
+  istatsFile.release();
+}
+
 void StatsTracker::done() {
   if (statsFile)
     writeStatsLine();
@@ -345,11 +354,19 @@ void StatsTracker::stepInstruction(ExecutionState &es) {
     if (UseCallPaths)
       theStatisticManager->setContext(&sf.callPathNode->statistics);
 
+    // A branch retried after the adaptive solver timeout cut off its query
+    // was counted when it was first executed
+    if (es.solverTimeoutRetries)
+      return;
+
     if (es.instsSinceCovNew)
       ++es.instsSinceCovNew;
 
     if (sf.kf->trackCoverage && instructionIsCoverable(inst)) {
-      if (!theStatisticManager->getIndexedValue(stats::coveredInstructions, ii.id)) {
+      // Claiming the coverage makes sure that it is only counted once when
+      // the statistics are shared by parallel explorations.
+      if (!theStatisticManager->getIndexedValue(stats::coveredInstructions, ii.id) &&
+          theStatisticManager->claimStatistic(stats::coveredInstructions)) {
         // Checking for actual stoppoints avoids inconsistencies due
         // to line number propogation.
         //
@@ -358,7 +375,6 @@ void StatsTracker::stepInstruction(ExecutionState &es) {
           es.coveredLines[&ii.file].insert(ii.line);
 	es.coveredNew = true;
         es.instsSinceCovNew = 1;
-	++stats::coveredInstructions;
 	stats::uncoveredInstructions += (uint64_t)-1;
       }
     }
@@ -413,18 +429,18 @@ void StatsTracker::markBranchVisited(ExecutionState *visitedTrue,
     unsigned id = theStatisticManager->getIndex();
     uint64_t hasTrue = theStatisticManager->getIndexedValue(stats::trueBranches, id);
     uint64_t hasFalse = theStatisticManager->getIndexedValue(stats::falseBranches, id);
-    if (visitedTrue && !hasTrue) {
+    if (visitedTrue && !hasTrue &&
+        theStatisticManager->claimStatistic(stats::trueBranches)) {
       visitedTrue->coveredNew = true;
       visitedTrue->instsSinceCovNew = 1;
-      ++stats::trueBranches;
       if (hasFalse) { ++fullBranches; --partialBranches; }
       else ++partialBranches;
       hasTrue = 1;
     }
-    if (visitedFalse && !hasFalse) {
+    if (visitedFalse && !hasFalse &&
+        theStatisticManager->claimStatistic(stats::falseBranches)) {
       visitedFalse->coveredNew = true;
       visitedFalse->instsSinceCovNew = 1;
-      ++stats::falseBranches;
       if (hasTrue) { ++fullBranches; --partialBranches; }
       else ++partialBranches;
     }
@@ -453,7 +469,11 @@ void StatsTracker::writeStatsHeader() {
              << "ResolveTime INTEGER,"
              << "QueryCexCacheMisses INTEGER,"
              << "QueryCexCacheHits INTEGER,"
-             << "ArrayHashTime INTEGER"
+             << "ArrayHashTime INTEGER,"
+             << "QueryPersistentCacheMisses INTEGER,"
+             << "QueryPersistentCacheHits INTEGER,"
+             << "ObjectStatePagesShared INTEGER,"
+             << "ObjectStatePageCopies INTEGER"
          << ')';
   char *zErrMsg = nullptr;
   if(sqlite3_exec(statsFile, create.str().c_str(), nullptr, nullptr, &zErrMsg)) {
@@ -486,7 +506,11 @@ void StatsTracker::writeStatsHeader() {
              << "ResolveTime,"
              << "QueryCexCacheMisses,"
              << "QueryCexCacheHits,"
-             << "ArrayHashTime"
+             << "ArrayHashTime,"
+             << "QueryPersistentCacheMisses,"
+             << "QueryPersistentCacheHits,"
+             << "ObjectStatePagesShared,"
+             << "ObjectStatePageCopies"
          << ") VALUES ("
              << "?,"
              << "?,"
@@ -507,6 +531,10 @@ void StatsTracker::writeStatsHeader() {
              << "?,"
              << "?,"
              << "?,"
+             << "?,"
+             << "?,"
+             << "?,"
+             << "?,"
              << "? "
          << ')';
 
@@ -519,7 +547,32 @@ time::Span StatsTracker::elapsed() {
   return time::getWallTime() - startWallTime;
 }
 
+void StatsTracker::recountBranches() {
+  if (!OutputIStats)
+    return;
+
+  fullBranches = partialBranches = 0;
+  for (auto &kfp : executor.kmodule->functions) {
+    KFunction *kf = kfp.get();
+    for (unsigned i = 0; i < kf->numInstructions; ++i) {
+      unsigned id = kf->instructions[i]->info->id;
+      bool hasTrue =
+          theStatisticManager->getIndexedValue(stats::trueBranches, id);
+      bool hasFalse =
+          theStatisticManager->getIndexedValue(stats::falseBranches, id);
+      if (hasTrue && hasFalse)
+        ++fullBranches;
+      else if (hasTrue || hasFalse)
+        ++partialBranches;
+    }
+  }
+}
+
 void StatsTracker::writeStatsLine() {
+  // Branches covered by other processes only show in the shared statistics
+  if (theStatisticManager->isShared())
+    recountBranches();
+
   sqlite3_bind_int64(insertStmt, 1, stats::instructions);
   sqlite3_bind_int64(insertStmt, 2, fullBranches);
   sqlite3_bind_int64(insertStmt, 3, partialBranches);
@@ -544,6 +597,10 @@ void StatsTracker::writeStatsLine() {
 #else
   sqlite3_bind_int64(insertStmt, 20, -1LL);
 #endif
+  sqlite3_bind_int64(insertStmt, 21, stats::queryPersistentCacheMisses);
+  sqlite3_bind_int64(insertStmt, 22, stats::queryPersistentCacheHits);
+  sqlite3_bind_int64(insertStmt, 23, stats::objectStatePagesShared);
+  sqlite3_bind_int64(insertStmt, 24, stats::objectStatePageCopies);
   int errCode = sqlite3_step(insertStmt);
   if(errCode != SQLITE_DONE) klee_error("Error writing stats data: %s", sqlite3_errmsg(statsFile));
   sqlite3_reset(insertStmt);
@@ -600,6 +657,10 @@ void StatsTracker::writeIStats() {
   istatsMask.set(sm.getStatisticID("InstructionTimes"));
   istatsMask.set(sm.getStatisticID("InstructionRealTimes"));
   istatsMask.set(sm.getStatisticID("Forks"));
+  istatsMask.set(sm.getStatisticID("ForkTime"));
+  istatsMask.set(sm.getStatisticID("ForkCopyTime"));
+  istatsMask.set(sm.getStatisticID("ForkCopyBytes"));
+  istatsMask.set(sm.getStatisticID("ForkQueryTime"));
   istatsMask.set(sm.getStatisticID("CoveredInstructions"));
   istatsMask.set(sm.getStatisticID("UncoveredInstructions"));
   istatsMask.set(sm.getStatisticID("States"));
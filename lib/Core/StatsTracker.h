@@ -61,6 +61,8 @@ namespace klee {
 
   private:
     void updateStateStatistics(uint64_t addend);
+    // recompute fullBranches and partialBranches from the indexed stats
+    void recountBranches();
     void writeStatsHeader();
     void writeStatsLine();
     void writeIStats();
@@ -90,6 +92,10 @@ namespace klee {
     // called when execution is done and stats files should be flushed
     void done();
 
+    // called in the worker processes of a parallel exploration, which must
+    // not write to the stats files of the process that opened them
+    void disableOutput();
+
     // process stats for a single instruction step, es is the state
     // about to be stepped
     void stepInstruction(ExecutionState &es);
@@ -12,17 +12,218 @@
 #include "ExecutionState.h"
 
 #include "klee/Config/Version.h"
+#include "klee/Expr/Assignment.h"
+#include "klee/Expr/ExprUtil.h"
 #include "klee/Statistics/Statistics.h"
 #include "klee/Statistics/TimerStatIncrementer.h"
 #include "klee/Solver/Solver.h"
+#include "klee/Support/OptionCategories.h"
 
 #include "CoreStats.h"
 
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Format.h"
+
+#include <algorithm>
+
 using namespace klee;
 using namespace llvm;
 
+namespace {
+cl::opt<bool> AdaptiveSolverTimeout(
+    "adaptive-solver-timeout", cl::init(false),
+    cl::desc("Derive the timeout of branch queries from the query times seen "
+             "at the same instruction. Queries cut off by this timeout are "
+             "retried later with twice the budget, up to --max-solver-time "
+             "(default=false)"),
+    cl::cat(SolvingCat));
+
+cl::opt<unsigned> AdaptiveSolverTimeoutPercentile(
+    "adaptive-solver-timeout-percentile", cl::init(95),
+    cl::desc("Percentile of the query times at an instruction that the "
+             "adaptive timeout is based on (default=95)"),
+    cl::cat(SolvingCat));
+
+cl::opt<unsigned> AdaptiveSolverTimeoutFactor(
+    "adaptive-solver-timeout-factor", cl::init(4),
+    cl::desc("Multiple of the percentile that a query may take before it is "
+             "cut off (default=4)"),
+    cl::cat(SolvingCat));
+
+cl::opt<std::string> AdaptiveSolverTimeoutMin(
+    "adaptive-solver-timeout-min", cl::init("50ms"),
+    cl::desc("Lower bound of the adaptive timeout (default=50ms)"),
+    cl::cat(SolvingCat));
+
+cl::opt<unsigned> StateModelCacheSize(
+    "state-model-cache-size", cl::init(0),
+    cl::desc("Number of recent solver models kept per state. Queries that "
+             "these models already answer are not sent to the solver "
+             "(default=0 (off))"),
+    cl::cat(SolvingCat));
+
+/// Number of query times kept per instruction.
+const unsigned SiteProfileSize = 64;
+
+/// Minimum number of query times at an instruction before its timeout is
+/// adapted.
+const unsigned SiteProfileMinSamples = 8;
+} // namespace
+
 /***/
 
+void TimingSolver::recordQueryTime(time::Span t) {
+  std::uint64_t us = t.toMicroseconds();
+  unsigned bucket = 0;
+  while (us) {
+    ++bucket;
+    us >>= 1;
+  }
+  if (bucket >= queryTimeHistogram.size())
+    queryTimeHistogram.resize(bucket + 1);
+  ++queryTimeHistogram[bucket];
+
+  if (!currentSite)
+    return;
+  SiteProfile &profile = siteProfiles[currentSite];
+  if (profile.samples.size() < SiteProfileSize) {
+    profile.samples.push_back(t);
+  } else {
+    profile.samples[profile.next] = t;
+    profile.next = (profile.next + 1) % SiteProfileSize;
+  }
+}
+
+time::Span TimingSolver::setAdaptiveTimeout(time::Span maxTimeout,
+                                            const KInstruction *site,
+                                            unsigned retries) {
+  time::Span timeout = maxTimeout;
+
+  auto it = siteProfiles.find(site);
+  if (AdaptiveSolverTimeout && it != siteProfiles.end() &&
+      it->second.samples.size() >= SiteProfileMinSamples) {
+    std::vector<time::Span> samples = it->second.samples;
+    unsigned percentile = std::min(AdaptiveSolverTimeoutPercentile.getValue(),
+                                   100u);
+    auto nth = samples.begin() + (samples.size() - 1) * percentile / 100;
+    std::nth_element(samples.begin(), nth, samples.end());
+
+    std::uint64_t budget =
+        std::max(nth->toMicroseconds() * AdaptiveSolverTimeoutFactor,
+                 time::Span(AdaptiveSolverTimeoutMin).toMicroseconds());
+    budget <<= std::min(retries, 32u);
+    if (!maxTimeout || budget < maxTimeout.toMicroseconds())
+      timeout = time::microseconds(budget);
+  }
+
+  solver->setCoreSolverTimeout(timeout);
+  currentSite = site;
+  return timeout;
+}
+
+void TimingSolver::printQueryTimeHistogram(llvm::raw_ostream &os) const {
+  std::uint64_t total = 0;
+  for (std::uint64_t count : queryTimeHistogram)
+    total += count;
+
+  os << "# Query time (us)\tQueries\tPercent\n";
+  for (unsigned i = 0; i < queryTimeHistogram.size(); ++i) {
+    std::uint64_t lower = i ? (1ULL << (i - 1)) : 0;
+    std::uint64_t upper = 1ULL << i;
+    os << "[" << lower << ", " << upper << ")\t" << queryTimeHistogram[i]
+       << "\t"
+       << format("%.2f", total ? 100. * queryTimeHistogram[i] / total : 0.)
+       << "\n";
+  }
+}
+
+void TimingSolver::updateModels(const ConstraintSet &constraints,
+                                SolverQueryMetaData &metaData) {
+  auto &models = metaData.models;
+  auto &checked = metaData.modelConstraints;
+
+  // The models satisfy the constraints they have been checked against, so
+  // only the constraints that differ from those have to be evaluated.
+  auto mismatch = std::mismatch(checked.begin(), checked.end(),
+                                constraints.begin(), constraints.end());
+  if (mismatch.second != constraints.end() && !models.empty()) {
+    std::vector<const Assignment *> assignments;
+    for (const auto &model : models)
+      assignments.push_back(model.get());
+    AssignmentBatchEvaluator evaluator(assignments);
+
+    std::vector<bool> satisfying(models.size(), true);
+    unsigned numSatisfying = models.size();
+    for (auto it = mismatch.second;
+         it != constraints.end() && numSatisfying != 0; ++it) {
+      const AssignmentBatchEvaluator::values_ty &values =
+          evaluator.evaluate(*it);
+      for (unsigned i = 0; i != models.size(); ++i) {
+        if (satisfying[i] && (values[i].isNull() || !values[i]->isTrue())) {
+          satisfying[i] = false;
+          --numSatisfying;
+        }
+      }
+    }
+
+    unsigned kept = 0;
+    for (unsigned i = 0; i != models.size(); ++i)
+      if (satisfying[i])
+        models[kept++] = std::move(models[i]);
+    models.resize(kept);
+  }
+
+  checked.erase(mismatch.first, checked.end());
+  checked.insert(checked.end(), mismatch.second, constraints.end());
+}
+
+void TimingSolver::evaluateModels(const ConstraintSet &constraints,
+                                  ref<Expr> expr,
+                                  SolverQueryMetaData &metaData,
+                                  std::vector<ref<ConstantExpr>> &values) {
+  updateModels(constraints, metaData);
+  if (metaData.models.empty())
+    return;
+
+  std::vector<const Assignment *> models;
+  for (const auto &model : metaData.models)
+    models.push_back(model.get());
+  AssignmentBatchEvaluator evaluator(models);
+
+  const AssignmentBatchEvaluator::values_ty &exprValues =
+      evaluator.evaluate(expr);
+  for (const auto &value : exprValues)
+    if (!value.isNull())
+      values.push_back(value);
+}
+
+bool TimingSolver::solveForModel(const ConstraintSet &constraints,
+                                 ref<Expr> expr, ref<Expr> value,
+                                 SolverQueryMetaData &metaData,
+                                 bool &hasModel) {
+  std::vector<ref<Expr>> exprs(constraints.begin(), constraints.end());
+  exprs.push_back(expr);
+  exprs.push_back(value);
+  std::vector<const Array *> objects;
+  findSymbolicObjects(exprs.begin(), exprs.end(), objects);
+
+  std::vector<std::vector<unsigned char>> values;
+  if (!solver->impl->computeInitialValues(Query(constraints, expr), objects,
+                                          values, hasModel))
+    return false;
+  if (!hasModel)
+    return true;
+
+  // The models are checked against the constraints of the query before it
+  // is solved, so the new one joins models of the same constraints.
+  auto &models = metaData.models;
+  models.insert(models.begin(),
+                std::make_shared<const Assignment>(objects, values));
+  if (models.size() > StateModelCacheSize)
+    models.resize(StateModelCacheSize);
+  return true;
+}
+
 bool TimingSolver::evaluate(const ConstraintSet &constraints, ref<Expr> expr,
                             Solver::Validity &result,
                             SolverQueryMetaData &metaData) {
@@ -37,9 +238,38 @@ bool TimingSolver::evaluate(const ConstraintSet &constraints, ref<Expr> expr,
   if (simplifyExprs)
     expr = ConstraintManager::simplifyExpr(constraints, expr);
 
-  bool success = solver->evaluate(Query(constraints, expr), result);
+  bool success;
+  bool mayBeTrue = false, mayBeFalse = false;
+  if (StateModelCacheSize) {
+    std::vector<ref<ConstantExpr>> values;
+    evaluateModels(constraints, expr, metaData, values);
+    for (const auto &value : values)
+      (value->isTrue() ? mayBeTrue : mayBeFalse) = true;
+  }
+
+  if (mayBeTrue && mayBeFalse) {
+    ++stats::modelReuseHits;
+    result = Solver::Unknown;
+    success = true;
+  } else if (StateModelCacheSize) {
+    ++stats::modelReuseMisses;
+    // Solving for the missing kinds of model decides the validity as well.
+    success = true;
+    if (!mayBeFalse)
+      success = solveForModel(constraints, expr, expr, metaData, mayBeFalse);
+    if (success && mayBeFalse && !mayBeTrue)
+      success = solveForModel(constraints, Expr::createIsZero(expr), expr,
+                              metaData, mayBeTrue);
+    if (success)
+      result = !mayBeFalse ? Solver::True
+                           : mayBeTrue ? Solver::Unknown : Solver::False;
+  } else {
+    success = solver->evaluate(Query(constraints, expr), result);
+  }
 
-  metaData.queryCost += timer.delta();
+  time::Span delta = timer.delta();
+  metaData.queryCost += delta;
+  recordQueryTime(delta);
 
   return success;
 }
@@ -57,9 +287,30 @@ bool TimingSolver::mustBeTrue(const ConstraintSet &constraints, ref<Expr> expr,
   if (simplifyExprs)
     expr = ConstraintManager::simplifyExpr(constraints, expr);
 
-  bool success = solver->mustBeTrue(Query(constraints, expr), result);
+  bool success;
+  bool mayBeFalse = false;
+  if (StateModelCacheSize) {
+    std::vector<ref<ConstantExpr>> values;
+    evaluateModels(constraints, expr, metaData, values);
+    for (const auto &value : values)
+      mayBeFalse |= value->isFalse();
+  }
+
+  if (mayBeFalse) {
+    ++stats::modelReuseHits;
+    result = false;
+    success = true;
+  } else if (StateModelCacheSize) {
+    ++stats::modelReuseMisses;
+    success = solveForModel(constraints, expr, expr, metaData, mayBeFalse);
+    result = !mayBeFalse;
+  } else {
+    success = solver->mustBeTrue(Query(constraints, expr), result);
+  }
 
-  metaData.queryCost += timer.delta();
+  time::Span delta = timer.delta();
+  metaData.queryCost += delta;
+  recordQueryTime(delta);
 
   return success;
 }
@@ -101,9 +352,35 @@ bool TimingSolver::getValue(const ConstraintSet &constraints, ref<Expr> expr,
   if (simplifyExprs)
     expr = ConstraintManager::simplifyExpr(constraints, expr);
 
-  bool success = solver->getValue(Query(constraints, expr), result);
+  bool success;
+  std::vector<ref<ConstantExpr>> values;
+  if (StateModelCacheSize)
+    evaluateModels(constraints, expr, metaData, values);
+
+  if (!values.empty()) {
+    ++stats::modelReuseHits;
+    result = values.front();
+    success = true;
+  } else if (StateModelCacheSize) {
+    ++stats::modelReuseMisses;
+    bool hasModel;
+    success = solveForModel(constraints, ConstantExpr::alloc(0, Expr::Bool),
+                            expr, metaData, hasModel) &&
+              hasModel;
+    if (success) {
+      AssignmentBatchEvaluator evaluator({metaData.models.front().get()});
+      result = evaluator.evaluate(expr).front();
+      // Division by zero is left unevaluated
+      if (result.isNull())
+        success = solver->getValue(Query(constraints, expr), result);
+    }
+  } else {
+    success = solver->getValue(Query(constraints, expr), result);
+  }
 
-  metaData.queryCost += timer.delta();
+  time::Span delta = timer.delta();
+  metaData.queryCost += delta;
+  recordQueryTime(delta);
 
   return success;
 }
@@ -120,7 +397,9 @@ bool TimingSolver::getInitialValues(
   bool success = solver->getInitialValues(
       Query(constraints, ConstantExpr::alloc(0, Expr::Bool)), objects, result);
 
-  metaData.queryCost += timer.delta();
+  time::Span delta = timer.delta();
+  metaData.queryCost += delta;
+  recordQueryTime(delta);
 
   return success;
 }
@@ -130,6 +409,8 @@ TimingSolver::getRange(const ConstraintSet &constraints, ref<Expr> expr,
                        SolverQueryMetaData &metaData) {
   TimerStatIncrementer timer(stats::solverTime);
   auto result = solver->getRange(Query(constraints, expr));
-  metaData.queryCost += timer.delta();
+  time::Span delta = timer.delta();
+  metaData.queryCost += delta;
+  recordQueryTime(delta);
   return result;
 }
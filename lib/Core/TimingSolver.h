@@ -13,13 +13,19 @@
 #include "klee/Expr/Constraints.h"
 #include "klee/Expr/Expr.h"
 #include "klee/Solver/Solver.h"
+#include "klee/Solver/SolverImpl.h"
 #include "klee/System/Time.h"
 
+#include "llvm/Support/raw_ostream.h"
+
+#include <cstdint>
 #include <memory>
+#include <unordered_map>
 #include <vector>
 
 namespace klee {
 class ConstraintSet;
+struct KInstruction;
 class Solver;
 
 /// TimingSolver - A simple class which wraps a solver and handles
@@ -29,6 +35,53 @@ public:
   std::unique_ptr<Solver> solver;
   bool simplifyExprs;
 
+private:
+  /// The most recent query times observed at one call site.
+  struct SiteProfile {
+    std::vector<time::Span> samples;
+    /// Position of the oldest sample once the buffer is full.
+    unsigned next = 0;
+  };
+
+  std::unordered_map<const KInstruction *, SiteProfile> siteProfiles;
+
+  /// The call site of the queries issued under the current timeout, if set
+  /// through setAdaptiveTimeout.
+  const KInstruction *currentSite = nullptr;
+
+  /// Number of queries per bucket, where bucket i holds query times in
+  /// [2^(i-1), 2^i) microseconds.
+  std::vector<std::uint64_t> queryTimeHistogram;
+
+  void recordQueryTime(time::Span t);
+
+  /// updateModels - Drop the recent models in \a metaData that do not
+  /// satisfy \a constraints. Only the constraints the models have not been
+  /// checked against yet are evaluated.
+  void updateModels(const ConstraintSet &constraints,
+                    SolverQueryMetaData &metaData);
+
+  /// evaluateModels - Evaluate \a expr under the recent models in \a
+  /// metaData, after dropping the ones that do not satisfy \a constraints.
+  ///
+  /// \param values [out] - The values of \a expr, most recent model first.
+  void evaluateModels(const ConstraintSet &constraints, ref<Expr> expr,
+                      SolverQueryMetaData &metaData,
+                      std::vector<ref<ConstantExpr>> &values);
+
+  /// solveForModel - Ask the solver for a model of \a constraints under
+  /// which \a expr is false, and add it to the recent models in \a
+  /// metaData. This answers the query the model is computed for, so no
+  /// separate solver call is needed.
+  ///
+  /// \param value - An expression the model has to bind the arrays of.
+  /// \param hasModel [out] - Whether such a model exists. If so, it is
+  /// the most recent model in \a metaData.
+  /// \return False if the solver failed.
+  bool solveForModel(const ConstraintSet &constraints, ref<Expr> expr,
+                     ref<Expr> value, SolverQueryMetaData &metaData,
+                     bool &hasModel);
+
 public:
   /// TimingSolver - Construct a new timing solver.
   ///
@@ -38,12 +91,36 @@ public:
   TimingSolver(Solver *_solver, bool _simplifyExprs = true)
       : solver(_solver), simplifyExprs(_simplifyExprs) {}
 
-  void setTimeout(time::Span t) { solver->setCoreSolverTimeout(t); }
+  void setTimeout(time::Span t) {
+    currentSite = nullptr;
+    solver->setCoreSolverTimeout(t);
+  }
+
+  /// setAdaptiveTimeout - Set the timeout for the next queries issued at
+  /// \a site. With --adaptive-solver-timeout, the timeout is derived from
+  /// the query times previously seen at the site and doubled for every
+  /// earlier attempt that was cut off; otherwise it is \a maxTimeout.
+  ///
+  /// \param maxTimeout - The largest timeout to use, zero for none.
+  /// \param retries - The number of times the query has been cut off.
+  /// \return The timeout that was set.
+  time::Span setAdaptiveTimeout(time::Span maxTimeout, const KInstruction *site,
+                                unsigned retries);
+
+  /// printQueryTimeHistogram - Print the distribution of the query times
+  /// observed so far.
+  void printQueryTimeHistogram(llvm::raw_ostream &os) const;
 
   char *getConstraintLog(const Query &query) {
     return solver->getConstraintLog(query);
   }
 
+  /// getOperationStatusCode - The status of the last query, e.g. whether
+  /// it timed out.
+  SolverImpl::SolverRunStatus getOperationStatusCode() {
+    return solver->impl->getOperationStatusCode();
+  }
+
   bool evaluate(const ConstraintSet &, ref<Expr>, Solver::Validity &result,
                 SolverQueryMetaData &metaData);
 
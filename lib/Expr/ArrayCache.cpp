@@ -9,8 +9,8 @@ ArrayCache::~ArrayCache() {
        ai != e; ++ai) {
     delete *ai;
   }
-  for (ArrayPtrVec::iterator ai = concreteArrays.begin(),
-                             e = concreteArrays.end();
+  for (ConstantArrayHashMap::iterator ai = cachedConstantArrays.begin(),
+                                      e = cachedConstantArrays.end();
        ai != e; ++ai) {
     delete *ai;
   }
@@ -38,10 +38,17 @@ ArrayCache::CreateArray(const std::string &_name, uint64_t _size,
            "Cached symbolic array is no longer symbolic");
     return array;
   } else {
-    // Treat every constant array as distinct so we never cache them
+    // Identical tables share one array, and so its encoding in the solvers
     assert(array->isConstantArray());
-    concreteArrays.push_back(array); // For deletion later
-    return array;
+    std::pair<ConstantArrayHashMap::const_iterator, bool> success =
+        cachedConstantArrays.insert(array);
+    if (success.second) {
+      // Cache miss
+      return array;
+    }
+    // Cache hit
+    delete array;
+    return *(success.first);
   }
 }
 }
@@ -25,6 +25,63 @@ void Assignment::dump() {
   }
 }
 
+AssignmentBatchEvaluator::AssignmentBatchEvaluator(
+    const std::vector<const Assignment *> &assignments) {
+  for (const Assignment *assignment : assignments)
+    evaluators.emplace_back(new AssignmentEvaluator(*assignment));
+}
+
+const AssignmentBatchEvaluator::values_ty &
+AssignmentBatchEvaluator::evaluate(const ref<Expr> &e) {
+  auto it = cache.find(e);
+  if (it != cache.end())
+    return it->second;
+
+  const unsigned n = evaluators.size();
+  values_ty values(n);
+
+  if (ConstantExpr *CE = dyn_cast<ConstantExpr>(e)) {
+    values.assign(n, CE);
+  } else if (NotOptimizedExpr *NOE = dyn_cast<NotOptimizedExpr>(e)) {
+    values = evaluate(NOE->src);
+  } else if (ReadExpr *RE = dyn_cast<ReadExpr>(e)) {
+    // Reads depend on the update list, which is walked separately for every
+    // assignment by its evaluator.
+    const values_ty &indices = evaluate(RE->index);
+    for (unsigned i = 0; i != n; ++i) {
+      if (indices[i].isNull())
+        continue;
+      ref<Expr> value = evaluators[i]->visit(ReadExpr::create(
+          RE->updates, indices[i]));
+      values[i] = dyn_cast<ConstantExpr>(value);
+    }
+  } else {
+    unsigned numKids = e->getNumKids();
+    assert(numKids <= 3 && "unexpected number of kids");
+    // References into the cache stay valid when it grows.
+    const values_ty *kidValues[3];
+    for (unsigned k = 0; k != numKids; ++k)
+      kidValues[k] = &evaluate(e->getKid(k));
+
+    bool isDivision = isa<UDivExpr>(e) || isa<SDivExpr>(e) ||
+                      isa<URemExpr>(e) || isa<SRemExpr>(e);
+    for (unsigned i = 0; i != n; ++i) {
+      ref<Expr> kids[3];
+      bool known = true;
+      for (unsigned k = 0; k != numKids && known; ++k) {
+        kids[k] = (*kidValues[k])[i];
+        known = !kids[k].isNull();
+      }
+      // Leave divisions by zero unevaluated, as ExprEvaluator does.
+      if (!known || (isDivision && cast<ConstantExpr>(kids[1])->isZero()))
+        continue;
+      values[i] = dyn_cast<ConstantExpr>(e->rebuild(kids));
+    }
+  }
+
+  return cache.insert(std::make_pair(e, std::move(values))).first->second;
+}
+
 ConstraintSet Assignment::createConstraintsFromAssignment() const {
   ConstraintSet result;
   for (const auto &binding : bindings) {
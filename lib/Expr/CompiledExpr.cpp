@@ -0,0 +1,412 @@
+//===-- CompiledExpr.cpp --------------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "klee/Expr/CompiledExpr.h"
+
+#include "klee/Expr/Assignment.h"
+#include "klee/Expr/ExprHashMap.h"
+
+#include <algorithm>
+#include <map>
+#include <unordered_map>
+
+using namespace klee;
+
+namespace klee {
+
+/// ExprCompiler - Emits the instructions for an expression DAG, sharing the
+/// registers of common subexpressions and update list suffixes.
+class ExprCompiler {
+  CompiledExpr &compiled;
+  ExprHashMap<uint32_t> registers;
+  std::unordered_map<const UpdateNode *, int32_t> writes;
+  std::unordered_map<const Array *, unsigned> arrays;
+  std::map<std::pair<const Array *, const UpdateNode *>, unsigned> updateLists;
+  bool failed;
+
+  uint32_t emit(CompiledExpr::Opcode op, Expr::Width width, uint32_t a = 0,
+                uint32_t b = 0, uint32_t c = 0, uint64_t imm = 0) {
+    compiled.program.push_back({op, static_cast<uint8_t>(width), a, b, c, imm});
+    return compiled.program.size() - 1;
+  }
+
+  unsigned compileUpdates(const UpdateList &ul);
+  uint32_t compileExpr(const ref<Expr> &e);
+
+public:
+  explicit ExprCompiler(CompiledExpr &compiled)
+      : compiled(compiled), failed(false) {}
+
+  /// compile - Compile \a e and return its register, or false on failure.
+  bool compile(const ref<Expr> &e, uint32_t &reg) {
+    reg = compileExpr(e);
+    return !failed;
+  }
+};
+
+} // namespace klee
+
+unsigned ExprCompiler::compileUpdates(const UpdateList &ul) {
+  auto key = std::make_pair(ul.root, ul.head.get());
+  auto it = updateLists.find(key);
+  if (it != updateLists.end())
+    return it->second;
+
+  auto ait = arrays.find(ul.root);
+  if (ait == arrays.end()) {
+    if (ul.root->getDomain() != Expr::Int32 ||
+        ul.root->getRange() != Expr::Int8)
+      failed = true;
+    ait = arrays.insert(std::make_pair(ul.root, compiled.arrays.size())).first;
+    compiled.arrays.push_back(ul.root);
+  }
+
+  // Compile the writes that are not shared with another update list, from
+  // the oldest one upwards.
+  std::vector<const UpdateNode *> chain;
+  for (const UpdateNode *un = ul.head.get(); un && !writes.count(un);
+       un = un->next.get())
+    chain.push_back(un);
+  for (auto cit = chain.rbegin(), cie = chain.rend(); cit != cie; ++cit) {
+    const UpdateNode *un = *cit;
+    int32_t next = un->next.isNull() ? -1 : writes.find(un->next.get())->second;
+    uint32_t index = compileExpr(un->index);
+    uint32_t value = compileExpr(un->value);
+    writes.insert(std::make_pair(un, compiled.writes.size()));
+    compiled.writes.push_back({index, value, next});
+  }
+
+  int32_t head = ul.head.isNull() ? -1 : writes.find(ul.head.get())->second;
+  unsigned id = compiled.updateLists.size();
+  compiled.updateLists.push_back({ait->second, head});
+  updateLists.insert(std::make_pair(key, id));
+  return id;
+}
+
+uint32_t ExprCompiler::compileExpr(const ref<Expr> &e) {
+  auto it = registers.find(e);
+  if (it != registers.end())
+    return it->second;
+
+  Expr::Width width = e->getWidth();
+  if (failed || width > Expr::Int64) {
+    failed = true;
+    return 0;
+  }
+
+  uint32_t reg;
+  switch (e->getKind()) {
+  case Expr::Constant:
+    reg = emit(CompiledExpr::Const, width, 0, 0, 0,
+               cast<ConstantExpr>(e)->getZExtValue());
+    break;
+
+  case Expr::NotOptimized:
+  case Expr::ZExt:
+    // Registers hold zero-extended values.
+    reg = compileExpr(e->getKid(0));
+    break;
+
+  case Expr::Read: {
+    const ReadExpr *re = cast<ReadExpr>(e);
+    uint32_t index = compileExpr(re->index);
+    unsigned updates = compileUpdates(re->updates);
+    reg = emit(CompiledExpr::Read, width, index, 0, 0, updates);
+    break;
+  }
+
+  case Expr::Select:
+    reg = emit(CompiledExpr::Select, width, compileExpr(e->getKid(0)),
+               compileExpr(e->getKid(1)), compileExpr(e->getKid(2)));
+    break;
+
+  case Expr::Concat:
+    reg = emit(CompiledExpr::Concat, width, compileExpr(e->getKid(0)),
+               compileExpr(e->getKid(1)), 0, e->getKid(1)->getWidth());
+    break;
+
+  case Expr::Extract:
+    reg = emit(CompiledExpr::Extract, width, compileExpr(e->getKid(0)), 0, 0,
+               cast<ExtractExpr>(e)->offset);
+    break;
+
+  case Expr::SExt:
+    reg = emit(CompiledExpr::SExt, width, compileExpr(e->getKid(0)), 0, 0,
+               e->getKid(0)->getWidth());
+    break;
+
+  case Expr::Not:
+    reg = emit(CompiledExpr::Not, width, compileExpr(e->getKid(0)));
+    break;
+
+#define BINARY(KIND)                                                           \
+  case Expr::KIND:                                                             \
+    reg = emit(CompiledExpr::KIND, width, compileExpr(e->getKid(0)),           \
+               compileExpr(e->getKid(1)));                                     \
+    break;
+  BINARY(Add)
+  BINARY(Sub)
+  BINARY(Mul)
+  BINARY(UDiv)
+  BINARY(SDiv)
+  BINARY(URem)
+  BINARY(SRem)
+  BINARY(And)
+  BINARY(Or)
+  BINARY(Xor)
+  BINARY(Shl)
+  BINARY(LShr)
+  BINARY(AShr)
+#undef BINARY
+
+  // Comparisons keep the width of their operands in imm, and the remaining
+  // ones are expressed through Eq, Ult, Ule, Slt and Sle.
+#define COMPARE(KIND, OP, LEFT, RIGHT)                                         \
+  case Expr::KIND:                                                             \
+    reg = emit(CompiledExpr::OP, width, compileExpr(e->getKid(LEFT)),          \
+               compileExpr(e->getKid(RIGHT)), 0, e->getKid(0)->getWidth());    \
+    break;
+  COMPARE(Eq, Eq, 0, 1)
+  COMPARE(Ult, Ult, 0, 1)
+  COMPARE(Ule, Ule, 0, 1)
+  COMPARE(Ugt, Ult, 1, 0)
+  COMPARE(Uge, Ule, 1, 0)
+  COMPARE(Slt, Slt, 0, 1)
+  COMPARE(Sle, Sle, 0, 1)
+  COMPARE(Sgt, Slt, 1, 0)
+  COMPARE(Sge, Sle, 1, 0)
+#undef COMPARE
+
+  case Expr::Ne: {
+    uint32_t eq = emit(CompiledExpr::Eq, width, compileExpr(e->getKid(0)),
+                       compileExpr(e->getKid(1)), 0, e->getKid(0)->getWidth());
+    reg = emit(CompiledExpr::Not, width, eq);
+    break;
+  }
+
+  default:
+    failed = true;
+    return 0;
+  }
+
+  registers.insert(std::make_pair(e, reg));
+  return reg;
+}
+
+/***/
+
+std::unique_ptr<CompiledExpr>
+CompiledExpr::compile(const std::vector<ref<Expr> > &exprs) {
+  std::unique_ptr<CompiledExpr> compiled(new CompiledExpr());
+  ExprCompiler compiler(*compiled);
+  for (const auto &e : exprs) {
+    uint32_t reg;
+    if (e->getWidth() != Expr::Bool || !compiler.compile(e, reg))
+      return nullptr;
+    compiled->roots.push_back(std::make_pair(reg, compiled->program.size()));
+  }
+  return compiled;
+}
+
+static inline uint64_t mask(uint64_t value, unsigned width) {
+  return width >= 64 ? value : value & ((UINT64_C(1) << width) - 1);
+}
+
+static inline int64_t sext(uint64_t value, unsigned width) {
+  unsigned shift = 64 - width;
+  return static_cast<int64_t>(value << shift) >> shift;
+}
+
+void CompiledExpr::run(const Assignment *const *assignments, unsigned count,
+                       bool *result) const {
+  assert(count > 0 && count <= BatchSize && "invalid batch");
+
+  // Look up the bindings of every array once per assignment.
+  std::vector<const std::vector<unsigned char> *> bound(arrays.size() *
+                                                        BatchSize);
+  for (unsigned i = 0; i != arrays.size(); ++i) {
+    for (unsigned l = 0; l != count; ++l) {
+      auto it = assignments[l]->bindings.find(arrays[i]);
+      if (it != assignments[l]->bindings.end())
+        bound[i * BatchSize + l] = &it->second;
+    }
+  }
+
+  std::vector<uint64_t> registers(program.size() * BatchSize);
+  bool alive[BatchSize];
+  for (unsigned l = 0; l != count; ++l)
+    alive[l] = true;
+
+#define REG(R) (&registers[static_cast<size_t>(R) * BatchSize])
+#define LANES for (unsigned l = 0; l != count; ++l)
+
+  unsigned pc = 0;
+  for (const auto &root : roots) {
+    for (; pc != root.second; ++pc) {
+      const Instruction &in = program[pc];
+      const unsigned w = in.width;
+      uint64_t *r = REG(pc);
+      const uint64_t *a = REG(in.a), *b = REG(in.b), *c = REG(in.c);
+
+      switch (in.op) {
+      case Const:
+        LANES r[l] = in.imm;
+        break;
+      case Read: {
+        const Updates &ul = updateLists[in.imm];
+        const Array *array = arrays[ul.array];
+        LANES {
+          uint64_t index = a[l];
+          int32_t write = ul.head;
+          while (write >= 0 && REG(writes[write].index)[l] != index)
+            write = writes[write].next;
+          if (write >= 0) {
+            r[l] = REG(writes[write].value)[l];
+          } else if (array->isConstantArray() && index < array->size) {
+            r[l] = array->constantValues[index]->getZExtValue();
+          } else {
+            const std::vector<unsigned char> *values =
+                bound[ul.array * BatchSize + l];
+            if (values && index < values->size()) {
+              r[l] = (*values)[index];
+            } else {
+              r[l] = 0;
+              if (assignments[l]->allowFreeValues)
+                alive[l] = false;
+            }
+          }
+        }
+        break;
+      }
+      case Select:
+        LANES r[l] = a[l] ? b[l] : c[l];
+        break;
+      case Concat:
+        LANES r[l] = (a[l] << in.imm) | b[l];
+        break;
+      case Extract:
+        LANES r[l] = mask(a[l] >> in.imm, w);
+        break;
+      case SExt:
+        LANES r[l] = mask(sext(a[l], in.imm), w);
+        break;
+      case Not:
+        LANES r[l] = mask(~a[l], w);
+        break;
+      case Add:
+        LANES r[l] = mask(a[l] + b[l], w);
+        break;
+      case Sub:
+        LANES r[l] = mask(a[l] - b[l], w);
+        break;
+      case Mul:
+        LANES r[l] = mask(a[l] * b[l], w);
+        break;
+      case UDiv:
+        LANES {
+          alive[l] = alive[l] && b[l];
+          r[l] = b[l] ? a[l] / b[l] : 0;
+        }
+        break;
+      case URem:
+        LANES {
+          alive[l] = alive[l] && b[l];
+          r[l] = b[l] ? a[l] % b[l] : 0;
+        }
+        break;
+      case SDiv:
+        LANES {
+          int64_t x = sext(a[l], w), y = sext(b[l], w);
+          alive[l] = alive[l] && y;
+          // Avoid the overflow of INT_MIN / -1, which wraps to INT_MIN.
+          r[l] = mask(y == -1 ? -static_cast<uint64_t>(x) : y ? x / y : 0, w);
+        }
+        break;
+      case SRem:
+        LANES {
+          int64_t x = sext(a[l], w), y = sext(b[l], w);
+          alive[l] = alive[l] && y;
+          r[l] = mask(y == -1 || !y ? 0 : x % y, w);
+        }
+        break;
+      case And:
+        LANES r[l] = a[l] & b[l];
+        break;
+      case Or:
+        LANES r[l] = a[l] | b[l];
+        break;
+      case Xor:
+        LANES r[l] = a[l] ^ b[l];
+        break;
+      case Shl:
+        LANES r[l] = b[l] >= w ? 0 : mask(a[l] << b[l], w);
+        break;
+      case LShr:
+        LANES r[l] = b[l] >= w ? 0 : a[l] >> b[l];
+        break;
+      case AShr:
+        LANES {
+          int64_t x = sext(a[l], w);
+          r[l] = mask(b[l] >= w ? (x < 0 ? -1 : 0) : x >> b[l], w);
+        }
+        break;
+      case Eq:
+        LANES r[l] = a[l] == b[l];
+        break;
+      case Ult:
+        LANES r[l] = a[l] < b[l];
+        break;
+      case Ule:
+        LANES r[l] = a[l] <= b[l];
+        break;
+      case Slt:
+        LANES r[l] = sext(a[l], in.imm) < sext(b[l], in.imm);
+        break;
+      case Sle:
+        LANES r[l] = sext(a[l], in.imm) <= sext(b[l], in.imm);
+        break;
+      }
+    }
+
+    const uint64_t *value = REG(root.first);
+    bool anyAlive = false;
+    LANES {
+      alive[l] = alive[l] && value[l];
+      anyAlive |= alive[l];
+    }
+    if (!anyAlive)
+      break;
+  }
+
+#undef LANES
+#undef REG
+
+  for (unsigned l = 0; l != count; ++l)
+    result[l] = alive[l];
+}
+
+bool CompiledExpr::satisfiedBy(const Assignment &a) const {
+  const Assignment *assignment = &a;
+  bool result;
+  run(&assignment, 1, &result);
+  return result;
+}
+
+void CompiledExpr::satisfiedBy(
+    const std::vector<const Assignment *> &assignments,
+    std::vector<bool> &result) const {
+  result.assign(assignments.size(), false);
+  bool batchResult[BatchSize];
+  for (unsigned i = 0; i < assignments.size(); i += BatchSize) {
+    unsigned count = std::min<unsigned>(BatchSize, assignments.size() - i);
+    run(&assignments[i], count, batchResult);
+    for (unsigned l = 0; l != count; ++l)
+      result[i + l] = batchResult[l];
+  }
+}
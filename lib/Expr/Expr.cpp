@@ -41,7 +41,25 @@ cl::opt<bool> ConstArrayOpt(
 
 /***/
 
-unsigned Expr::count = 0;
+std::atomic<unsigned> Expr::count(0);
+
+ConstantExpr *ConstantExpr::smallValues[5][ConstantExpr::numSmallValues];
+
+bool ConstantExpr::initializeSmallValues() {
+  for (Width w : {Bool, Int8, Int16, Int32, Int64}) {
+    int index = getSmallValuesIndex(w);
+    uint64_t count = w == Bool ? 2 : numSmallValues;
+    for (uint64_t v = 0; v < count; ++v) {
+      ConstantExpr *ce = new ConstantExpr(llvm::APInt(w, v));
+      ce->computeHash();
+      ce->_refCount.makeImmortal();
+      smallValues[index][v] = ce;
+    }
+  }
+  return true;
+}
+
+bool ConstantExpr::smallValuesInitialized = initializeSmallValues();
 
 ref<Expr> Expr::createTempRead(const Array *array, Expr::Width w) {
   UpdateList ul(array, 0);
@@ -90,7 +108,7 @@ ref<Expr> Expr::createTempRead(const Array *array, Expr::Width w) {
 }
 
 int Expr::compare(const Expr &b) const {
-  static ExprEquivSet equivs;
+  static thread_local ExprEquivSet equivs;
   int r = compare(b, equivs);
   equivs.clear();
   return r;
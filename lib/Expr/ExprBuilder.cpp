@@ -8,6 +8,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "klee/Expr/ExprBuilder.h"
+#include "klee/Expr/ExprHashMap.h"
 
 using namespace klee;
 
@@ -1052,6 +1053,249 @@ namespace {
 
   typedef ConstantSpecializedExprBuilder<SimplifyingBuilder>
     SimplifyingExprBuilder;
+
+  /// HashConsingBuilder - Expression builder which interns every expression
+  /// built by its base builder, so that structurally equal expressions are
+  /// represented by a single node. Equality checks between interned
+  /// expressions then succeed on the pointer comparison at the start of
+  /// Expr::compare, and shared subterms are only stored once.
+  class HashConsingBuilder : public ExprBuilder {
+    /// Base - The base builder class for constructing expressions.
+    ExprBuilder *Base;
+
+    /// Table - The canonical representative of every expression built so
+    /// far. The table keeps its members alive for the lifetime of the
+    /// builder.
+    ExprHashSet Table;
+
+    ref<Expr> intern(const ref<Expr> &E) {
+      ExprHashSet::iterator it = Table.find(E);
+      if (it != Table.end())
+        return *it;
+
+      // Expressions built internally by the base builder (or passed in by
+      // the client) were not interned, so canonicalize the kids first to
+      // make subterms shared as well.
+      unsigned NumKids = E->getNumKids();
+      ref<Expr> Kids[8];
+      bool Changed = false;
+      for (unsigned i = 0; i != NumKids; ++i) {
+        Kids[i] = intern(E->getKid(i));
+        Changed |= Kids[i].get() != E->getKid(i).get();
+      }
+
+      ref<Expr> Canonical = Changed ? rebuild(E, Kids) : E;
+      return *Table.insert(Canonical).first;
+    }
+
+    /// rebuild - Construct a copy of \arg E with the given kids through the
+    /// base builder, which (unlike Expr::rebuild) keeps the shape the base
+    /// builder would have produced.
+    ref<Expr> rebuild(const ref<Expr> &E, ref<Expr> Kids[]) {
+      switch (E->getKind()) {
+      case Expr::NotOptimized:
+        return Base->NotOptimized(Kids[0]);
+      case Expr::Read:
+        return Base->Read(cast<ReadExpr>(E)->updates, Kids[0]);
+      case Expr::Select:
+        return Base->Select(Kids[0], Kids[1], Kids[2]);
+      case Expr::Concat:
+        return Base->Concat(Kids[0], Kids[1]);
+      case Expr::Extract:
+        return Base->Extract(Kids[0], cast<ExtractExpr>(E)->offset,
+                             E->getWidth());
+      case Expr::ZExt:
+        return Base->ZExt(Kids[0], E->getWidth());
+      case Expr::SExt:
+        return Base->SExt(Kids[0], E->getWidth());
+      case Expr::Not:
+        return Base->Not(Kids[0]);
+      case Expr::Add:
+        return Base->Add(Kids[0], Kids[1]);
+      case Expr::Sub:
+        return Base->Sub(Kids[0], Kids[1]);
+      case Expr::Mul:
+        return Base->Mul(Kids[0], Kids[1]);
+      case Expr::UDiv:
+        return Base->UDiv(Kids[0], Kids[1]);
+      case Expr::SDiv:
+        return Base->SDiv(Kids[0], Kids[1]);
+      case Expr::URem:
+        return Base->URem(Kids[0], Kids[1]);
+      case Expr::SRem:
+        return Base->SRem(Kids[0], Kids[1]);
+      case Expr::And:
+        return Base->And(Kids[0], Kids[1]);
+      case Expr::Or:
+        return Base->Or(Kids[0], Kids[1]);
+      case Expr::Xor:
+        return Base->Xor(Kids[0], Kids[1]);
+      case Expr::Shl:
+        return Base->Shl(Kids[0], Kids[1]);
+      case Expr::LShr:
+        return Base->LShr(Kids[0], Kids[1]);
+      case Expr::AShr:
+        return Base->AShr(Kids[0], Kids[1]);
+      case Expr::Eq:
+        return Base->Eq(Kids[0], Kids[1]);
+      case Expr::Ne:
+        return Base->Ne(Kids[0], Kids[1]);
+      case Expr::Ult:
+        return Base->Ult(Kids[0], Kids[1]);
+      case Expr::Ule:
+        return Base->Ule(Kids[0], Kids[1]);
+      case Expr::Ugt:
+        return Base->Ugt(Kids[0], Kids[1]);
+      case Expr::Uge:
+        return Base->Uge(Kids[0], Kids[1]);
+      case Expr::Slt:
+        return Base->Slt(Kids[0], Kids[1]);
+      case Expr::Sle:
+        return Base->Sle(Kids[0], Kids[1]);
+      case Expr::Sgt:
+        return Base->Sgt(Kids[0], Kids[1]);
+      case Expr::Sge:
+        return Base->Sge(Kids[0], Kids[1]);
+      default:
+        return E->rebuild(Kids);
+      }
+    }
+
+  public:
+    HashConsingBuilder(ExprBuilder *_Base) : Base(_Base) {}
+    ~HashConsingBuilder() { delete Base; }
+
+    virtual ref<Expr> Constant(const llvm::APInt &Value) {
+      return intern(Base->Constant(Value));
+    }
+
+    virtual ref<Expr> NotOptimized(const ref<Expr> &Index) {
+      return intern(Base->NotOptimized(Index));
+    }
+
+    virtual ref<Expr> Read(const UpdateList &Updates,
+                           const ref<Expr> &Index) {
+      return intern(Base->Read(Updates, Index));
+    }
+
+    virtual ref<Expr> Select(const ref<Expr> &Cond,
+                             const ref<Expr> &LHS, const ref<Expr> &RHS) {
+      return intern(Base->Select(Cond, LHS, RHS));
+    }
+
+    virtual ref<Expr> Extract(const ref<Expr> &LHS,
+                              unsigned Offset, Expr::Width W) {
+      return intern(Base->Extract(LHS, Offset, W));
+    }
+
+    virtual ref<Expr> ZExt(const ref<Expr> &LHS, Expr::Width W) {
+      return intern(Base->ZExt(LHS, W));
+    }
+
+    virtual ref<Expr> SExt(const ref<Expr> &LHS, Expr::Width W) {
+      return intern(Base->SExt(LHS, W));
+    }
+
+    virtual ref<Expr> Not(const ref<Expr> &LHS) {
+      return intern(Base->Not(LHS));
+    }
+
+    virtual ref<Expr> Concat(const ref<Expr> &LHS, const ref<Expr> &RHS) {
+      return intern(Base->Concat(LHS, RHS));
+    }
+
+    virtual ref<Expr> Add(const ref<Expr> &LHS, const ref<Expr> &RHS) {
+      return intern(Base->Add(LHS, RHS));
+    }
+
+    virtual ref<Expr> Sub(const ref<Expr> &LHS, const ref<Expr> &RHS) {
+      return intern(Base->Sub(LHS, RHS));
+    }
+
+    virtual ref<Expr> Mul(const ref<Expr> &LHS, const ref<Expr> &RHS) {
+      return intern(Base->Mul(LHS, RHS));
+    }
+
+    virtual ref<Expr> UDiv(const ref<Expr> &LHS, const ref<Expr> &RHS) {
+      return intern(Base->UDiv(LHS, RHS));
+    }
+
+    virtual ref<Expr> SDiv(const ref<Expr> &LHS, const ref<Expr> &RHS) {
+      return intern(Base->SDiv(LHS, RHS));
+    }
+
+    virtual ref<Expr> URem(const ref<Expr> &LHS, const ref<Expr> &RHS) {
+      return intern(Base->URem(LHS, RHS));
+    }
+
+    virtual ref<Expr> SRem(const ref<Expr> &LHS, const ref<Expr> &RHS) {
+      return intern(Base->SRem(LHS, RHS));
+    }
+
+    virtual ref<Expr> And(const ref<Expr> &LHS, const ref<Expr> &RHS) {
+      return intern(Base->And(LHS, RHS));
+    }
+
+    virtual ref<Expr> Or(const ref<Expr> &LHS, const ref<Expr> &RHS) {
+      return intern(Base->Or(LHS, RHS));
+    }
+
+    virtual ref<Expr> Xor(const ref<Expr> &LHS, const ref<Expr> &RHS) {
+      return intern(Base->Xor(LHS, RHS));
+    }
+
+    virtual ref<Expr> Shl(const ref<Expr> &LHS, const ref<Expr> &RHS) {
+      return intern(Base->Shl(LHS, RHS));
+    }
+
+    virtual ref<Expr> LShr(const ref<Expr> &LHS, const ref<Expr> &RHS) {
+      return intern(Base->LShr(LHS, RHS));
+    }
+
+    virtual ref<Expr> AShr(const ref<Expr> &LHS, const ref<Expr> &RHS) {
+      return intern(Base->AShr(LHS, RHS));
+    }
+
+    virtual ref<Expr> Eq(const ref<Expr> &LHS, const ref<Expr> &RHS) {
+      return intern(Base->Eq(LHS, RHS));
+    }
+
+    virtual ref<Expr> Ne(const ref<Expr> &LHS, const ref<Expr> &RHS) {
+      return intern(Base->Ne(LHS, RHS));
+    }
+
+    virtual ref<Expr> Ult(const ref<Expr> &LHS, const ref<Expr> &RHS) {
+      return intern(Base->Ult(LHS, RHS));
+    }
+
+    virtual ref<Expr> Ule(const ref<Expr> &LHS, const ref<Expr> &RHS) {
+      return intern(Base->Ule(LHS, RHS));
+    }
+
+    virtual ref<Expr> Ugt(const ref<Expr> &LHS, const ref<Expr> &RHS) {
+      return intern(Base->Ugt(LHS, RHS));
+    }
+
+    virtual ref<Expr> Uge(const ref<Expr> &LHS, const ref<Expr> &RHS) {
+      return intern(Base->Uge(LHS, RHS));
+    }
+
+    virtual ref<Expr> Slt(const ref<Expr> &LHS, const ref<Expr> &RHS) {
+      return intern(Base->Slt(LHS, RHS));
+    }
+
+    virtual ref<Expr> Sle(const ref<Expr> &LHS, const ref<Expr> &RHS) {
+      return intern(Base->Sle(LHS, RHS));
+    }
+
+    virtual ref<Expr> Sgt(const ref<Expr> &LHS, const ref<Expr> &RHS) {
+      return intern(Base->Sgt(LHS, RHS));
+    }
+
+    virtual ref<Expr> Sge(const ref<Expr> &LHS, const ref<Expr> &RHS) {
+      return intern(Base->Sge(LHS, RHS));
+    }
+  };
 }
 
 ExprBuilder *klee::createDefaultExprBuilder() {
@@ -1065,3 +1309,7 @@ ExprBuilder *klee::createConstantFoldingExprBuilder(ExprBuilder *Base) {
 ExprBuilder *klee::createSimplifyingExprBuilder(ExprBuilder *Base) {
   return new SimplifyingExprBuilder(Base);
 }
+
+ExprBuilder *klee::createHashConsingExprBuilder(ExprBuilder *Base) {
+  return new HashConsingBuilder(Base);
+}
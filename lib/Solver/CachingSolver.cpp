@@ -10,12 +10,16 @@
 
 #include "klee/Solver/Solver.h"
 
+#include "klee/ADT/MapOfSets.h"
 #include "klee/Expr/Constraints.h"
 #include "klee/Expr/Expr.h"
+#include "klee/Expr/ExprHashMap.h"
 #include "klee/Solver/IncompleteSolver.h"
+#include "klee/Solver/SolverCmdLine.h"
 #include "klee/Solver/SolverImpl.h"
 #include "klee/Solver/SolverStats.h"
 
+#include <set>
 #include <unordered_map>
 
 using namespace klee;
@@ -30,6 +34,12 @@ private:
 
   bool cacheLookup(const Query& query,
                    IncompleteSolver::PartialValidity &result);
+
+  bool subsumptionLookup(const ref<Expr> &canonicalQuery,
+                         const ConstraintSet &constraints,
+                         IncompleteSolver::PartialValidity &result);
+
+  void countHit();
   
   struct CacheEntry {
     CacheEntry(const ConstraintSet &c, ref<Expr> q)
@@ -62,11 +72,25 @@ private:
                              CacheEntryHash>
       cache_map;
 
+  typedef std::set<ref<Expr> > KeyType;
+
+  /// Per canonical query expression, the results for all constraint sets it
+  /// was solved under. Used to answer queries whose constraints are a
+  /// superset (for MustBe results) or a subset (for MayBe results) of a
+  /// cached constraint set.
+  typedef ExprHashMap<MapOfSets<ref<Expr>, IncompleteSolver::PartialValidity> >
+      subsumption_map;
+
   Solver *solver;
   cache_map cache;
+  subsumption_map subsumptionCache;
+
+  /// Whether the result of the last successful cacheLookup came from the
+  /// subsumption cache.
+  bool lastHitSubsumed;
 
 public:
-  CachingSolver(Solver *s) : solver(s) {}
+  CachingSolver(Solver *s) : solver(s), lastHitSubsumed(false) {}
   ~CachingSolver() { cache.clear(); delete solver; }
 
   bool computeValidity(const Query&, Solver::Validity &result);
@@ -119,12 +143,71 @@ bool CachingSolver::cacheLookup(const Query& query,
     result = (negationUsed ?
               IncompleteSolver::negatePartialValidity(it->second) :
               it->second);
+    lastHitSubsumed = false;
+    return true;
+  }
+
+  if (BranchCacheSubsumption &&
+      subsumptionLookup(canonicalQuery, query.constraints, result)) {
+    if (negationUsed)
+      result = IncompleteSolver::negatePartialValidity(result);
+    lastHitSubsumed = true;
     return true;
   }
   
   return false;
 }
 
+namespace {
+struct IsMustBe {
+  bool operator()(IncompleteSolver::PartialValidity pv) const {
+    return pv == IncompleteSolver::MustBeTrue ||
+           pv == IncompleteSolver::MustBeFalse;
+  }
+};
+
+struct IsNotMustBe {
+  bool operator()(IncompleteSolver::PartialValidity pv) const {
+    return pv != IncompleteSolver::MustBeTrue &&
+           pv != IncompleteSolver::MustBeFalse;
+  }
+};
+} // namespace
+
+/// Looks for a cached result of the canonical query under a subset or a
+/// superset of the given constraints. Adding constraints preserves
+/// unsatisfiability, so a MustBe result of a subset still holds, while
+/// removing constraints preserves satisfiability, so a MayBe or TrueOrFalse
+/// result of a superset still holds.
+bool CachingSolver::subsumptionLookup(
+    const ref<Expr> &canonicalQuery, const ConstraintSet &constraints,
+    IncompleteSolver::PartialValidity &result) {
+  subsumption_map::iterator it = subsumptionCache.find(canonicalQuery);
+  if (it == subsumptionCache.end())
+    return false;
+
+  KeyType key(constraints.begin(), constraints.end());
+  if (IncompleteSolver::PartialValidity *pv =
+          it->second.findSubset(key, IsMustBe())) {
+    result = *pv;
+    return true;
+  }
+  if (IncompleteSolver::PartialValidity *pv =
+          it->second.findSuperset(key, IsNotMustBe())) {
+    result = *pv;
+    return true;
+  }
+  return false;
+}
+
+void CachingSolver::countHit() {
+  ++stats::queryCacheHits;
+  if (lastHitSubsumed)
+    ++stats::queryCacheSubsumptionHits;
+  else
+    ++stats::queryCacheExactHits;
+}
+
 /// Inserts the given query, result pair into the cache.
 void CachingSolver::cacheInsert(const Query& query,
                                 IncompleteSolver::PartialValidity result) {
@@ -136,6 +219,11 @@ void CachingSolver::cacheInsert(const Query& query,
     (negationUsed ? IncompleteSolver::negatePartialValidity(result) : result);
   
   cache.insert(std::make_pair(ce, cachedResult));
+
+  if (BranchCacheSubsumption)
+    subsumptionCache[canonicalQuery].insert(
+        KeyType(query.constraints.begin(), query.constraints.end()),
+        cachedResult);
 }
 
 bool CachingSolver::computeValidity(const Query& query,
@@ -147,15 +235,15 @@ bool CachingSolver::computeValidity(const Query& query,
     switch(cachedResult) {
     case IncompleteSolver::MustBeTrue:   
       result = Solver::True;
-      ++stats::queryCacheHits;
+      countHit();
       return true;
     case IncompleteSolver::MustBeFalse:  
       result = Solver::False;
-      ++stats::queryCacheHits;
+      countHit();
       return true;
     case IncompleteSolver::TrueOrFalse:  
       result = Solver::Unknown;
-      ++stats::queryCacheHits;
+      countHit();
       return true;
     case IncompleteSolver::MayBeTrue: {
       ++stats::queryCacheMisses;
@@ -215,7 +303,7 @@ bool CachingSolver::computeTruth(const Query& query,
   // a cached result of MayBeTrue forces us to check whether
   // a False assignment exists.
   if (cacheHit && cachedResult != IncompleteSolver::MayBeTrue) {
-    ++stats::queryCacheHits;
+    countHit();
     isValid = (cachedResult == IncompleteSolver::MustBeTrue);
     return true;
   }
@@ -11,6 +11,7 @@
 
 #include "klee/ADT/MapOfSets.h"
 #include "klee/Expr/Assignment.h"
+#include "klee/Expr/CompiledExpr.h"
 #include "klee/Expr/Constraints.h"
 #include "klee/Expr/Expr.h"
 #include "klee/Expr/ExprUtil.h"
@@ -50,6 +51,20 @@ cl::opt<bool> CexCacheExperimental(
     cl::desc("Optimization for validity queries (default=false)"),
     cl::cat(SolvingCat));
 
+cl::opt<bool> CexCacheCompileExprs(
+    "cex-cache-compile-exprs", cl::init(true),
+    cl::desc("Compile the constraints of a lookup in the counterexample "
+             "cache before checking cached assignments against them "
+             "(default=true)"),
+    cl::cat(SolvingCat));
+
+cl::opt<unsigned> CexCacheCompileThreshold(
+    "cex-cache-compile-threshold", cl::init(16),
+    cl::desc("Number of cached assignments a lookup checks by evaluating "
+             "its constraints before compiling them, see "
+             "-cex-cache-compile-exprs (default=16)"),
+    cl::cat(SolvingCat));
+
 } // namespace
 
 ///
@@ -110,13 +125,55 @@ struct NonNullAssignment {
   bool operator()(Assignment *a) const { return a!=0; }
 };
 
-struct NullOrSatisfyingAssignment {
+/// Checks assignments against a key. Most lookups only check a few
+/// assignments, so the key is compiled only once enough of them have been
+/// checked for the compilation to pay off.
+class KeyChecker {
   KeyType &key;
+  std::unique_ptr<CompiledExpr> compiled;
+  bool compileTried;
+  unsigned numChecked;
+
+  const CompiledExpr *getCompiled() {
+    if (!compileTried && CexCacheCompileExprs &&
+        numChecked >= CexCacheCompileThreshold) {
+      compileTried = true;
+      compiled = CompiledExpr::compile(
+          std::vector<ref<Expr> >(key.begin(), key.end()));
+    }
+    return compiled.get();
+  }
+
+public:
+  explicit KeyChecker(KeyType &_key)
+      : key(_key), compileTried(false), numChecked(0) {}
+
+  bool satisfiedBy(Assignment *a) {
+    if (const CompiledExpr *ce = getCompiled())
+      return ce->satisfiedBy(*a);
+    ++numChecked;
+    return a->satisfies(key.begin(), key.end());
+  }
+
+  void satisfiedBy(const std::vector<const Assignment *> &assignments,
+                   std::vector<bool> &result) {
+    if (const CompiledExpr *ce = getCompiled())
+      return ce->satisfiedBy(assignments, result);
+    numChecked += assignments.size();
+    result.clear();
+    for (const Assignment *a : assignments)
+      result.push_back(const_cast<Assignment *>(a)->satisfies(key.begin(),
+                                                               key.end()));
+  }
+};
+
+struct NullOrSatisfyingAssignment {
+  KeyChecker &checker;
   
-  NullOrSatisfyingAssignment(KeyType &_key) : key(_key) {}
+  NullOrSatisfyingAssignment(KeyChecker &_checker) : checker(_checker) {}
 
   bool operator()(Assignment *a) const { 
-    return !a || a->satisfies(key.begin(), key.end()); 
+    return !a || checker.satisfiedBy(a);
   }
 };
 
@@ -152,13 +209,22 @@ bool CexCachingSolver::searchForAssignment(KeyType &key, Assignment *&result) {
     }
 
     // Otherwise, iterate through the set of current assignments to see if one
-    // of them satisfies the query.
-    for (assignmentsTable_ty::iterator it = assignmentsTable.begin(), 
-           ie = assignmentsTable.end(); it != ie; ++it) {
-      Assignment *a = *it;
-      if (a->satisfies(key.begin(), key.end())) {
-        result = a;
-        return true;
+    // of them satisfies the query. They are checked in batches, which the
+    // compiled key evaluates in lockstep.
+    KeyChecker checker(key);
+    std::vector<const Assignment *> batch;
+    std::vector<bool> satisfied;
+    for (assignmentsTable_ty::iterator it = assignmentsTable.begin(),
+           ie = assignmentsTable.end(); it != ie;) {
+      batch.clear();
+      for (; it != ie && batch.size() != CompiledExpr::BatchSize; ++it)
+        batch.push_back(*it);
+      checker.satisfiedBy(batch, satisfied);
+      for (unsigned i = 0; i != batch.size(); ++i) {
+        if (satisfied[i]) {
+          result = const_cast<Assignment *>(batch[i]);
+          return true;
+        }
       }
     }
   } else {
@@ -175,8 +241,9 @@ bool CexCachingSolver::searchForAssignment(KeyType &key, Assignment *&result) {
     // assignment. While searching subsets, we also explicitly the solutions for
     // satisfiable subsets to see if they solve the current query and return
     // them if so. This is cheap and frequently succeeds.
+    KeyChecker checker(key);
     if (!lookup) 
-      lookup = cache.findSubset(key, NullOrSatisfyingAssignment(key));
+      lookup = cache.findSubset(key, NullOrSatisfyingAssignment(checker));
 
     // If either lookup succeeded, then we have a cached solution.
     if (lookup) {
@@ -40,6 +40,9 @@ Solver *constructSolverChain(Solver *coreSolver,
                  baseSolverQuerySMT2LogPath.c_str());
   }
 
+  if (!QueryCacheDir.empty())
+    solver = createPersistentCachingSolver(solver, QueryCacheDir);
+
   if (UseAssignmentValidatingSolver)
     solver = createAssignmentValidatingSolver(solver);
 
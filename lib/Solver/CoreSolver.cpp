@@ -10,8 +10,10 @@
 #include "STPSolver.h"
 #include "Z3Solver.h"
 #include "MetaSMTSolver.h"
+#include "PortfolioSolver.h"
 
 #include "klee/Solver/SolverCmdLine.h"
+#include "klee/Solver/SolverStats.h"
 #include "klee/Support/ErrorHandling.h"
 #include "klee/Solver/Solver.h"
 
@@ -22,6 +24,64 @@
 
 namespace klee {
 
+/// Create a member of the portfolio solver. Members are run in a process
+/// forked by the portfolio, so they must not fork themselves.
+static bool addPortfolioMember(CoreSolverType cst,
+                               std::vector<PortfolioSolver::Member> &members) {
+  switch (cst) {
+  case STP_SOLVER:
+#ifdef ENABLE_STP
+    members.push_back({"STP", new STPSolver(/*useForkedSTP=*/false,
+                                            CoreSolverOptimizeDivides),
+                       &stats::portfolioWinsSTP});
+    return true;
+#else
+    return false;
+#endif
+  case METASMT_SOLVER:
+#ifdef ENABLE_METASMT
+    members.push_back({"metaSMT", createMetaSMTSolver(/*useForked=*/false),
+                       &stats::portfolioWinsMetaSMT});
+    return true;
+#else
+    return false;
+#endif
+  case Z3_SOLVER:
+#ifdef ENABLE_Z3
+    members.push_back({"Z3", new Z3Solver(), &stats::portfolioWinsZ3});
+    return true;
+#else
+    return false;
+#endif
+  default:
+    llvm_unreachable("Unsupported portfolio member");
+  }
+}
+
+static Solver *createPortfolioSolver() {
+  std::vector<CoreSolverType> requested(PortfolioSolvers.begin(),
+                                        PortfolioSolvers.end());
+  if (requested.empty())
+    requested = {STP_SOLVER, METASMT_SOLVER, Z3_SOLVER};
+
+  std::vector<PortfolioSolver::Member> members;
+  for (CoreSolverType cst : requested) {
+    if (!addPortfolioMember(cst, members) && !PortfolioSolvers.empty())
+      klee_warning("Portfolio member not compiled in, ignoring it");
+  }
+
+  if (members.empty()) {
+    klee_message("No solvers available for the portfolio");
+    return NULL;
+  }
+
+  std::string names;
+  for (const auto &member : members)
+    names += (names.empty() ? "" : ", ") + member.name;
+  klee_message("Using portfolio solver backend (%s)", names.c_str());
+  return new PortfolioSolver(members);
+}
+
 Solver *createCoreSolver(CoreSolverType cst) {
   switch (cst) {
   case STP_SOLVER:
@@ -50,6 +110,8 @@ Solver *createCoreSolver(CoreSolverType cst) {
     klee_message("Not compiled with Z3 support");
     return NULL;
 #endif
+  case PORTFOLIO_SOLVER:
+    return createPortfolioSolver();
   case NO_SOLVER:
     klee_message("Invalid solver");
     return NULL;
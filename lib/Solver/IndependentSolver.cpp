@@ -15,8 +15,11 @@
 #include "klee/Expr/Expr.h"
 #include "klee/Expr/ExprUtil.h"
 #include "klee/Support/Debug.h"
+#include "klee/Support/ErrorHandling.h"
+#include "klee/Solver/SolverCmdLine.h"
 #include "klee/Solver/SolverImpl.h"
 
+#include "llvm/Support/Errno.h"
 #include "llvm/Support/raw_ostream.h"
 
 #include <list>
@@ -24,6 +27,10 @@
 #include <ostream>
 #include <vector>
 
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
 using namespace klee;
 using namespace llvm;
 
@@ -390,6 +397,20 @@ class IndependentSolver : public SolverImpl {
 private:
   Solver *solver;
 
+  /// A factor of a query together with the arrays it constrains and, once
+  /// solved, the computed assignment for them.
+  struct Factor {
+    IndependentElementSet *elements;
+    std::vector<const Array *> arrays;
+    std::vector<std::vector<unsigned char> > values;
+    bool success;
+    bool hasSolution;
+    bool solved;
+  };
+
+  void solveFactor(Factor &factor);
+  void solveFactorsInParallel(const std::vector<Factor *> &factors);
+
 public:
   IndependentSolver(Solver *_solver) 
     : solver(_solver) {}
@@ -470,6 +491,101 @@ bool assertCreatedPointEvaluatesToTrue(
   return cast<ConstantExpr>(q)->isTrue();
 }
 
+void IndependentSolver::solveFactor(Factor &factor) {
+  ConstraintSet tmp(factor.elements->exprs);
+  factor.success = solver->impl->computeInitialValues(
+      Query(tmp, ConstantExpr::alloc(0, Expr::Bool)), factor.arrays,
+      factor.values, factor.hasSolution);
+  factor.solved = true;
+}
+
+/// Solve all factors, distributing them over IndependentSolverJobs forked
+/// processes. The underlying solver chain is not thread-safe, so we rely on
+/// fork() to give every worker its own copy of it; results are passed back
+/// through an anonymous shared mapping with one record per factor:
+/// [status byte][values of all arrays in the factor]. Whatever else the
+/// workers learn, such as cache entries and statistics, is lost.
+void IndependentSolver::solveFactorsInParallel(
+    const std::vector<Factor *> &factors) {
+  enum : unsigned char { Unsolved = 0, Failed, Unsolvable, Solvable };
+
+  std::vector<size_t> offsets;
+  size_t size = 0;
+  for (const Factor *factor : factors) {
+    offsets.push_back(size);
+    size += 1;
+    for (const Array *array : factor->arrays)
+      size += array->size;
+  }
+
+  void *mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (mapping == MAP_FAILED) {
+    klee_warning("unable to allocate shared memory for parallel factors");
+    return;
+  }
+  unsigned char *shared = static_cast<unsigned char *>(mapping);
+
+  fflush(stdout);
+  fflush(stderr);
+
+  const unsigned jobs =
+      std::min<unsigned>(IndependentSolverJobs, factors.size());
+  std::vector<pid_t> pids;
+  for (unsigned job = 0; job < jobs; ++job) {
+    pid_t pid = fork();
+    if (pid == -1) {
+      klee_warning("fork failed (for independent solver) - %s",
+                   llvm::sys::StrError(errno).c_str());
+      continue;
+    }
+    if (pid == 0) {
+      for (unsigned i = job; i < factors.size(); i += jobs) {
+        Factor &factor = *factors[i];
+        solveFactor(factor);
+        unsigned char *record = shared + offsets[i];
+        if (!factor.success || !factor.hasSolution) {
+          *record = factor.success ? Unsolvable : Failed;
+          break; // the whole query is decided, no need to go on
+        }
+        unsigned char *pos = record + 1;
+        for (const auto &value : factor.values)
+          pos = std::copy(value.begin(), value.end(), pos);
+        *record = Solvable;
+      }
+      _exit(0);
+    }
+    pids.push_back(pid);
+  }
+
+  for (pid_t pid : pids) {
+    int status;
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR)
+      ;
+  }
+
+  // Factors no worker got to, as it could not be started or had already
+  // decided the query, are left to be solved here.
+  for (unsigned i = 0; i < factors.size(); ++i) {
+    Factor &factor = *factors[i];
+    const unsigned char *pos = shared + offsets[i];
+    if (*pos == Unsolved)
+      continue;
+    factor.success = *pos != Failed;
+    factor.hasSolution = *pos == Solvable;
+    factor.solved = true;
+    ++pos;
+    if (factor.hasSolution) {
+      for (const Array *array : factor.arrays) {
+        factor.values.emplace_back(pos, pos + array->size);
+        pos += array->size;
+      }
+    }
+  }
+
+  munmap(mapping, size);
+}
+
 bool IndependentSolver::computeInitialValues(const Query& query,
                                              const std::vector<const Array*> &objects,
                                              std::vector< std::vector<unsigned char> > &values,
@@ -482,21 +598,40 @@ bool IndependentSolver::computeInitialValues(const Query& query,
   // to remember to manually call delete
   std::list<IndependentElementSet> *factors = getAllIndependentConstraintsSets(query);
 
-  //Used to rearrange all of the answers into the correct order
-  std::map<const Array*, std::vector<unsigned char> > retMap;
+  std::vector<Factor> work;
   for (std::list<IndependentElementSet>::iterator it = factors->begin();
        it != factors->end(); ++it) {
-    std::vector<const Array*> arraysInFactor;
-    calculateArrayReferences(*it, arraysInFactor);
     // Going to use this as the "fresh" expression for the Query() invocation below
     assert(it->exprs.size() >= 1 && "No null/empty factors");
-    if (arraysInFactor.size() == 0){
+    Factor factor;
+    factor.elements = &*it;
+    factor.solved = false;
+    calculateArrayReferences(*it, factor.arrays);
+    if (factor.arrays.size() == 0){
       continue;
     }
-    ConstraintSet tmp(it->exprs);
-    std::vector<std::vector<unsigned char> > tempValues;
-    if (!solver->impl->computeInitialValues(Query(tmp, ConstantExpr::alloc(0, Expr::Bool)),
-                                            arraysInFactor, tempValues, hasSolution)){
+    work.push_back(std::move(factor));
+  }
+
+  // Forking only pays off for large factors, and whatever the other
+  // processes learn is lost to the solvers below
+  if (IndependentSolverJobs > 1) {
+    std::vector<Factor *> large;
+    for (Factor &factor : work)
+      if (factor.elements->exprs.size() >=
+          IndependentSolverParallelMinConstraints)
+        large.push_back(&factor);
+    if (large.size() > 1)
+      solveFactorsInParallel(large);
+  }
+
+  //Used to rearrange all of the answers into the correct order
+  std::map<const Array*, std::vector<unsigned char> > retMap;
+  for (Factor &factor : work) {
+    if (!factor.solved)
+      solveFactor(factor);
+    hasSolution = factor.hasSolution;
+    if (!factor.success){
       values.clear();
       delete factors;
       return false;
@@ -505,6 +640,8 @@ bool IndependentSolver::computeInitialValues(const Query& query,
       delete factors;
       return true;
     } else {
+      std::vector<std::vector<unsigned char> > &tempValues = factor.values;
+      std::vector<const Array *> &arraysInFactor = factor.arrays;
       assert(tempValues.size() == arraysInFactor.size() &&
              "Should be equal number arrays and answers");
       for (unsigned i = 0; i < tempValues.size(); i++){
@@ -515,7 +652,7 @@ bool IndependentSolver::computeInitialValues(const Query& query,
           std::vector<unsigned char> * tempPtr = &retMap[arraysInFactor[i]];
           assert(tempPtr->size() == tempValues[i].size() &&
                  "we're talking about the same array here");
-          ::DenseSet<unsigned> * ds = &(it->elements[arraysInFactor[i]]);
+          ::DenseSet<unsigned> * ds = &(factor.elements->elements[arraysInFactor[i]]);
           for (std::set<unsigned>::iterator it2 = ds->begin(); it2 != ds->end(); it2++){
             unsigned index = * it2;
             (* tempPtr)[index] = tempValues[i][index];
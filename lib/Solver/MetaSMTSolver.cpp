@@ -58,8 +58,6 @@
 #include <sys/wait.h>
 #include <unistd.h>
 
-static unsigned char *shared_memory_ptr;
-static int shared_memory_id = 0;
 // Darwin by default has a very small limit on the maximum amount of shared
 // memory, which will quickly be exhausted by KLEE running its tests in
 // parallel. For now, we work around this by just requesting a smaller size --
@@ -71,6 +69,17 @@ static const unsigned shared_memory_size = 1 << 16;
 static const unsigned shared_memory_size = 1 << 20;
 #endif
 
+static unsigned char *attachSharedMemory() {
+  int shared_memory_id =
+      shmget(IPC_PRIVATE, shared_memory_size, IPC_CREAT | 0700);
+  assert(shared_memory_id >= 0 && "shmget failed");
+  unsigned char *shared_memory_ptr =
+      (unsigned char *)shmat(shared_memory_id, NULL, 0);
+  assert(shared_memory_ptr != (void *)-1 && "shmat failed");
+  shmctl(shared_memory_id, IPC_RMID, NULL);
+  return shared_memory_ptr;
+}
+
 namespace klee {
 
 template <typename SolverContext> class MetaSMTSolverImpl : public SolverImpl {
@@ -81,6 +90,11 @@ private:
   time::Span _timeout;
   bool _useForked;
   SolverRunStatus _runStatusCode;
+  // The region for the counterexamples of the forked solver, one per solver
+  // so that several can be used at once. See STPSolver.cpp: forked copies
+  // of KLEE attach their own region.
+  unsigned char *_shared_memory_ptr = nullptr;
+  pid_t _shared_memory_owner = 0;
 
 public:
   MetaSMTSolverImpl(MetaSMTSolver<SolverContext> *solver, bool useForked,
@@ -124,17 +138,16 @@ MetaSMTSolverImpl<SolverContext>::MetaSMTSolverImpl(
   assert(_builder && "unable to create MetaSMTBuilder");
 
   if (_useForked) {
-    shared_memory_id =
-        shmget(IPC_PRIVATE, shared_memory_size, IPC_CREAT | 0700);
-    assert(shared_memory_id >= 0 && "shmget failed");
-    shared_memory_ptr = (unsigned char *)shmat(shared_memory_id, NULL, 0);
-    assert(shared_memory_ptr != (void *)-1 && "shmat failed");
-    shmctl(shared_memory_id, IPC_RMID, NULL);
+    _shared_memory_ptr = attachSharedMemory();
+    _shared_memory_owner = getpid();
   }
 }
 
 template <typename SolverContext>
-MetaSMTSolverImpl<SolverContext>::~MetaSMTSolverImpl() {}
+MetaSMTSolverImpl<SolverContext>::~MetaSMTSolverImpl() {
+  if (_shared_memory_ptr)
+    shmdt(_shared_memory_ptr);
+}
 
 template <typename SolverContext>
 char *MetaSMTSolverImpl<SolverContext>::getConstraintLog(const Query &) {
@@ -273,7 +286,13 @@ MetaSMTSolverImpl<SolverContext>::runAndGetCexForked(
     const Query &query, const std::vector<const Array *> &objects,
     std::vector<std::vector<unsigned char> > &values, bool &hasSolution,
     time::Span timeout) {
-  unsigned char *pos = shared_memory_ptr;
+  if (_shared_memory_owner != getpid()) {
+    shmdt(_shared_memory_ptr);
+    _shared_memory_ptr = attachSharedMemory();
+    _shared_memory_owner = getpid();
+  }
+
+  unsigned char *pos = _shared_memory_ptr;
   unsigned sum = 0;
   for (std::vector<const Array *>::const_iterator it = objects.begin(),
                                                   ie = objects.end();
@@ -421,6 +440,10 @@ void MetaSMTSolver<SolverContext>::setCoreSolverTimeout(time::Span timeout) {
 }
 
 Solver *createMetaSMTSolver() {
+  return createMetaSMTSolver(UseForkedCoreSolver);
+}
+
+Solver *createMetaSMTSolver(bool useForked) {
   using namespace metaSMT;
 
   Solver *coreSolver = NULL;
@@ -430,35 +453,35 @@ Solver *createMetaSMTSolver() {
   case METASMT_BACKEND_STP:
     backend = "STP";
     coreSolver = new MetaSMTSolver<DirectSolver_Context<solver::STP_Backend> >(
-        UseForkedCoreSolver, CoreSolverOptimizeDivides);
+        useForked, CoreSolverOptimizeDivides);
     break;
 #endif
 #ifdef METASMT_HAVE_Z3
   case METASMT_BACKEND_Z3:
     backend = "Z3";
     coreSolver = new MetaSMTSolver<DirectSolver_Context<solver::Z3_Backend> >(
-        UseForkedCoreSolver, CoreSolverOptimizeDivides);
+        useForked, CoreSolverOptimizeDivides);
     break;
 #endif
 #ifdef METASMT_HAVE_BTOR
   case METASMT_BACKEND_BOOLECTOR:
     backend = "Boolector";
     coreSolver = new MetaSMTSolver<DirectSolver_Context<solver::Boolector> >(
-        UseForkedCoreSolver, CoreSolverOptimizeDivides);
+        useForked, CoreSolverOptimizeDivides);
     break;
 #endif
 #ifdef METASMT_HAVE_CVC4
   case METASMT_BACKEND_CVC4:
     backend = "CVC4";
     coreSolver = new MetaSMTSolver<DirectSolver_Context<solver::CVC4> >(
-        UseForkedCoreSolver, CoreSolverOptimizeDivides);
+        useForked, CoreSolverOptimizeDivides);
     break;
 #endif
 #ifdef METASMT_HAVE_YICES2
   case METASMT_BACKEND_YICES2:
     backend = "Yices2";
     coreSolver = new MetaSMTSolver<DirectSolver_Context<solver::Yices2> >(
-        UseForkedCoreSolver, CoreSolverOptimizeDivides);
+        useForked, CoreSolverOptimizeDivides);
     break;
 #endif
   default:
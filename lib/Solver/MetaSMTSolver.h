@@ -27,6 +27,10 @@ public:
 /// createMetaSMTSolver - Create a solver using the metaSMT backend set by
 /// the option MetaSMTBackend.
 Solver *createMetaSMTSolver();
+
+/// createMetaSMTSolver - Same as above, but \a useForked overrides
+/// UseForkedCoreSolver.
+Solver *createMetaSMTSolver(bool useForked);
 }
 
 #endif /* KLEE_METASMTSOLVER_H */
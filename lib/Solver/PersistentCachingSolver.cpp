@@ -0,0 +1,318 @@
+//===-- PersistentCachingSolver.cpp - On-disk query cache -----------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// A validity cache that lives in a memory-mapped file and therefore survives
+// the KLEE process. Several KLEE processes on the same machine may share one
+// cache directory: lookups take a shared and insertions an exclusive flock(2)
+// on the cache file.
+//
+// Entries are keyed by a 128-bit structural hash of the constraint set and
+// the (canonicalized) query expression. The hash only depends on the shape of
+// the expressions, array names, sizes and constant values, never on pointer
+// values, so identical queries issued by different runs map to the same key.
+//
+//===----------------------------------------------------------------------===//
+
+#include "QueryHash.h"
+
+#include "klee/Solver/Solver.h"
+
+#include "klee/Expr/Constraints.h"
+#include "klee/Expr/Expr.h"
+#include "klee/Solver/IncompleteSolver.h"
+#include "klee/Solver/SolverImpl.h"
+#include "klee/Solver/SolverStats.h"
+#include "klee/Support/ErrorHandling.h"
+
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace klee;
+
+namespace {
+
+const char CacheMagic[8] = {'K', 'L', 'E', 'E', 'Q', 'C', '\0', '\0'};
+
+/// A fixed-size open addressing hash table stored in a shared file mapping.
+class PersistentQueryCache {
+  struct Header {
+    char magic[8];
+    uint64_t version;
+    uint64_t capacity;
+  };
+
+  struct Slot {
+    QueryKey key;
+    /// PartialValidity + ValueBias, so that zero marks an empty slot.
+    int64_t value;
+  };
+
+  static constexpr uint64_t Version = 1;
+  static constexpr uint64_t Capacity = 1 << 20;
+  static constexpr unsigned MaxProbes = 16;
+  static constexpr int64_t ValueBias = 4;
+
+  int fd;
+  size_t mappedSize;
+  Header *header;
+  Slot *slots;
+
+  /// RAII wrapper around flock(2).
+  class FileLock {
+    int fd;
+
+  public:
+    FileLock(int fd, int op) : fd(fd) {
+      while (flock(fd, op) == -1 && errno == EINTR)
+        ;
+    }
+    ~FileLock() { flock(fd, LOCK_UN); }
+  };
+
+public:
+  explicit PersistentQueryCache(const std::string &directory)
+      : fd(-1), mappedSize(sizeof(Header) + Capacity * sizeof(Slot)),
+        header(nullptr), slots(nullptr) {
+    if (mkdir(directory.c_str(), 0775) == -1 && errno != EEXIST)
+      klee_error("Unable to create query cache directory \"%s\": %s",
+                 directory.c_str(), strerror(errno));
+
+    std::string path = directory + "/query-cache.bin";
+    fd = open(path.c_str(), O_RDWR | O_CREAT, 0664);
+    if (fd == -1)
+      klee_error("Unable to open query cache \"%s\": %s", path.c_str(),
+                 strerror(errno));
+
+    {
+      // Initialize the file exactly once, even if several processes start
+      // up concurrently.
+      FileLock lock(fd, LOCK_EX);
+      struct stat st;
+      if (fstat(fd, &st) == -1)
+        klee_error("Unable to stat query cache \"%s\": %s", path.c_str(),
+                   strerror(errno));
+      if (st.st_size == 0) {
+        Header h;
+        memcpy(h.magic, CacheMagic, sizeof(h.magic));
+        h.version = Version;
+        h.capacity = Capacity;
+        if (ftruncate(fd, mappedSize) == -1 ||
+            pwrite(fd, &h, sizeof(h), 0) != sizeof(h))
+          klee_error("Unable to initialize query cache \"%s\": %s",
+                     path.c_str(), strerror(errno));
+      } else if (static_cast<size_t>(st.st_size) != mappedSize) {
+        klee_error("Query cache \"%s\" has an unexpected size", path.c_str());
+      }
+    }
+
+    void *mapping =
+        mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED)
+      klee_error("Unable to map query cache \"%s\": %s", path.c_str(),
+                 strerror(errno));
+    header = static_cast<Header *>(mapping);
+    slots = reinterpret_cast<Slot *>(header + 1);
+
+    if (memcmp(header->magic, CacheMagic, sizeof(header->magic)) != 0 ||
+        header->version != Version || header->capacity != Capacity)
+      klee_error("Query cache \"%s\" has an incompatible format",
+                 path.c_str());
+
+    klee_message("Using persistent query cache %s", path.c_str());
+  }
+
+  ~PersistentQueryCache() {
+    if (header)
+      munmap(header, mappedSize);
+    if (fd != -1)
+      close(fd);
+  }
+
+  bool lookup(const QueryKey &key, IncompleteSolver::PartialValidity &result) {
+    FileLock lock(fd, LOCK_SH);
+    for (unsigned i = 0; i != MaxProbes; ++i) {
+      const Slot &slot = slots[(key.lo + i) & (Capacity - 1)];
+      if (slot.value == 0)
+        return false;
+      if (slot.key == key) {
+        result = static_cast<IncompleteSolver::PartialValidity>(slot.value -
+                                                                ValueBias);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void insert(const QueryKey &key, IncompleteSolver::PartialValidity result) {
+    FileLock lock(fd, LOCK_EX);
+    Slot *target = &slots[key.lo & (Capacity - 1)];
+    for (unsigned i = 0; i != MaxProbes; ++i) {
+      Slot &slot = slots[(key.lo + i) & (Capacity - 1)];
+      if (slot.value == 0 || slot.key == key) {
+        target = &slot;
+        break;
+      }
+    }
+    // If the probe sequence is full the home slot is evicted.
+    target->key = key;
+    target->value = result + ValueBias;
+  }
+};
+
+class PersistentCachingSolver : public SolverImpl {
+private:
+  Solver *solver;
+  PersistentQueryCache cache;
+
+  void cacheInsert(const Query &query,
+                   IncompleteSolver::PartialValidity result);
+
+  bool cacheLookup(const Query &query,
+                   IncompleteSolver::PartialValidity &result);
+
+public:
+  PersistentCachingSolver(Solver *s, const std::string &directory)
+      : solver(s), cache(directory) {}
+  ~PersistentCachingSolver() { delete solver; }
+
+  bool computeValidity(const Query &, Solver::Validity &result);
+  bool computeTruth(const Query &, bool &isValid);
+  bool computeValue(const Query &query, ref<Expr> &result) {
+    return solver->impl->computeValue(query, result);
+  }
+  bool computeInitialValues(const Query &query,
+                            const std::vector<const Array *> &objects,
+                            std::vector<std::vector<unsigned char> > &values,
+                            bool &hasSolution) {
+    return solver->impl->computeInitialValues(query, objects, values,
+                                              hasSolution);
+  }
+  SolverRunStatus getOperationStatusCode();
+  char *getConstraintLog(const Query &);
+  void setCoreSolverTimeout(time::Span timeout);
+};
+
+bool PersistentCachingSolver::cacheLookup(
+    const Query &query, IncompleteSolver::PartialValidity &result) {
+  bool negationUsed;
+  QueryKey key = computeQueryKey(query, negationUsed);
+  if (!cache.lookup(key, result))
+    return false;
+  if (negationUsed)
+    result = IncompleteSolver::negatePartialValidity(result);
+  return true;
+}
+
+void PersistentCachingSolver::cacheInsert(
+    const Query &query, IncompleteSolver::PartialValidity result) {
+  bool negationUsed;
+  QueryKey key = computeQueryKey(query, negationUsed);
+  cache.insert(key, negationUsed
+                        ? IncompleteSolver::negatePartialValidity(result)
+                        : result);
+}
+
+bool PersistentCachingSolver::computeValidity(const Query &query,
+                                              Solver::Validity &result) {
+  IncompleteSolver::PartialValidity cachedResult;
+  if (cacheLookup(query, cachedResult)) {
+    switch (cachedResult) {
+    case IncompleteSolver::MustBeTrue:
+      result = Solver::True;
+      ++stats::queryPersistentCacheHits;
+      return true;
+    case IncompleteSolver::MustBeFalse:
+      result = Solver::False;
+      ++stats::queryPersistentCacheHits;
+      return true;
+    case IncompleteSolver::TrueOrFalse:
+      result = Solver::Unknown;
+      ++stats::queryPersistentCacheHits;
+      return true;
+    default:
+      // Only partial information is cached, ask the solver.
+      break;
+    }
+  }
+
+  ++stats::queryPersistentCacheMisses;
+
+  if (!solver->impl->computeValidity(query, result))
+    return false;
+
+  switch (result) {
+  case Solver::True:
+    cachedResult = IncompleteSolver::MustBeTrue;
+    break;
+  case Solver::False:
+    cachedResult = IncompleteSolver::MustBeFalse;
+    break;
+  default:
+    cachedResult = IncompleteSolver::TrueOrFalse;
+    break;
+  }
+
+  cacheInsert(query, cachedResult);
+  return true;
+}
+
+bool PersistentCachingSolver::computeTruth(const Query &query, bool &isValid) {
+  IncompleteSolver::PartialValidity cachedResult;
+  bool cacheHit = cacheLookup(query, cachedResult);
+
+  // a cached result of MayBeTrue forces us to check whether
+  // a False assignment exists.
+  if (cacheHit && cachedResult != IncompleteSolver::MayBeTrue) {
+    ++stats::queryPersistentCacheHits;
+    isValid = (cachedResult == IncompleteSolver::MustBeTrue);
+    return true;
+  }
+
+  ++stats::queryPersistentCacheMisses;
+
+  if (!solver->impl->computeTruth(query, isValid))
+    return false;
+
+  if (isValid) {
+    cachedResult = IncompleteSolver::MustBeTrue;
+  } else if (cacheHit) {
+    assert(cachedResult == IncompleteSolver::MayBeTrue);
+    cachedResult = IncompleteSolver::TrueOrFalse;
+  } else {
+    cachedResult = IncompleteSolver::MayBeFalse;
+  }
+
+  cacheInsert(query, cachedResult);
+  return true;
+}
+
+SolverImpl::SolverRunStatus PersistentCachingSolver::getOperationStatusCode() {
+  return solver->impl->getOperationStatusCode();
+}
+
+char *PersistentCachingSolver::getConstraintLog(const Query &query) {
+  return solver->impl->getConstraintLog(query);
+}
+
+void PersistentCachingSolver::setCoreSolverTimeout(time::Span timeout) {
+  solver->impl->setCoreSolverTimeout(timeout);
+}
+
+} // namespace
+
+Solver *klee::createPersistentCachingSolver(Solver *s,
+                                            const std::string &directory) {
+  return new Solver(new PersistentCachingSolver(s, directory));
+}
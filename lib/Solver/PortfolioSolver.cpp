@@ -0,0 +1,330 @@
+//===-- PortfolioSolver.cpp -----------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "PortfolioSolver.h"
+
+#include "klee/Expr/Assignment.h"
+#include "klee/Expr/Constraints.h"
+#include "klee/Expr/ExprUtil.h"
+#include "klee/Solver/SolverImpl.h"
+#include "klee/Solver/SolverStats.h"
+#include "klee/Statistics/TimerStatIncrementer.h"
+#include "klee/Support/ErrorHandling.h"
+#include "klee/System/Time.h"
+
+#include "llvm/Support/Errno.h"
+#include "llvm/Support/ErrorHandling.h"
+
+#include <csignal>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Per member shared memory for transferring results back from the solver
+// processes. See the comment in STPSolver.cpp about the Darwin limits.
+#ifdef __APPLE__
+static const unsigned shared_memory_size = 1 << 16;
+#else
+static const unsigned shared_memory_size = 1 << 20;
+#endif
+
+namespace klee {
+
+class PortfolioSolverImpl : public SolverImpl {
+private:
+  /// Layout of the start of each member's shared memory slot. The
+  /// counterexample bytes follow directly.
+  struct SlotHeader {
+    SolverRunStatus status;
+    bool hasSolution;
+    uint64_t queryConstructs;
+  };
+
+  std::vector<PortfolioSolver::Member> members;
+  time::Span timeout;
+  SolverRunStatus runStatusCode;
+  unsigned char *sharedMemory;
+
+  SlotHeader *getSlot(unsigned index) {
+    return reinterpret_cast<SlotHeader *>(sharedMemory +
+                                          index * shared_memory_size);
+  }
+
+  void runMember(unsigned index, const Query &query,
+                 const std::vector<const Array *> &objects);
+
+  SolverRunStatus runPortfolio(const Query &query,
+                               const std::vector<const Array *> &objects,
+                               std::vector<std::vector<unsigned char>> &values,
+                               bool &hasSolution);
+
+public:
+  explicit PortfolioSolverImpl(
+      const std::vector<PortfolioSolver::Member> &members);
+  ~PortfolioSolverImpl() override;
+
+  char *getConstraintLog(const Query &) override;
+  void setCoreSolverTimeout(time::Span timeout) override;
+
+  bool computeTruth(const Query &, bool &isValid) override;
+  bool computeValue(const Query &, ref<Expr> &result) override;
+  bool computeInitialValues(const Query &,
+                            const std::vector<const Array *> &objects,
+                            std::vector<std::vector<unsigned char>> &values,
+                            bool &hasSolution) override;
+  SolverRunStatus getOperationStatusCode() override;
+};
+
+PortfolioSolverImpl::PortfolioSolverImpl(
+    const std::vector<PortfolioSolver::Member> &members)
+    : members(members), runStatusCode(SOLVER_RUN_STATUS_FAILURE) {
+  assert(!members.empty() && "portfolio without members");
+  void *mapping = mmap(nullptr, members.size() * shared_memory_size,
+                       PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS,
+                       -1, 0);
+  if (mapping == MAP_FAILED)
+    llvm::report_fatal_error("unable to allocate shared memory region");
+  sharedMemory = static_cast<unsigned char *>(mapping);
+}
+
+PortfolioSolverImpl::~PortfolioSolverImpl() {
+  munmap(sharedMemory, members.size() * shared_memory_size);
+  for (auto &member : members)
+    delete member.solver;
+}
+
+char *PortfolioSolverImpl::getConstraintLog(const Query &query) {
+  return members.front().solver->impl->getConstraintLog(query);
+}
+
+void PortfolioSolverImpl::setCoreSolverTimeout(time::Span timeout) {
+  this->timeout = timeout;
+  // Members that support timeouts natively stop on their own, the others are
+  // killed once the deadline has passed.
+  for (auto &member : members)
+    member.solver->impl->setCoreSolverTimeout(timeout);
+}
+
+bool PortfolioSolverImpl::computeTruth(const Query &query, bool &isValid) {
+  std::vector<const Array *> objects;
+  std::vector<std::vector<unsigned char>> values;
+  bool hasSolution;
+
+  if (!computeInitialValues(query, objects, values, hasSolution))
+    return false;
+
+  isValid = !hasSolution;
+  return true;
+}
+
+bool PortfolioSolverImpl::computeValue(const Query &query, ref<Expr> &result) {
+  std::vector<const Array *> objects;
+  std::vector<std::vector<unsigned char>> values;
+  bool hasSolution;
+
+  // Find the object used in the expression, and compute an assignment
+  // for them.
+  findSymbolicObjects(query.expr, objects);
+  if (!computeInitialValues(query.withFalse(), objects, values, hasSolution))
+    return false;
+  assert(hasSolution && "state has invalid constraint set");
+
+  // Evaluate the expression with the computed assignment.
+  Assignment a(objects, values);
+  result = a.evaluate(query.expr);
+
+  return true;
+}
+
+bool PortfolioSolverImpl::computeInitialValues(
+    const Query &query, const std::vector<const Array *> &objects,
+    std::vector<std::vector<unsigned char>> &values, bool &hasSolution) {
+  TimerStatIncrementer t(stats::queryTime);
+  ++stats::queries;
+  if (!objects.empty())
+    ++stats::queryCounterexamples;
+
+  runStatusCode = runPortfolio(query, objects, values, hasSolution);
+  if (runStatusCode != SOLVER_RUN_STATUS_SUCCESS_SOLVABLE &&
+      runStatusCode != SOLVER_RUN_STATUS_SUCCESS_UNSOLVABLE)
+    return false;
+
+  if (hasSolution)
+    ++stats::queriesInvalid;
+  else
+    ++stats::queriesValid;
+  return true;
+}
+
+/// Executed in the forked child: solve the query with one member and store
+/// the result in its shared memory slot.
+void PortfolioSolverImpl::runMember(unsigned index, const Query &query,
+                                    const std::vector<const Array *> &objects) {
+  SlotHeader *slot = getSlot(index);
+  std::vector<std::vector<unsigned char>> values;
+  bool hasSolution = false;
+  Solver *solver = members[index].solver;
+
+  slot->status =
+      solver->impl->computeInitialValues(query, objects, values, hasSolution)
+          ? solver->impl->getOperationStatusCode()
+          : SOLVER_RUN_STATUS_FAILURE;
+  slot->hasSolution = hasSolution;
+  slot->queryConstructs = stats::queryConstructs;
+
+  if (slot->status == SOLVER_RUN_STATUS_SUCCESS_SOLVABLE) {
+    unsigned char *pos = reinterpret_cast<unsigned char *>(slot + 1);
+    for (const auto &value : values)
+      pos = std::copy(value.begin(), value.end(), pos);
+  }
+}
+
+SolverImpl::SolverRunStatus PortfolioSolverImpl::runPortfolio(
+    const Query &query, const std::vector<const Array *> &objects,
+    std::vector<std::vector<unsigned char>> &values, bool &hasSolution) {
+  unsigned sum = sizeof(SlotHeader);
+  for (const auto object : objects)
+    sum += object->size;
+  if (sum >= shared_memory_size)
+    llvm::report_fatal_error("not enough shared memory for counterexample");
+
+  // Members report the index of their slot through this pipe once they are
+  // done. End of file means that all members have exited.
+  int fds[2];
+  if (pipe(fds) == -1) {
+    klee_warning("pipe failed (for portfolio solver) - %s",
+                 llvm::sys::StrError(errno).c_str());
+    return SOLVER_RUN_STATUS_FORK_FAILED;
+  }
+
+  fflush(stdout);
+  fflush(stderr);
+
+  std::vector<pid_t> pids;
+  for (unsigned i = 0; i < members.size(); ++i) {
+    getSlot(i)->status = SOLVER_RUN_STATUS_FAILURE;
+    int pid = fork();
+    // - error
+    if (pid == -1) {
+      klee_warning("fork failed (for %s) - %s", members[i].name.c_str(),
+                   llvm::sys::StrError(errno).c_str());
+      continue;
+    }
+    // - child (solver)
+    if (pid == 0) {
+      close(fds[0]);
+      ::alarm(0);
+      runMember(i, query, objects);
+      ssize_t written;
+      do {
+        written = write(fds[1], &i, sizeof(i));
+      } while (written < 0 && errno == EINTR);
+      _exit(0);
+    }
+    // - parent
+    pids.push_back(pid);
+  }
+  close(fds[1]);
+
+  SolverRunStatus status = pids.empty() ? SOLVER_RUN_STATUS_FORK_FAILED
+                                        : SOLVER_RUN_STATUS_FAILURE;
+  int winner = -1;
+  const time::Point deadline = time::getWallTime() + timeout;
+  for (unsigned pending = pids.size(); pending > 0;) {
+    int pollTimeout = -1;
+    if (timeout) {
+      time::Span remaining = deadline - time::getWallTime();
+      if (remaining <= time::Span()) {
+        status = SOLVER_RUN_STATUS_TIMEOUT;
+        break;
+      }
+      pollTimeout = std::max<int>(1, remaining.toMicroseconds() / 1000);
+    }
+
+    struct pollfd pfd = {fds[0], POLLIN, 0};
+    int ready = poll(&pfd, 1, pollTimeout);
+    if (ready < 0 && errno == EINTR)
+      continue;
+    if (ready < 0) {
+      klee_warning("poll() for portfolio solver failed");
+      break;
+    }
+    if (ready == 0) {
+      status = SOLVER_RUN_STATUS_TIMEOUT;
+      break;
+    }
+
+    unsigned index;
+    ssize_t got = read(fds[0], &index, sizeof(index));
+    if (got < 0 && errno == EINTR)
+      continue;
+    if (got != sizeof(index))
+      break; // all members terminated, some of them abnormally
+    --pending;
+
+    SolverRunStatus memberStatus = getSlot(index)->status;
+    if (memberStatus == SOLVER_RUN_STATUS_SUCCESS_SOLVABLE ||
+        memberStatus == SOLVER_RUN_STATUS_SUCCESS_UNSOLVABLE) {
+      winner = index;
+      status = memberStatus;
+      break;
+    }
+    if (memberStatus == SOLVER_RUN_STATUS_TIMEOUT)
+      status = SOLVER_RUN_STATUS_TIMEOUT;
+  }
+
+  // Kill the losers and reap everyone.
+  for (pid_t pid : pids)
+    kill(pid, SIGKILL);
+  for (pid_t pid : pids) {
+    int wstatus;
+    while (waitpid(pid, &wstatus, 0) < 0 && errno == EINTR)
+      ;
+  }
+  close(fds[0]);
+
+  if (winner < 0) {
+    if (status == SOLVER_RUN_STATUS_TIMEOUT)
+      klee_warning("portfolio solver timed out");
+    return status;
+  }
+
+  SlotHeader *slot = getSlot(winner);
+  ++*members[winner].wins;
+  stats::queryConstructs += slot->queryConstructs - stats::queryConstructs;
+
+  hasSolution = slot->hasSolution;
+  if (hasSolution) {
+    const unsigned char *pos = reinterpret_cast<unsigned char *>(slot + 1);
+    values.reserve(objects.size());
+    for (const auto object : objects) {
+      values.emplace_back(pos, pos + object->size);
+      pos += object->size;
+    }
+  }
+  return status;
+}
+
+SolverImpl::SolverRunStatus PortfolioSolverImpl::getOperationStatusCode() {
+  return runStatusCode;
+}
+
+PortfolioSolver::PortfolioSolver(const std::vector<Member> &members)
+    : Solver(new PortfolioSolverImpl(members)) {}
+
+char *PortfolioSolver::getConstraintLog(const Query &query) {
+  return impl->getConstraintLog(query);
+}
+
+void PortfolioSolver::setCoreSolverTimeout(time::Span timeout) {
+  impl->setCoreSolverTimeout(timeout);
+}
+
+} // namespace klee
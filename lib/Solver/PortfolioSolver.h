@@ -0,0 +1,49 @@
+//===-- PortfolioSolver.h ---------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_PORTFOLIOSOLVER_H
+#define KLEE_PORTFOLIOSOLVER_H
+
+#include "klee/Solver/Solver.h"
+#include "klee/Statistics/Statistic.h"
+
+#include <string>
+#include <vector>
+
+namespace klee {
+/// PortfolioSolver - A complete solver which races several core solvers
+/// against each other. Every query is handed to each member in a forked
+/// process; the first conclusive answer wins and the remaining processes are
+/// killed.
+class PortfolioSolver : public Solver {
+public:
+  struct Member {
+    /// Name used in diagnostics.
+    std::string name;
+    /// The member solver, must not fork on its own.
+    Solver *solver;
+    /// Incremented whenever this member answers a query first.
+    Statistic *wins;
+  };
+
+  /// PortfolioSolver - Construct a new PortfolioSolver which takes ownership
+  /// of the member solvers.
+  explicit PortfolioSolver(const std::vector<Member> &members);
+
+  /// getConstraintLog - Return the constraint log of the first member.
+  virtual char *getConstraintLog(const Query &);
+
+  /// setCoreSolverTimeout - Set constraint solver timeout delay to the given
+  /// value; 0
+  /// is off.
+  virtual void setCoreSolverTimeout(time::Span timeout);
+};
+}
+
+#endif /* KLEE_PORTFOLIOSOLVER_H */
@@ -0,0 +1,111 @@
+//===-- QueryHash.cpp -----------------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "QueryHash.h"
+
+#include "klee/Expr/Constraints.h"
+#include "klee/Solver/Solver.h"
+
+#include <algorithm>
+#include <vector>
+
+using namespace klee;
+
+QueryKey StructuralHasher::hashArray(const Array *array) {
+  auto it = arrays.find(array);
+  if (it != arrays.end())
+    return it->second;
+
+  QueryKey key = {1, 1};
+  for (char c : array->name)
+    combine(key, static_cast<uint64_t>(c));
+  combine(key, array->size);
+  combine(key, array->domain);
+  combine(key, array->range);
+  for (const ref<ConstantExpr> &value : array->constantValues)
+    combine(key, hash(value));
+  arrays.insert(std::make_pair(array, key));
+  return key;
+}
+
+QueryKey StructuralHasher::hashUpdates(const UpdateList &ul) {
+  // Collect the update chain so that it can be hashed from the root
+  // upwards; shared suffixes of update lists are hashed only once.
+  std::vector<const UpdateNode *> chain;
+  for (const UpdateNode *un = ul.head.get(); un; un = un->next.get()) {
+    if (updates.count(un))
+      break;
+    chain.push_back(un);
+  }
+
+  for (auto it = chain.rbegin(), ie = chain.rend(); it != ie; ++it) {
+    const UpdateNode *un = *it;
+    QueryKey key = un->next.isNull() ? hashArray(ul.root)
+                                     : updates.find(un->next.get())->second;
+    combine(key, hash(un->index));
+    combine(key, hash(un->value));
+    updates.insert(std::make_pair(un, key));
+  }
+
+  return ul.head.isNull() ? hashArray(ul.root)
+                          : updates.find(ul.head.get())->second;
+}
+
+QueryKey StructuralHasher::hash(const ref<Expr> &e) {
+  auto it = exprs.find(e);
+  if (it != exprs.end())
+    return it->second;
+
+  QueryKey key = {0, 0};
+  combine(key, e->getKind());
+  combine(key, e->getWidth());
+
+  if (const ConstantExpr *ce = dyn_cast<ConstantExpr>(e)) {
+    const llvm::APInt &value = ce->getAPValue();
+    for (unsigned i = 0, n = value.getNumWords(); i != n; ++i)
+      combine(key, value.getRawData()[i]);
+  } else {
+    if (const ExtractExpr *ee = dyn_cast<ExtractExpr>(e))
+      combine(key, ee->offset);
+    if (const ReadExpr *re = dyn_cast<ReadExpr>(e))
+      combine(key, hashUpdates(re->updates));
+    for (unsigned i = 0, n = e->getNumKids(); i != n; ++i)
+      combine(key, hash(e->getKid(i)));
+  }
+
+  exprs.insert(std::make_pair(e, key));
+  return key;
+}
+
+QueryKey klee::computeQueryKey(const Query &query, bool &negationUsed) {
+  ref<Expr> negatedQuery = Expr::createIsZero(query.expr);
+  ref<Expr> canonicalQuery;
+  if (query.expr.compare(negatedQuery) < 0) {
+    negationUsed = false;
+    canonicalQuery = query.expr;
+  } else {
+    negationUsed = true;
+    canonicalQuery = negatedQuery;
+  }
+
+  // The order of constraints does not matter for validity, so sort their
+  // hashes to make the key independent of it.
+  StructuralHasher hasher;
+  std::vector<QueryKey> constraintKeys;
+  constraintKeys.reserve(query.constraints.size());
+  for (auto const &constraint : query.constraints)
+    constraintKeys.push_back(hasher.hash(constraint));
+  std::sort(constraintKeys.begin(), constraintKeys.end());
+
+  QueryKey key = hasher.hash(canonicalQuery);
+  combine(key, constraintKeys.size());
+  for (auto const &constraintKey : constraintKeys)
+    combine(key, constraintKey);
+  return key;
+}
@@ -0,0 +1,81 @@
+//===-- QueryHash.h ---------------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_QUERYHASH_H
+#define KLEE_QUERYHASH_H
+
+#include "klee/Expr/Expr.h"
+#include "klee/Expr/ExprHashMap.h"
+
+#include <cstdint>
+#include <unordered_map>
+
+namespace klee {
+struct Query;
+
+/// QueryKey - A 128-bit hash value built from two independently mixed 64-bit
+/// lanes.
+struct QueryKey {
+  uint64_t lo, hi;
+
+  bool operator<(const QueryKey &b) const {
+    return lo < b.lo || (lo == b.lo && hi < b.hi);
+  }
+  bool operator==(const QueryKey &b) const { return lo == b.lo && hi == b.hi; }
+};
+
+struct QueryKeyHash {
+  size_t operator()(const QueryKey &key) const { return key.lo; }
+};
+
+inline uint64_t mix64(uint64_t x) {
+  x ^= x >> 30;
+  x *= 0xbf58476d1ce4e5b9ULL;
+  x ^= x >> 27;
+  x *= 0x94d049bb133111ebULL;
+  x ^= x >> 31;
+  return x;
+}
+
+inline void combine(QueryKey &key, uint64_t v) {
+  key.lo = mix64(key.lo * 0x9e3779b97f4a7c15ULL + v);
+  key.hi = mix64((key.hi ^ (v + 0x632be59bd9b4e019ULL)) * 0xc2b2ae3d27d4eb4fULL);
+}
+
+inline void combine(QueryKey &key, const QueryKey &v) {
+  combine(key, v.lo);
+  combine(key, v.hi);
+}
+
+/// StructuralHasher - Computes structural hashes of expressions. The hash
+/// only depends on the shape of the expressions, array names, sizes and
+/// constant values, never on pointer values, so it is stable across runs and
+/// does not keep any expression alive once the hasher is gone.
+class StructuralHasher {
+  ExprHashMap<QueryKey> exprs;
+  std::unordered_map<const UpdateNode *, QueryKey> updates;
+  std::unordered_map<const Array *, QueryKey> arrays;
+
+  QueryKey hashArray(const Array *array);
+  QueryKey hashUpdates(const UpdateList &ul);
+
+public:
+  QueryKey hash(const ref<Expr> &e);
+};
+
+/// computeQueryKey - Compute the key of the canonical version of the given
+/// validity query, i.e. of the query expression or its negation, whichever
+/// is smaller. The order of the constraints does not affect the key.
+///
+/// \param negationUsed [out] - Set to true if the query expression was
+/// negated in the canonicalization process.
+QueryKey computeQueryKey(const Query &query, bool &negationUsed);
+} // namespace klee
+
+#endif /* KLEE_QUERYHASH_H */
@@ -44,8 +44,6 @@ llvm::cl::opt<bool> IgnoreSolverFailures(
 
 #define vc_bvBoolExtract IAMTHESPAWNOFSATAN
 
-static unsigned char *shared_memory_ptr = nullptr;
-static int shared_memory_id = 0;
 // Darwin by default has a very small limit on the maximum amount of shared
 // memory, which will quickly be exhausted by KLEE running its tests in
 // parallel. For now, we work around this by just requesting a smaller size --
@@ -72,6 +70,17 @@ private:
   bool useForkedSTP;
   SolverRunStatus runStatusCode;
 
+  /// The region the forked STP process writes its counterexample to. Every
+  /// solver has its own, so that several solvers can be used at once (e.g.
+  /// by the threads of a thread-safe solver).
+  unsigned char *sharedMemoryPtr = nullptr;
+  /// The process that attached the region. Processes forked from KLEE
+  /// (e.g. the workers of the independent solver) that run STP themselves
+  /// must not share the region with their siblings and attach a new one.
+  pid_t sharedMemoryOwner = 0;
+
+  void attachSharedMemory();
+
 public:
   explicit STPSolverImpl(bool useForkedSTP, bool optimizeDivides = true);
   ~STPSolverImpl() override;
@@ -107,30 +116,31 @@ STPSolverImpl::STPSolverImpl(bool useForkedSTP, bool optimizeDivides)
 
   vc_registerErrorHandler(::stp_error_handler);
 
-  if (useForkedSTP) {
-    assert(shared_memory_id == 0 && "shared memory id already allocated");
-    shared_memory_id =
-        shmget(IPC_PRIVATE, shared_memory_size, IPC_CREAT | 0700);
-    if (shared_memory_id < 0)
-      llvm::report_fatal_error("unable to allocate shared memory region");
-    shared_memory_ptr = (unsigned char *)shmat(shared_memory_id, nullptr, 0);
-    if (shared_memory_ptr == (void *)-1)
-      llvm::report_fatal_error("unable to attach shared memory region");
-    shmctl(shared_memory_id, IPC_RMID, nullptr);
-  }
+  if (useForkedSTP)
+    attachSharedMemory();
 }
 
 STPSolverImpl::~STPSolverImpl() {
   // Detach the memory region.
-  shmdt(shared_memory_ptr);
-  shared_memory_ptr = nullptr;
-  shared_memory_id = 0;
+  if (sharedMemoryPtr)
+    shmdt(sharedMemoryPtr);
 
   delete builder;
 
   vc_Destroy(vc);
 }
 
+void STPSolverImpl::attachSharedMemory() {
+  int id = shmget(IPC_PRIVATE, shared_memory_size, IPC_CREAT | 0700);
+  if (id < 0)
+    llvm::report_fatal_error("unable to allocate shared memory region");
+  sharedMemoryPtr = (unsigned char *)shmat(id, nullptr, 0);
+  if (sharedMemoryPtr == (void *)-1)
+    llvm::report_fatal_error("unable to attach shared memory region");
+  shmctl(id, IPC_RMID, nullptr);
+  sharedMemoryOwner = getpid();
+}
+
 /***/
 
 char *STPSolverImpl::getConstraintLog(const Query &query) {
@@ -213,8 +223,8 @@ static SolverImpl::SolverRunStatus
 runAndGetCexForked(::VC vc, STPBuilder *builder, ::VCExpr q,
                    const std::vector<const Array *> &objects,
                    std::vector<std::vector<unsigned char>> &values,
-                   bool &hasSolution, time::Span timeout) {
-  unsigned char *pos = shared_memory_ptr;
+                   bool &hasSolution, time::Span timeout,
+                   unsigned char *pos) {
   unsigned sum = 0;
   for (const auto object : objects)
     sum += object->size;
@@ -341,8 +351,12 @@ bool STPSolverImpl::computeInitialValues(
 
   bool success;
   if (useForkedSTP) {
+    if (sharedMemoryOwner != getpid()) {
+      shmdt(sharedMemoryPtr);
+      attachSharedMemory();
+    }
     runStatusCode = runAndGetCexForked(vc, builder, stp_e, objects, values,
-                                       hasSolution, timeout);
+                                       hasSolution, timeout, sharedMemoryPtr);
     success = ((SOLVER_RUN_STATUS_SUCCESS_SOLVABLE == runStatusCode) ||
                (SOLVER_RUN_STATUS_SUCCESS_UNSOLVABLE == runStatusCode));
   } else {
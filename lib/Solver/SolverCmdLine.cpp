@@ -51,11 +51,39 @@ cl::opt<bool> UseBranchCache("use-branch-cache", cl::init(true),
                              cl::desc("Use the branch cache (default=true)"),
                              cl::cat(SolvingCat));
 
+cl::opt<bool> BranchCacheSubsumption(
+    "branch-cache-subsumption", cl::init(false),
+    cl::desc("Also answer branch queries from cached results for subsets and "
+             "supersets of the constraints (default=false)"),
+    cl::cat(SolvingCat));
+
+cl::opt<std::string> QueryCacheDir(
+    "query-cache-dir", cl::init(""),
+    cl::desc("Cache query results on disk in the given directory and reuse "
+             "them across runs. The directory can be shared by concurrent "
+             "KLEE processes (default=off)"),
+    cl::cat(SolvingCat));
+
 cl::opt<bool>
     UseIndependentSolver("use-independent-solver", cl::init(true),
                          cl::desc("Use constraint independence (default=true)"),
                          cl::cat(SolvingCat));
 
+cl::opt<unsigned> IndependentSolverJobs(
+    "independent-solver-jobs", cl::init(1),
+    cl::desc("Number of processes used to solve the independent factors of "
+             "a query for a counterexample in parallel. The solvers below "
+             "the independent solver, including the caches, neither see nor "
+             "count the factors solved by the other processes (default=1)"),
+    cl::cat(SolvingCat));
+
+cl::opt<unsigned> IndependentSolverParallelMinConstraints(
+    "independent-solver-parallel-min-constraints", cl::init(8),
+    cl::desc("Solve only factors with at least this many constraints in "
+             "parallel with --independent-solver-jobs. Smaller factors are "
+             "solved, and cached, in the process itself (default=8)"),
+    cl::cat(SolvingCat));
+
 cl::opt<bool> DebugValidateSolver(
     "debug-validate-solver", cl::init(false),
     cl::desc("Crosscheck the results of the solver chain above the core solver "
@@ -84,6 +112,13 @@ cl::opt<bool> UseForkedCoreSolver(
     cl::desc("Run the core SMT solver in a forked process (default=true)"),
     cl::init(true), cl::cat(SolvingCat));
 
+cl::opt<bool> SolverIncremental(
+    "solver-incremental",
+    cl::desc("Keep the core solver alive between queries and only assert the "
+             "constraints that changed since the previous query using "
+             "push/pop (only supported by Z3) (default=false)"),
+    cl::init(false), cl::cat(SolvingCat));
+
 cl::opt<bool> CoreSolverOptimizeDivides(
     "solver-optimize-divides",
     cl::desc("Optimize constant divides into add/shift/multiplies before "
@@ -195,10 +230,23 @@ cl::opt<CoreSolverType> CoreSolverToUse(
                clEnumValN(METASMT_SOLVER, "metasmt",
                           "metaSMT" METASMT_IS_DEFAULT_STR),
                clEnumValN(DUMMY_SOLVER, "dummy", "Dummy solver"),
-               clEnumValN(Z3_SOLVER, "z3", "Z3" Z3_IS_DEFAULT_STR)
+               clEnumValN(Z3_SOLVER, "z3", "Z3" Z3_IS_DEFAULT_STR),
+               clEnumValN(PORTFOLIO_SOLVER, "portfolio",
+                          "Race the solvers given by --solver-portfolio")
                    KLEE_LLVM_CL_VAL_END),
     cl::init(DEFAULT_CORE_SOLVER), cl::cat(SolvingCat));
 
+cl::list<CoreSolverType> PortfolioSolvers(
+    "solver-portfolio",
+    cl::desc("Core solvers raced against each other by "
+             "--solver-backend=portfolio. Multiple options can be specified "
+             "separated by a comma (default=all available solvers)"),
+    cl::values(clEnumValN(STP_SOLVER, "stp", "STP"),
+               clEnumValN(METASMT_SOLVER, "metasmt", "metaSMT"),
+               clEnumValN(Z3_SOLVER, "z3", "Z3")
+                   KLEE_LLVM_CL_VAL_END),
+    cl::CommaSeparated, cl::cat(SolvingCat));
+
 cl::opt<CoreSolverType> DebugCrossCheckCoreSolverWith(
     "debug-crosscheck-core-solver",
     cl::desc(
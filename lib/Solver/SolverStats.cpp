@@ -17,11 +17,27 @@ Statistic stats::queriesInvalid("QueriesInvalid", "Qiv");
 Statistic stats::queriesValid("QueriesValid", "Qv");
 Statistic stats::queryCacheHits("QueryCacheHits", "QChits") ;
 Statistic stats::queryCacheMisses("QueryCacheMisses", "QCmisses");
+Statistic stats::queryCacheExactHits("QueryCacheExactHits", "QCEhits");
+Statistic stats::queryCacheSubsumptionHits("QueryCacheSubsumptionHits",
+                                           "QCShits");
 Statistic stats::queryCexCacheHits("QueryCexCacheHits", "QCexHits") ;
 Statistic stats::queryCexCacheMisses("QueryCexCacheMisses", "QCexMisses");
+Statistic stats::queryPersistentCacheHits("QueryPersistentCacheHits",
+                                          "QPChits");
+Statistic stats::queryPersistentCacheMisses("QueryPersistentCacheMisses",
+                                            "QPCmisses");
+Statistic stats::querySharedCacheHits("QuerySharedCacheHits", "QSChits");
+Statistic stats::querySharedCacheMisses("QuerySharedCacheMisses",
+                                        "QSCmisses");
 Statistic stats::queryConstructs("QueryConstructs", "QB");
 Statistic stats::queryCounterexamples("QueriesCEX", "Qcex");
 Statistic stats::queryTime("QueryTime", "Qtime");
+Statistic stats::portfolioWinsSTP("PortfolioWinsSTP", "PWstp");
+Statistic stats::portfolioWinsMetaSMT("PortfolioWinsMetaSMT", "PWmetasmt");
+Statistic stats::portfolioWinsZ3("PortfolioWinsZ3", "PWz3");
+Statistic stats::solverIncrementalHits("SolverIncrementalHits", "SIhits");
+Statistic stats::solverIncrementalMisses("SolverIncrementalMisses",
+                                         "SImisses");
 
 #ifdef KLEE_ARRAY_DEBUG
 Statistic stats::arrayHashTime("ArrayHashTime", "AHtime");
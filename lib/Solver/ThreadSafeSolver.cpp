@@ -0,0 +1,318 @@
+//===-- ThreadSafeSolver.cpp - Solver for concurrent use ------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// None of the solver layers are safe to call from several threads at once,
+// and expressions cannot be shared between threads because their reference
+// counts are not atomic. The thread-safe solver therefore gives every thread
+// a private solver chain, including its own core solver. What is shared is a
+// sharded validity cache keyed by structural hashes (see QueryHash.h): it
+// does not hold any expressions, so a result computed on one thread can be
+// reused by all others.
+//
+//===----------------------------------------------------------------------===//
+
+#include "QueryHash.h"
+
+#include "klee/Solver/Solver.h"
+
+#include "klee/Expr/Constraints.h"
+#include "klee/Solver/IncompleteSolver.h"
+#include "klee/Solver/SolverImpl.h"
+#include "klee/Solver/SolverStats.h"
+#include "klee/Statistics/Statistics.h"
+
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+using namespace klee;
+
+namespace klee {
+
+/// A validity cache that can be used from several threads at once. Entries
+/// are spread over independently locked shards, so threads only contend
+/// when they happen to access the same shard.
+class SharedQueryCache {
+  static constexpr unsigned NumShards = 64;
+
+  struct Shard {
+    std::mutex lock;
+    std::unordered_map<QueryKey, IncompleteSolver::PartialValidity,
+                       QueryKeyHash>
+        entries;
+  };
+
+  Shard shards[NumShards];
+
+  Shard &getShard(const QueryKey &key) { return shards[key.hi % NumShards]; }
+
+public:
+  bool lookup(const QueryKey &key, IncompleteSolver::PartialValidity &result) {
+    Shard &shard = getShard(key);
+    std::lock_guard<std::mutex> guard(shard.lock);
+    auto it = shard.entries.find(key);
+    if (it == shard.entries.end())
+      return false;
+    result = it->second;
+    return true;
+  }
+
+  void insert(const QueryKey &key, IncompleteSolver::PartialValidity result) {
+    Shard &shard = getShard(key);
+    std::lock_guard<std::mutex> guard(shard.lock);
+    shard.entries[key] = result;
+  }
+};
+
+} // namespace klee
+
+namespace {
+
+class SharedCachingSolver : public SolverImpl {
+private:
+  Solver *solver;
+  SharedQueryCache &cache;
+
+  void cacheInsert(const Query &query,
+                   IncompleteSolver::PartialValidity result);
+
+  bool cacheLookup(const Query &query,
+                   IncompleteSolver::PartialValidity &result);
+
+public:
+  SharedCachingSolver(Solver *s, SharedQueryCache &cache)
+      : solver(s), cache(cache) {}
+  ~SharedCachingSolver() { delete solver; }
+
+  bool computeValidity(const Query &, Solver::Validity &result);
+  bool computeTruth(const Query &, bool &isValid);
+  bool computeValue(const Query &query, ref<Expr> &result) {
+    return solver->impl->computeValue(query, result);
+  }
+  bool computeInitialValues(const Query &query,
+                            const std::vector<const Array *> &objects,
+                            std::vector<std::vector<unsigned char> > &values,
+                            bool &hasSolution) {
+    return solver->impl->computeInitialValues(query, objects, values,
+                                              hasSolution);
+  }
+  SolverRunStatus getOperationStatusCode();
+  char *getConstraintLog(const Query &);
+  void setCoreSolverTimeout(time::Span timeout);
+};
+
+bool SharedCachingSolver::cacheLookup(
+    const Query &query, IncompleteSolver::PartialValidity &result) {
+  bool negationUsed;
+  QueryKey key = computeQueryKey(query, negationUsed);
+  if (!cache.lookup(key, result))
+    return false;
+  if (negationUsed)
+    result = IncompleteSolver::negatePartialValidity(result);
+  return true;
+}
+
+void SharedCachingSolver::cacheInsert(
+    const Query &query, IncompleteSolver::PartialValidity result) {
+  bool negationUsed;
+  QueryKey key = computeQueryKey(query, negationUsed);
+  cache.insert(key, negationUsed
+                        ? IncompleteSolver::negatePartialValidity(result)
+                        : result);
+}
+
+bool SharedCachingSolver::computeValidity(const Query &query,
+                                          Solver::Validity &result) {
+  IncompleteSolver::PartialValidity cachedResult;
+  if (cacheLookup(query, cachedResult)) {
+    switch (cachedResult) {
+    case IncompleteSolver::MustBeTrue:
+      result = Solver::True;
+      ++stats::querySharedCacheHits;
+      return true;
+    case IncompleteSolver::MustBeFalse:
+      result = Solver::False;
+      ++stats::querySharedCacheHits;
+      return true;
+    case IncompleteSolver::TrueOrFalse:
+      result = Solver::Unknown;
+      ++stats::querySharedCacheHits;
+      return true;
+    default:
+      // Only partial information is cached, ask the solver.
+      break;
+    }
+  }
+
+  ++stats::querySharedCacheMisses;
+
+  if (!solver->impl->computeValidity(query, result))
+    return false;
+
+  switch (result) {
+  case Solver::True:
+    cachedResult = IncompleteSolver::MustBeTrue;
+    break;
+  case Solver::False:
+    cachedResult = IncompleteSolver::MustBeFalse;
+    break;
+  default:
+    cachedResult = IncompleteSolver::TrueOrFalse;
+    break;
+  }
+
+  cacheInsert(query, cachedResult);
+  return true;
+}
+
+bool SharedCachingSolver::computeTruth(const Query &query, bool &isValid) {
+  IncompleteSolver::PartialValidity cachedResult;
+  bool cacheHit = cacheLookup(query, cachedResult);
+
+  // a cached result of MayBeTrue forces us to check whether
+  // a False assignment exists.
+  if (cacheHit && cachedResult != IncompleteSolver::MayBeTrue) {
+    ++stats::querySharedCacheHits;
+    isValid = (cachedResult == IncompleteSolver::MustBeTrue);
+    return true;
+  }
+
+  ++stats::querySharedCacheMisses;
+
+  if (!solver->impl->computeTruth(query, isValid))
+    return false;
+
+  if (isValid) {
+    cachedResult = IncompleteSolver::MustBeTrue;
+  } else if (cacheHit) {
+    assert(cachedResult == IncompleteSolver::MayBeTrue);
+    cachedResult = IncompleteSolver::TrueOrFalse;
+  } else {
+    cachedResult = IncompleteSolver::MayBeFalse;
+  }
+
+  cacheInsert(query, cachedResult);
+  return true;
+}
+
+SolverImpl::SolverRunStatus SharedCachingSolver::getOperationStatusCode() {
+  return solver->impl->getOperationStatusCode();
+}
+
+char *SharedCachingSolver::getConstraintLog(const Query &query) {
+  return solver->impl->getConstraintLog(query);
+}
+
+void SharedCachingSolver::setCoreSolverTimeout(time::Span timeout) {
+  solver->impl->setCoreSolverTimeout(timeout);
+}
+
+class ThreadSafeSolverImpl : public SolverImpl {
+private:
+  /// The chain of the calling thread, together with the timeout that was
+  /// last applied to it.
+  struct ThreadChain {
+    Solver *solver;
+    uint64_t timeout;
+  };
+
+  /// Chains of the current thread, indexed by solver id. Lookups in here
+  /// need no synchronization.
+  static thread_local std::unordered_map<uint64_t, ThreadChain> threadChains;
+  static std::atomic<uint64_t> nextId;
+
+  const uint64_t id;
+  ThreadSafeSolverChainConstructor constructChain;
+  SharedQueryCache cache;
+
+  /// The timeout in microseconds, applied lazily by each thread to its
+  /// own chain.
+  std::atomic<uint64_t> timeout;
+
+  /// All chains, so that they can be deleted together with the solver.
+  std::mutex chainsLock;
+  std::vector<Solver *> chains;
+
+  Solver &getChain();
+
+public:
+  explicit ThreadSafeSolverImpl(ThreadSafeSolverChainConstructor constructChain)
+      : id(nextId++), constructChain(std::move(constructChain)), timeout(0) {}
+  ~ThreadSafeSolverImpl();
+
+  bool computeValidity(const Query &query, Solver::Validity &result) {
+    return getChain().impl->computeValidity(query, result);
+  }
+  bool computeTruth(const Query &query, bool &isValid) {
+    return getChain().impl->computeTruth(query, isValid);
+  }
+  bool computeValue(const Query &query, ref<Expr> &result) {
+    return getChain().impl->computeValue(query, result);
+  }
+  bool computeInitialValues(const Query &query,
+                            const std::vector<const Array *> &objects,
+                            std::vector<std::vector<unsigned char> > &values,
+                            bool &hasSolution) {
+    return getChain().impl->computeInitialValues(query, objects, values,
+                                                 hasSolution);
+  }
+  SolverRunStatus getOperationStatusCode() {
+    return getChain().impl->getOperationStatusCode();
+  }
+  char *getConstraintLog(const Query &query) {
+    return getChain().impl->getConstraintLog(query);
+  }
+  void setCoreSolverTimeout(time::Span timeout) {
+    this->timeout = timeout.toMicroseconds();
+  }
+};
+
+thread_local std::unordered_map<uint64_t, ThreadSafeSolverImpl::ThreadChain>
+    ThreadSafeSolverImpl::threadChains;
+std::atomic<uint64_t> ThreadSafeSolverImpl::nextId(0);
+
+ThreadSafeSolverImpl::~ThreadSafeSolverImpl() {
+  threadChains.erase(id);
+  for (Solver *chain : chains)
+    delete chain;
+}
+
+Solver &ThreadSafeSolverImpl::getChain() {
+  auto it = threadChains.find(id);
+  if (it == threadChains.end()) {
+    Solver *chain = constructChain(cache);
+    {
+      std::lock_guard<std::mutex> guard(chainsLock);
+      chains.push_back(chain);
+    }
+    it = threadChains.insert(std::make_pair(id, ThreadChain{chain, 0})).first;
+  }
+
+  ThreadChain &threadChain = it->second;
+  uint64_t currentTimeout = timeout;
+  if (threadChain.timeout != currentTimeout) {
+    threadChain.solver->setCoreSolverTimeout(
+        time::microseconds(currentTimeout));
+    threadChain.timeout = currentTimeout;
+  }
+  return *threadChain.solver;
+}
+
+} // namespace
+
+Solver *klee::createSharedCachingSolver(Solver *s, SharedQueryCache &cache) {
+  return new Solver(new SharedCachingSolver(s, cache));
+}
+
+Solver *
+klee::createThreadSafeSolver(ThreadSafeSolverChainConstructor constructChain) {
+  theStatisticManager->setThreadSafe(true);
+  return new Solver(new ThreadSafeSolverImpl(std::move(constructChain)));
+}
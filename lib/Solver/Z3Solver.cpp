@@ -21,6 +21,7 @@
 #include "klee/Expr/Assignment.h"
 #include "klee/Expr/ExprUtil.h"
 #include "klee/Solver/Solver.h"
+#include "klee/Solver/SolverCmdLine.h"
 #include "klee/Solver/SolverImpl.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/raw_ostream.h"
@@ -63,6 +64,15 @@ private:
   // Parameter symbols
   ::Z3_symbol timeoutParamStrSymbol;
 
+  // State for `--solver-incremental`: a long-lived solver and the
+  // constraints currently asserted in it, one push scope per constraint.
+  ::Z3_solver incrementalSolver;
+  std::vector<ref<Expr> > assertedConstraints;
+
+  ::Z3_solver prepareIncrementalSolver(const ConstraintSet &constraints);
+  void resetIncrementalSolver();
+  void assertConstantArrays(::Z3_solver theSolver, const ref<Expr> &e);
+
   bool internalRunSolver(const Query &,
                          const std::vector<const Array *> *objects,
                          std::vector<std::vector<unsigned char> > *values,
@@ -104,7 +114,7 @@ Z3SolverImpl::Z3SolverImpl()
           /*z3LogInteractionFileArg=*/Z3LogInteractionFile.size() > 0
               ? Z3LogInteractionFile.c_str()
               : NULL)),
-      runStatusCode(SOLVER_RUN_STATUS_FAILURE) {
+      runStatusCode(SOLVER_RUN_STATUS_FAILURE), incrementalSolver(NULL) {
   assert(builder && "unable to create Z3Builder");
   solverParameters = Z3_mk_params(builder->ctx);
   Z3_params_inc_ref(builder->ctx, solverParameters);
@@ -132,6 +142,7 @@ Z3SolverImpl::Z3SolverImpl()
 }
 
 Z3SolverImpl::~Z3SolverImpl() {
+  resetIncrementalSolver();
   Z3_params_dec_ref(builder->ctx, solverParameters);
   delete builder;
 }
@@ -250,36 +261,52 @@ bool Z3SolverImpl::internalRunSolver(
 
   TimerStatIncrementer t(stats::queryTime);
   // NOTE: Z3 will switch to using a slower solver internally if push/pop are
-  // used so for now it is likely that creating a new solver each time is the
-  // right way to go until Z3 changes its behaviour.
+  // used so by default we create a new solver for each query. With
+  // `--solver-incremental` we instead keep one solver alive and only
+  // (re-)assert the constraints that differ from the previous query, which
+  // pays off when consecutive queries share most of their path constraints.
   //
   // TODO: Investigate using a custom tactic as described in
   // https://github.com/klee/klee/issues/653
-  Z3_solver theSolver = Z3_mk_solver(builder->ctx);
-  Z3_solver_inc_ref(builder->ctx, theSolver);
-  Z3_solver_set_params(builder->ctx, theSolver, solverParameters);
+  Z3_solver theSolver;
+  Z3ASTHandle z3QueryExpr;
 
   runStatusCode = SOLVER_RUN_STATUS_FAILURE;
 
-  ConstantArrayFinder constant_arrays_in_query;
-  for (auto const &constraint : query.constraints) {
-    Z3_solver_assert(builder->ctx, theSolver, builder->construct(constraint));
-    constant_arrays_in_query.visit(constraint);
-  }
-  ++stats::queries;
-  if (objects)
-    ++stats::queryCounterexamples;
-
-  Z3ASTHandle z3QueryExpr =
-      Z3ASTHandle(builder->construct(query.expr), builder->ctx);
-  constant_arrays_in_query.visit(query.expr);
-
-  for (auto const &constant_array : constant_arrays_in_query.results) {
-    assert(builder->constant_array_assertions.count(constant_array) == 1 &&
-           "Constant array found in query, but not handled by Z3Builder");
-    for (auto const &arrayIndexValueExpr :
-         builder->constant_array_assertions[constant_array]) {
-      Z3_solver_assert(builder->ctx, theSolver, arrayIndexValueExpr);
+  if (SolverIncremental) {
+    theSolver = prepareIncrementalSolver(query.constraints);
+    // The query itself lives in its own scope which is popped afterwards.
+    Z3_solver_push(builder->ctx, theSolver);
+    ++stats::queries;
+    if (objects)
+      ++stats::queryCounterexamples;
+
+    z3QueryExpr = Z3ASTHandle(builder->construct(query.expr), builder->ctx);
+    assertConstantArrays(theSolver, query.expr);
+  } else {
+    theSolver = Z3_mk_solver(builder->ctx);
+    Z3_solver_inc_ref(builder->ctx, theSolver);
+    Z3_solver_set_params(builder->ctx, theSolver, solverParameters);
+
+    ConstantArrayFinder constant_arrays_in_query;
+    for (auto const &constraint : query.constraints) {
+      Z3_solver_assert(builder->ctx, theSolver, builder->construct(constraint));
+      constant_arrays_in_query.visit(constraint);
+    }
+    ++stats::queries;
+    if (objects)
+      ++stats::queryCounterexamples;
+
+    z3QueryExpr = Z3ASTHandle(builder->construct(query.expr), builder->ctx);
+    constant_arrays_in_query.visit(query.expr);
+
+    for (auto const &constant_array : constant_arrays_in_query.results) {
+      assert(builder->constant_array_assertions.count(constant_array) == 1 &&
+             "Constant array found in query, but not handled by Z3Builder");
+      for (auto const &arrayIndexValueExpr :
+           builder->constant_array_assertions[constant_array]) {
+        Z3_solver_assert(builder->ctx, theSolver, arrayIndexValueExpr);
+      }
     }
   }
 
@@ -305,7 +332,17 @@ bool Z3SolverImpl::internalRunSolver(
   runStatusCode = handleSolverResponse(theSolver, satisfiable, objects, values,
                                        hasSolution);
 
-  Z3_solver_dec_ref(builder->ctx, theSolver);
+  if (SolverIncremental) {
+    // Drop the query scope but keep the constraints for the next query. If
+    // the solver gave up we start from scratch next time rather than trusting
+    // whatever state Z3 was left in.
+    Z3_solver_pop(builder->ctx, theSolver, 1);
+    if (runStatusCode != SolverImpl::SOLVER_RUN_STATUS_SUCCESS_SOLVABLE &&
+        runStatusCode != SolverImpl::SOLVER_RUN_STATUS_SUCCESS_UNSOLVABLE)
+      resetIncrementalSolver();
+  } else {
+    Z3_solver_dec_ref(builder->ctx, theSolver);
+  }
   // Clear the builder's cache to prevent memory usage exploding.
   // By using ``autoClearConstructCache=false`` and clearning now
   // we allow Z3_ast expressions to be shared from an entire
@@ -325,6 +362,65 @@ bool Z3SolverImpl::internalRunSolver(
   return false; // failed
 }
 
+::Z3_solver
+Z3SolverImpl::prepareIncrementalSolver(const ConstraintSet &constraints) {
+  if (!incrementalSolver) {
+    incrementalSolver = Z3_mk_solver(builder->ctx);
+    Z3_solver_inc_ref(builder->ctx, incrementalSolver);
+  }
+  // The timeout might have changed since the last query.
+  Z3_solver_set_params(builder->ctx, incrementalSolver, solverParameters);
+
+  // Keep the longest prefix of `constraints` that is already asserted and
+  // pop everything above it.
+  size_t reused = 0;
+  auto it = constraints.begin(), ie = constraints.end();
+  while (reused < assertedConstraints.size() && it != ie &&
+         assertedConstraints[reused] == *it) {
+    ++reused;
+    ++it;
+  }
+  if (reused < assertedConstraints.size()) {
+    Z3_solver_pop(builder->ctx, incrementalSolver,
+                  assertedConstraints.size() - reused);
+    assertedConstraints.resize(reused);
+  }
+  stats::solverIncrementalHits += reused;
+
+  // Each new constraint gets its own scope so that it can be retracted
+  // individually when a sibling state diverges at that point.
+  for (; it != ie; ++it) {
+    Z3_solver_push(builder->ctx, incrementalSolver);
+    Z3_solver_assert(builder->ctx, incrementalSolver, builder->construct(*it));
+    assertConstantArrays(incrementalSolver, *it);
+    assertedConstraints.push_back(*it);
+    ++stats::solverIncrementalMisses;
+  }
+  return incrementalSolver;
+}
+
+void Z3SolverImpl::resetIncrementalSolver() {
+  if (!incrementalSolver)
+    return;
+  Z3_solver_dec_ref(builder->ctx, incrementalSolver);
+  incrementalSolver = NULL;
+  assertedConstraints.clear();
+}
+
+void Z3SolverImpl::assertConstantArrays(::Z3_solver theSolver,
+                                        const ref<Expr> &e) {
+  ConstantArrayFinder constant_arrays_in_expr;
+  constant_arrays_in_expr.visit(e);
+  for (auto const &constant_array : constant_arrays_in_expr.results) {
+    assert(builder->constant_array_assertions.count(constant_array) == 1 &&
+           "Constant array found in query, but not handled by Z3Builder");
+    for (auto const &arrayIndexValueExpr :
+         builder->constant_array_assertions[constant_array]) {
+      Z3_solver_assert(builder->ctx, theSolver, arrayIndexValueExpr);
+    }
+  }
+}
+
 SolverImpl::SolverRunStatus Z3SolverImpl::handleSolverResponse(
     ::Z3_solver theSolver, ::Z3_lbool satisfiable,
     const std::vector<const Array *> *objects,
@@ -0,0 +1,26 @@
+// RUN: %clang %s -emit-llvm -g %O0opt -c -o %t.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out --adaptive-solver-timeout --max-solver-time=10s --write-query-time-histogram %t.bc 2>&1 | FileCheck %s
+// RUN: FileCheck --check-prefix=CHECK-HISTOGRAM %s < %t.klee-out/query-times.txt
+
+// CHECK: KLEE: done: completed paths = 17
+
+// CHECK-HISTOGRAM: # Query time (us)	Queries	Percent
+// CHECK-HISTOGRAM: [0, 1)
+
+#include "klee/klee.h"
+
+int main() {
+  unsigned x;
+  klee_make_symbolic(&x, sizeof(x), "x");
+
+  // All branches are on the same instruction, so its query times build up a
+  // profile for the adaptive timeout.
+  unsigned count = 0;
+  for (unsigned i = 0; i < 16; ++i) {
+    if (x == i)
+      break;
+    ++count;
+  }
+  return count;
+}
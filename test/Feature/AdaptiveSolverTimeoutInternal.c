@@ -0,0 +1,33 @@
+// RUN: %clang %s -emit-llvm -g %O0opt -c -o %t.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out --adaptive-solver-timeout --adaptive-solver-timeout-min=1ms --adaptive-solver-timeout-factor=1 --max-solver-time=10s %t.bc 2>&1 | FileCheck %s
+
+// Internal forks cannot be retried, so they are not cut off by the adaptive
+// timeout even when their queries take longer than usual.
+// CHECK-NOT: retrying query cut off by the adaptive solver timeout
+// CHECK-NOT: Query timed out
+// CHECK: KLEE: done: completed paths = 18
+
+#include "klee/klee.h"
+
+#include <stdlib.h>
+
+int main() {
+  unsigned x, y;
+  klee_make_symbolic(&x, sizeof(x), "x");
+  klee_make_symbolic(&y, sizeof(y), "y");
+  klee_assume(x > 1 & x < 65536 & y > 1 & y < 65536);
+
+  // realloc forks internally on whether the size is zero. Quick queries at
+  // the call build up its profile, then factoring the product of two primes
+  // takes longer.
+  char *p = malloc(1);
+  for (unsigned i = 0; i <= 16; ++i) {
+    unsigned size = i < 16 ? (x != i + 2) : (x * y != 65521u * 65519u);
+    p = realloc(p, size);
+    if (!p)
+      return i;
+  }
+  free(p);
+  return 17;
+}
@@ -0,0 +1,33 @@
+// RUN: %clang %s -emit-llvm -g %O0opt -c -o %t.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out --max-solver-time=10s %t.bc 2> %t.plain.log
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out --adaptive-solver-timeout --adaptive-solver-timeout-min=1ms --adaptive-solver-timeout-factor=1 --max-solver-time=10s %t.bc 2> %t.retry.log
+// RUN: FileCheck %s < %t.retry.log
+// RUN: grep "total instructions" %t.plain.log > %t.plain.instrs
+// RUN: grep "total instructions" %t.retry.log > %t.retry.instrs
+// RUN: diff %t.plain.instrs %t.retry.instrs
+
+// The retried branch is executed again, but counted only once.
+// CHECK: retrying query cut off by the adaptive solver timeout
+// CHECK-NOT: Query timed out
+// CHECK: KLEE: done: completed paths = 18
+
+#include "klee/klee.h"
+
+int main() {
+  unsigned x, y;
+  klee_make_symbolic(&x, sizeof(x), "x");
+  klee_make_symbolic(&y, sizeof(y), "y");
+  klee_assume(x > 1 & x < 65536 & y > 1 & y < 65536);
+
+  // Quick queries at the branch set its adaptive timeout to the minimum,
+  // which factoring the product of two primes then exceeds.
+  for (unsigned i = 0; i <= 16; ++i) {
+    unsigned value = i < 16 ? x : x * y;
+    unsigned target = i < 16 ? i + 2 : 65521u * 65519u;
+    if (value == target)
+      return i;
+  }
+  return 0;
+}
@@ -0,0 +1,39 @@
+// RUN: %clang %s -emit-llvm -g %O0opt -c -o %t.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out --bulk-memory-ops %t.bc 2>&1 | FileCheck %s
+// RUN: test -f %t.klee-out/test000001.ptr.err -o -f %t.klee-out/test000002.ptr.err
+
+// CHECK: KLEE: ERROR: {{.*}}memory error: out of bound pointer
+// CHECK: KLEE: done: completed paths = 2
+
+#include "klee/klee.h"
+
+#include <assert.h>
+#include <string.h>
+
+int main() {
+  char src[16], dst[16];
+  unsigned char sym;
+  klee_make_symbolic(&sym, sizeof(sym), "sym");
+
+  // Concrete and symbolic bytes are copied alike
+  for (int i = 0; i < 16; ++i)
+    src[i] = i;
+  src[5] = sym;
+  memcpy(dst, src, sizeof(src));
+  assert(dst[3] == 3 && dst[5] == (char)sym);
+
+  // Overlapping ranges
+  memmove(dst + 1, dst, 8);
+  assert(dst[1] == 0 && dst[4] == 3 && dst[6] == (char)sym);
+
+  // Symbolic fill value
+  memset(dst, sym, 4);
+  assert(dst[0] == (char)sym && dst[3] == (char)sym && dst[4] == 3);
+
+  // Out of bounds copies are still reported by the library implementation
+  if (sym == 42)
+    memcpy(dst, src, sizeof(src) + 1);
+
+  return 0;
+}
@@ -0,0 +1,54 @@
+// RUN: %clang %s -emit-llvm -g %O0opt -c -o %t.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out %t.bc 2>&1 | FileCheck %s
+// RUN: ls %t.klee-out | not grep assert.err
+
+// Operations on constant operands take the executor's pre-decoded path,
+// operations on symbolic operands go through the expression builder. Both
+// have to give the same results.
+// CHECK-NOT: ASSERTION FAIL
+// CHECK: KLEE: done: completed paths = 1
+
+#include "klee/klee.h"
+
+#include <assert.h>
+
+#define CHECK_OPERATIONS(type, a, b)                                           \
+  do {                                                                         \
+    type x = (a), y = (b), sx, sy;                                             \
+    klee_make_symbolic(&sx, sizeof(sx), "sx");                                 \
+    klee_make_symbolic(&sy, sizeof(sy), "sy");                                 \
+    klee_assume(sx == x);                                                      \
+    klee_assume(sy == y);                                                      \
+    klee_assert((x + y) == (sx + sy));                                         \
+    klee_assert((x - y) == (sx - sy));                                         \
+    klee_assert((x * y) == (sx * sy));                                         \
+    klee_assert((x / y) == (sx / sy));                                         \
+    klee_assert((x % y) == (sx % sy));                                         \
+    klee_assert((x & y) == (sx & sy));                                         \
+    klee_assert((x | y) == (sx | sy));                                         \
+    klee_assert((x ^ y) == (sx ^ sy));                                         \
+    klee_assert((x << (y & 7)) == (sx << (sy & 7)));                           \
+    klee_assert((x >> (y & 7)) == (sx >> (sy & 7)));                           \
+    klee_assert((x == y) == (sx == sy));                                       \
+    klee_assert((x != y) == (sx != sy));                                       \
+    klee_assert((x < y) == (sx < sy));                                         \
+    klee_assert((x <= y) == (sx <= sy));                                       \
+    klee_assert((x > y) == (sx > sy));                                         \
+    klee_assert((x >= y) == (sx >= sy));                                       \
+  } while (0)
+
+int main() {
+  CHECK_OPERATIONS(int, 100, 7);
+  CHECK_OPERATIONS(int, -100, 7);
+  CHECK_OPERATIONS(int, 100, -7);
+  CHECK_OPERATIONS(int, -2147483647 - 1, 3);
+  CHECK_OPERATIONS(unsigned, 100, 7);
+  CHECK_OPERATIONS(unsigned, 0xFFFFFF9Cu, 7);
+  CHECK_OPERATIONS(unsigned, 7, 0xFFFFFFF9u);
+  CHECK_OPERATIONS(long long, -1000000000000LL, 13);
+  CHECK_OPERATIONS(long long, 1000000000000LL, -13);
+  CHECK_OPERATIONS(unsigned long long, 0xFFFFFFFFFFFFF000ull, 13);
+  CHECK_OPERATIONS(unsigned long long, 13, 0xFFFFFFFFFFFFF000ull);
+  return 0;
+}
@@ -0,0 +1,25 @@
+// RUN: %clang %s -emit-llvm -g %O0opt -c -o %t.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out --exploration-jobs=2 %t.bc 2>&1 | FileCheck %s
+// RUN: test -f %t.klee-out/test000008.ktest
+
+// CHECK: KLEE: done: completed paths = 8
+// CHECK: KLEE: done: generated tests = 8
+
+#include "klee/klee.h"
+
+int main() {
+  int x;
+  klee_make_symbolic(&x, sizeof(x), "x");
+
+  // Paths are split between the processes; all of them are counted
+  int n = 0;
+  if (x & 1)
+    ++n;
+  if (x & 2)
+    ++n;
+  if (x & 4)
+    ++n;
+
+  return n;
+}
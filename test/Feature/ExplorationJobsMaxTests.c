@@ -0,0 +1,23 @@
+// RUN: %clang %s -emit-llvm -g %O0opt -c -o %t.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out --exploration-jobs=4 --max-tests=3 --dump-states-on-halt=false %t.bc 2>&1 | FileCheck %s
+// RUN: test -f %t.klee-out/test000003.ktest
+// RUN: not test -f %t.klee-out/test000010.ktest
+
+// Processes generating tests at the same time must not miss the limit.
+// Each process stops after its first test at or beyond the limit.
+// CHECK: KLEE: done: generated tests = {{[3-6]$}}
+
+#include "klee/klee.h"
+
+int main() {
+  unsigned char x;
+  klee_make_symbolic(&x, sizeof(x), "x");
+
+  int n = 0;
+  for (int bit = 0; bit < 6; ++bit)
+    if (x & (1 << bit))
+      ++n;
+
+  return n;
+}
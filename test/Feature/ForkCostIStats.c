@@ -0,0 +1,30 @@
+// Check that the cost of forks is written to run.istats.
+//
+// RUN: %clang %s -emit-llvm -g %O0opt -c -o %t1.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out %t1.bc 2>&1 | FileCheck --check-prefix=CHECK-RUN %s
+// RUN: FileCheck < %t.klee-out/run.istats %s
+
+// CHECK-RUN: KLEE: done: completed paths = 2
+
+// CHECK: event: FCbytes : ForkCopyBytes
+// CHECK: event: FCtime : ForkCopyTime
+// CHECK: event: FQtime : ForkQueryTime
+// CHECK: event: Ftime : ForkTime
+// CHECK: event: Forks : Forks
+// CHECK: events: {{.*}}FCbytes FCtime FQtime Ftime Forks
+
+#include "klee/klee.h"
+
+char buffer[4096];
+
+int main() {
+  int x;
+  klee_make_symbolic(&x, sizeof(x), "x");
+  // Both states write to the buffer they share after the fork
+  if (x > 0)
+    buffer[0] = 1;
+  else
+    buffer[1] = 2;
+  return 0;
+}
@@ -0,0 +1,43 @@
+// RUN: %clang %s -emit-llvm -g %O0opt -c -o %t.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out --native-function=checksum,scale,report %t.bc 2>&1 | FileCheck %s
+// RUN: test -f %t.klee-out/test000001.div.err -o -f %t.klee-out/test000002.div.err
+
+// CHECK: KLEE: WARNING: cannot execute report natively: calls the undefined function printf
+// CHECK: KLEE: ERROR: {{.*}}divide by zero
+// CHECK: KLEE: done: completed paths = 2
+
+#include "klee/klee.h"
+
+#include <assert.h>
+#include <stdio.h>
+
+static unsigned char table[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+
+unsigned checksum(unsigned char *data, unsigned n) {
+  unsigned sum = 0;
+  for (unsigned i = 0; i < n; ++i) {
+    sum = sum * 31 + data[i] + table[i % 8];
+    data[i] = 0;
+  }
+  return sum;
+}
+
+int scale(int x, int d) { return x / d; }
+
+void report(int x) { printf("%d\n", x); }
+
+int main() {
+  // Native calls see and update the memory of the state
+  unsigned char data[4] = {'k', 'l', 'e', 'e'};
+  unsigned sum = checksum(data, sizeof(data));
+  assert(sum == 3326467);
+  assert(data[0] == 0 && data[3] == 0);
+  assert(scale(sum, 2) == sum / 2);
+  report(scale(sum, 7));
+
+  // Errors are reported by interpreting the call again
+  if (klee_int("d") == 0)
+    return scale(1, 0);
+  return scale(100, 3);
+}
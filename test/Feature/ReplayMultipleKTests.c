@@ -0,0 +1,26 @@
+// RUN: %clang %s -emit-llvm %O0opt -c -o %t.bc
+// RUN: rm -rf %t.klee-out %t.klee-replay
+// RUN: %klee --output-dir=%t.klee-out %t.bc
+// RUN: %klee --output-dir=%t.klee-replay --replay-ktest-dir=%t.klee-out %t.bc 2>&1 | FileCheck %s
+
+// Every replay starts with freshly (lazily) initialized globals.
+// CHECK: KLEE: replaying: {{.*}} (1/2)
+// CHECK: KLEE: replaying: {{.*}} (2/2)
+// CHECK-NOT: ASSERTION FAIL
+
+#include "klee/klee.h"
+
+#include <assert.h>
+
+int table[4] = {1, 2, 3, 4};
+int counter = 10;
+
+int main() {
+  int i;
+  klee_make_symbolic(&i, sizeof(i), "i");
+  assert(counter == 10 && table[3] == 4);
+  ++counter;
+  if (i > 0)
+    table[0] = 5;
+  return table[0] + counter;
+}
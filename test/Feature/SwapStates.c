@@ -0,0 +1,44 @@
+// RUN: %clang %s -emit-llvm -g %O0opt -c -o %t.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out --max-memory=1 --swap-states --search=random-state %t.bc 2>&1 | FileCheck %s
+// RUN: ls %t.klee-out | not grep assert.err
+
+// Every state writes its own copy of the buffer, so together they go over
+// the memory cap and are swapped out and back in while they run. Each one
+// has to read back exactly what it wrote.
+// CHECK: KLEE: swapped out {{[0-9]+}} states
+// CHECK-NOT: ASSERTION FAIL
+// CHECK: KLEE: done: completed paths = 8
+// CHECK: KLEE: done: generated tests = 8
+
+#include "klee/klee.h"
+
+#include <stdlib.h>
+
+#define NUM_WORDS (64 * 1024)
+
+int main() {
+  unsigned *buffer = malloc(NUM_WORDS * sizeof(unsigned));
+  unsigned char x;
+  unsigned id, i;
+
+  klee_make_symbolic(&x, sizeof(x), "x");
+  switch (x & 7) {
+  case 0: id = 0; break;
+  case 1: id = 1; break;
+  case 2: id = 2; break;
+  case 3: id = 3; break;
+  case 4: id = 4; break;
+  case 5: id = 5; break;
+  case 6: id = 6; break;
+  default: id = 7; break;
+  }
+
+  for (i = 0; i < NUM_WORDS; ++i)
+    buffer[i] = id * 0x01010101u + i;
+  for (i = 0; i < NUM_WORDS; ++i)
+    klee_assert(buffer[i] == id * 0x01010101u + i);
+
+  free(buffer);
+  return 0;
+}
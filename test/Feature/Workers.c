@@ -0,0 +1,33 @@
+// RUN: %clang %s -emit-llvm -g %O0opt -c -o %t.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out --workers=3 %t.bc 2>&1 | FileCheck %s
+// RUN: test -f %t.klee-out/test000012.ktest
+// RUN: not test -f %t.klee-out/test000013.ktest
+
+// CHECK: KLEE: exploring in 3 workers
+// CHECK: KLEE: done: completed paths = 12
+// CHECK: KLEE: done: generated tests = 12
+
+#include "klee/klee.h"
+
+int main() {
+  int x, y;
+  klee_make_symbolic(&x, sizeof(x), "x");
+  klee_make_symbolic(&y, sizeof(y), "y");
+
+  // States are handed over between the workers, but every path is explored
+  // exactly once
+  int n = 0;
+  if (x & 1)
+    ++n;
+  if (x & 2)
+    ++n;
+  switch (y) {
+  case 1:
+    return n + 1;
+  case 2:
+    return n + 2;
+  default:
+    return n;
+  }
+}
@@ -0,0 +1,30 @@
+// RUN: %clang %s -emit-llvm -g %O0opt -c -o %t.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out --workers=2 --timer-interval=10ms --state-handover-interval=10ms %t.bc 2>&1 | FileCheck %s
+// RUN: test -f %t.klee-out/test000064.ktest
+// RUN: not test -f %t.klee-out/test000065.ktest
+
+// The second worker only gets to explore anything once the first one hands
+// states over, and every handed over state is explored from a new prefix.
+// CHECK: KLEE: exploring in 2 workers
+// CHECK-NOT: Timer interval
+// CHECK: KLEE: explored {{([2-9]|[1-9][0-9]+)}} path prefixes
+// CHECK: KLEE: done: completed paths = 64
+// CHECK: KLEE: done: generated tests = 64
+
+#include "klee/klee.h"
+
+int main() {
+  unsigned char x;
+  klee_make_symbolic(&x, sizeof(x), "x");
+
+  int n = 0;
+  for (int bit = 0; bit < 6; ++bit) {
+    if (x & (1 << bit))
+      ++n;
+    // Keep the states busy long enough for handovers to happen
+    for (volatile int i = 0; i < 2000; ++i)
+      ;
+  }
+  return n;
+}
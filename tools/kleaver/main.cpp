@@ -78,6 +78,12 @@ static llvm::cl::opt<BuilderKinds> BuilderKind(
                          KLEE_LLVM_CL_VAL_END),
     llvm::cl::cat(klee::ExprCat));
 
+static llvm::cl::opt<bool> HashConsExprs(
+    "hash-cons-exprs",
+    llvm::cl::desc("Share a single node between all structurally equal "
+                   "expressions built by the parser (default=false)"),
+    llvm::cl::init(false), llvm::cl::cat(klee::ExprCat));
+
 llvm::cl::opt<std::string> DirectoryToWriteQueryLogs(
     "query-log-dir",
     llvm::cl::desc(
@@ -425,6 +431,8 @@ int main(int argc, char **argv) {
     Builder = createSimplifyingExprBuilder(Builder);
     break;
   }
+  if (HashConsExprs)
+    Builder = createHashConsingExprBuilder(Builder);
 
   switch (ToolAction) {
   case PrintTokens:
@@ -51,11 +51,17 @@
 #include <dirent.h>
 #include <signal.h>
 #include <unistd.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/wait.h>
 
+#include <atomic>
 #include <cerrno>
+#include <cstring>
 #include <ctime>
+#include <deque>
 #include <fstream>
 #include <iomanip>
 #include <iterator>
@@ -283,6 +289,14 @@ namespace {
            cl::init(0),
            cl::cat(TerminationCat));
 
+  cl::opt<unsigned>
+  Workers("workers",
+          cl::desc("Explore in the given number of worker processes, which a "
+                   "coordinator process hands path prefixes to explore to.  "
+                   "Set to 0 to explore in this process (default=0)"),
+          cl::init(0),
+          cl::cat(StartCat));
+
   cl::opt<bool>
   Libcxx("libcxx",
            cl::desc("Link the llvm libc++ library into the bitcode (default=false)"),
@@ -297,6 +311,96 @@ class ExecutionState;
 
 /***/
 
+namespace {
+/// The messages exchanged between the coordinator of a --workers run and
+/// its workers. Each message is a type byte and a 32-bit payload size,
+/// followed by the payload.
+enum class Message : uint8_t {
+  Explore, ///< To a worker: explore from the path prefix in the payload
+  Share,   ///< To a worker: hand over one of the pending states
+  TestId,  ///< To a worker: the test case id it asked for
+  Stop,    ///< To a worker: halt
+  Idle,    ///< From a worker: done exploring, the payload is "1" if halted
+  Prefix,  ///< From a worker: the path of a state it handed over
+  NewTest, ///< From a worker: ask for a test case id
+};
+
+/// One end of the stream socket between the coordinator and a worker.
+class Channel {
+  int fd;
+
+  bool readAll(char *buffer, size_t size);
+  bool writeAll(const char *buffer, size_t size);
+
+public:
+  explicit Channel(int fd) : fd(fd) {}
+  ~Channel() { close(fd); }
+
+  Channel(const Channel &) = delete;
+  Channel &operator=(const Channel &) = delete;
+
+  int getFD() const { return fd; }
+
+  /// \return False if the other end is gone.
+  bool send(Message type, const std::string &payload = "");
+  bool receive(Message &type, std::string &payload);
+
+  /// Whether a message (or the end of the stream) is waiting.
+  bool isReadable() const;
+};
+}
+
+bool Channel::readAll(char *buffer, size_t size) {
+  while (size) {
+    ssize_t n = read(fd, buffer, size);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return false;
+    buffer += n;
+    size -= n;
+  }
+  return true;
+}
+
+bool Channel::writeAll(const char *buffer, size_t size) {
+  while (size) {
+    ssize_t n = write(fd, buffer, size);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return false;
+    buffer += n;
+    size -= n;
+  }
+  return true;
+}
+
+bool Channel::send(Message type, const std::string &payload) {
+  char header[5];
+  header[0] = static_cast<char>(type);
+  uint32_t size = payload.size();
+  memcpy(header + 1, &size, sizeof(size));
+  return writeAll(header, sizeof(header)) &&
+         writeAll(payload.data(), payload.size());
+}
+
+bool Channel::receive(Message &type, std::string &payload) {
+  char header[5];
+  if (!readAll(header, sizeof(header)))
+    return false;
+  type = static_cast<Message>(header[0]);
+  uint32_t size;
+  memcpy(&size, header + 1, sizeof(size));
+  payload.resize(size);
+  return readAll(&payload[0], size);
+}
+
+bool Channel::isReadable() const {
+  struct pollfd pfd = {fd, POLLIN, 0};
+  return poll(&pfd, 1, 0) > 0;
+}
+
 class KleeHandler : public InterpreterHandler {
 private:
   Interpreter *m_interpreter;
@@ -305,26 +409,54 @@ private:
 
   SmallString<128> m_outputDirectory;
 
-  unsigned m_numTotalTests;     // Number of tests received from the interpreter
-  unsigned m_numGeneratedTests; // Number of tests successfully generated
-  unsigned m_pathsExplored; // number of paths explored so far
+  // The counters are shared with the worker processes of a parallel
+  // exploration (see --exploration-jobs), so that test ids are unique and
+  // the totals cover all processes.
+  struct Counters {
+    // Number of tests received from the interpreter
+    std::atomic<unsigned> numTotalTests;
+    // Number of tests successfully generated
+    std::atomic<unsigned> numGeneratedTests;
+    // number of paths explored so far
+    std::atomic<unsigned> pathsExplored;
+  };
+  Counters *m_counters;
 
   // used for writing .ktest files
   int m_argc;
   char **m_argv;
 
+  // set in the worker processes of a --workers run
+  std::unique_ptr<Channel> m_coordinator;
+  unsigned m_statesWanted;
+  bool m_stopped;
+
+  void handleCoordinatorMessage(Message type, const std::string &payload);
+
 public:
   KleeHandler(int argc, char **argv);
   ~KleeHandler();
 
   llvm::raw_ostream &getInfoStream() const { return *m_infoFile; }
   /// Returns the number of test cases successfully generated so far
-  unsigned getNumTestCases() { return m_numGeneratedTests; }
-  unsigned getNumPathsExplored() { return m_pathsExplored; }
-  void incPathsExplored() { m_pathsExplored++; }
+  unsigned getNumTestCases() { return m_counters->numGeneratedTests; }
+  unsigned getNumPathsExplored() { return m_counters->pathsExplored; }
+  void incPathsExplored() { m_counters->pathsExplored++; }
+  unsigned newTestId();
 
   void setInterpreter(Interpreter *i);
 
+  /// Turn this process into the worker \a index of a --workers run, which
+  /// talks to the coordinator over the socket \a fd.
+  void becomeWorker(int fd, unsigned index);
+
+  /// Explore the path prefixes the coordinator sends until it stops this
+  /// worker.
+  void runWorker(llvm::Function *mainFn, int argc, char **argv, char **envp);
+
+  unsigned getNumStatesWanted() override;
+  void handOverState(const ExecutionState &state) override;
+
   void processTestCase(const ExecutionState  &state,
                        const char *errorMessage,
                        const char *errorSuffix);
@@ -346,8 +478,16 @@ public:
 
 KleeHandler::KleeHandler(int argc, char **argv)
     : m_interpreter(0), m_pathWriter(0), m_symPathWriter(0),
-      m_outputDirectory(), m_numTotalTests(0), m_numGeneratedTests(0),
-      m_pathsExplored(0), m_argc(argc), m_argv(argv) {
+      m_outputDirectory(), m_counters(0), m_argc(argc), m_argv(argv),
+      m_statesWanted(0), m_stopped(false) {
+  void *counters = mmap(nullptr, sizeof(Counters), PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (counters == MAP_FAILED)
+    klee_error("unable to allocate shared memory: %s", strerror(errno));
+  m_counters = new (counters) Counters();
+  m_counters->numTotalTests = 0;
+  m_counters->numGeneratedTests = 0;
+  m_counters->pathsExplored = 0;
 
   // create output directory (OutputDir or "klee-out-<i>")
   bool dir_given = OutputDir != "";
@@ -419,6 +559,8 @@ KleeHandler::~KleeHandler() {
   delete m_symPathWriter;
   fclose(klee_warning_file);
   fclose(klee_message_file);
+  m_counters->~Counters();
+  munmap(m_counters, sizeof(Counters));
 }
 
 void KleeHandler::setInterpreter(Interpreter *i) {
@@ -437,6 +579,107 @@ void KleeHandler::setInterpreter(Interpreter *i) {
   }
 }
 
+unsigned KleeHandler::newTestId() {
+  if (!m_coordinator)
+    return ++m_counters->numTotalTests;
+
+  // The coordinator numbers the tests of all workers
+  if (m_coordinator->send(Message::NewTest)) {
+    Message type;
+    std::string payload;
+    while (m_coordinator->receive(type, payload)) {
+      if (type == Message::TestId)
+        return std::stoul(payload);
+      handleCoordinatorMessage(type, payload);
+    }
+  }
+  klee_error("lost the connection to the coordinator");
+}
+
+void KleeHandler::becomeWorker(int fd, unsigned index) {
+  m_coordinator.reset(new Channel(fd));
+  m_interpreter->disableStatsOutput();
+
+  // Handing states over needs their paths, and the path streams of the
+  // original process must not be shared
+  std::string suffix = "-" + std::to_string(index) + ".ts";
+  delete m_pathWriter;
+  m_pathWriter = new TreeStreamWriter(getOutputFilename("paths" + suffix));
+  assert(m_pathWriter->good());
+  m_interpreter->setPathWriter(m_pathWriter);
+
+  if (m_symPathWriter) {
+    delete m_symPathWriter;
+    m_symPathWriter =
+        new TreeStreamWriter(getOutputFilename("symPaths" + suffix));
+    assert(m_symPathWriter->good());
+    m_interpreter->setSymbolicPathWriter(m_symPathWriter);
+  }
+}
+
+void KleeHandler::handleCoordinatorMessage(Message type,
+                                           const std::string &payload) {
+  switch (type) {
+  case Message::Share:
+    ++m_statesWanted;
+    break;
+  case Message::Stop:
+    m_stopped = true;
+    m_interpreter->setHaltExecution(true);
+    break;
+  default:
+    klee_warning("unexpected message from the coordinator");
+  }
+}
+
+void KleeHandler::runWorker(llvm::Function *mainFn, int argc, char **argv,
+                            char **envp) {
+  Message type;
+  std::string payload;
+  while (!m_stopped && m_coordinator->receive(type, payload)) {
+    if (type != Message::Explore) {
+      handleCoordinatorMessage(type, payload);
+      continue;
+    }
+
+    std::vector<bool> prefix;
+    for (char decision : payload)
+      prefix.push_back(decision == '1');
+    m_statesWanted = 0;
+    m_interpreter->setPathPrefix(&prefix);
+    m_interpreter->runFunctionAsMain(mainFn, argc, argv, envp);
+    m_interpreter->setPathPrefix(0);
+    theStatisticManager->flushStatistics();
+
+    if (!m_coordinator->send(Message::Idle,
+                             m_interpreter->getHaltExecution() ? "1" : "0"))
+      break;
+  }
+}
+
+unsigned KleeHandler::getNumStatesWanted() {
+  if (!m_coordinator)
+    return 0;
+
+  while (!m_stopped && m_coordinator->isReadable()) {
+    Message type;
+    std::string payload;
+    if (!m_coordinator->receive(type, payload))
+      handleCoordinatorMessage(Message::Stop, "");
+    else
+      handleCoordinatorMessage(type, payload);
+  }
+  return m_statesWanted;
+}
+
+void KleeHandler::handOverState(const ExecutionState &state) {
+  std::vector<unsigned char> path;
+  m_pathWriter->readStream(m_interpreter->getPathStreamID(state), path);
+  m_coordinator->send(Message::Prefix, std::string(path.begin(), path.end()));
+  if (m_statesWanted)
+    --m_statesWanted;
+}
+
 std::string KleeHandler::getOutputFilename(const std::string &filename) {
   SmallString<128> path = m_outputDirectory;
   sys::path::append(path,filename);
@@ -483,7 +726,9 @@ void KleeHandler::processTestCase(const ExecutionState &state,
 
     const auto start_time = time::getWallTime();
 
-    unsigned id = ++m_numTotalTests;
+    unsigned id = newTestId();
+    // Taken from the increment, as other processes may generate tests too
+    unsigned numGeneratedTests = 0;
 
     if (success) {
       KTest b;
@@ -506,7 +751,7 @@ void KleeHandler::processTestCase(const ExecutionState &state,
       if (!kTest_toFile(&b, getOutputFilename(getTestFilename("ktest", id)).c_str())) {
         klee_warning("unable to write output test case, losing it");
       } else {
-        ++m_numGeneratedTests;
+        numGeneratedTests = ++m_counters->numGeneratedTests;
       }
 
       for (unsigned i=0; i<b.numObjects; i++)
@@ -583,7 +828,7 @@ void KleeHandler::processTestCase(const ExecutionState &state,
       }
     }
 
-    if (m_numGeneratedTests == MaxTests)
+    if (MaxTests && numGeneratedTests >= MaxTests)
       m_interpreter->setHaltExecution(true);
 
     if (WriteTestInfo) {
@@ -1134,6 +1379,228 @@ linkWithUclibc(StringRef libDir,
 }
 #endif
 
+//===----------------------------------------------------------------------===//
+// Coordinator of a --workers run
+//
+
+namespace {
+/// Hands the path prefixes to explore out to the workers. It starts with
+/// the empty prefix, and whenever workers are idle while there is nothing
+/// left to hand out, it asks the busy ones to hand over some of their
+/// pending states, which come back as the prefixes of their paths.
+///
+/// Test cases are numbered by the coordinator as well. The statistics and
+/// the test and path totals are shared through memory, so for now the
+/// workers run on the same machine.
+class Coordinator {
+  struct Worker {
+    pid_t pid;
+    std::unique_ptr<Channel> channel;
+    /// Whether the worker is exploring a prefix.
+    bool busy;
+    /// Whether the worker has been asked to hand over a state.
+    bool asked;
+  };
+
+  KleeHandler &handler;
+  std::vector<Worker> workers;
+  std::deque<std::string> prefixes;
+  /// Number of prefixes handed out to the workers.
+  unsigned dispatched;
+  bool stopping;
+
+  void stop();
+  void dispatch();
+  void handleMessage(Worker &worker, Message type, const std::string &payload);
+
+public:
+  explicit Coordinator(KleeHandler &handler)
+      : handler(handler), prefixes(1), dispatched(0), stopping(false) {}
+
+  void addWorker(pid_t pid, int fd) {
+    workers.push_back({pid, std::unique_ptr<Channel>(new Channel(fd)), false,
+                       false});
+  }
+
+  /// Coordinate the workers until all of them are done.
+  void run();
+
+  unsigned getNumDispatched() const { return dispatched; }
+};
+}
+
+void Coordinator::stop() {
+  if (stopping)
+    return;
+  stopping = true;
+  prefixes.clear();
+  for (auto &worker : workers)
+    if (worker.channel)
+      worker.channel->send(Message::Stop);
+}
+
+void Coordinator::dispatch() {
+  unsigned idle = 0, busy = 0, asked = 0;
+  for (auto &worker : workers) {
+    if (!worker.channel)
+      continue;
+    if (!worker.busy && !prefixes.empty()) {
+      worker.busy = worker.channel->send(Message::Explore, prefixes.front());
+      dispatched += worker.busy;
+      prefixes.pop_front();
+    }
+    if (worker.busy) {
+      ++busy;
+      asked += worker.asked;
+    } else {
+      ++idle;
+    }
+  }
+
+  // Nothing left to explore anywhere
+  if (!busy) {
+    stop();
+    return;
+  }
+
+  // Ask for as many states as there are idle workers
+  for (auto &worker : workers) {
+    if (asked >= idle)
+      break;
+    if (worker.channel && worker.busy && !worker.asked) {
+      worker.asked = worker.channel->send(Message::Share);
+      asked += worker.asked;
+    }
+  }
+}
+
+void Coordinator::handleMessage(Worker &worker, Message type,
+                                const std::string &payload) {
+  switch (type) {
+  case Message::NewTest:
+    worker.channel->send(Message::TestId, std::to_string(handler.newTestId()));
+    break;
+  case Message::Prefix:
+    worker.asked = false;
+    if (!stopping)
+      prefixes.push_back(payload);
+    break;
+  case Message::Idle:
+    worker.busy = worker.asked = false;
+    if (payload == "1")
+      stop();
+    break;
+  default:
+    klee_warning("unexpected message from worker %d", (int)worker.pid);
+  }
+}
+
+void Coordinator::run() {
+  const time::Span maxTime(MaxTime);
+  const auto deadline = time::getWallTime() + maxTime;
+
+  for (;;) {
+    if ((maxTime && time::getWallTime() > deadline) || interrupted)
+      stop();
+    if (!stopping)
+      dispatch();
+
+    std::vector<struct pollfd> pfds;
+    std::vector<Worker *> polled;
+    for (auto &worker : workers) {
+      if (!worker.channel)
+        continue;
+      pfds.push_back({worker.channel->getFD(), POLLIN, 0});
+      polled.push_back(&worker);
+    }
+    if (pfds.empty())
+      break;
+
+    if (poll(pfds.data(), pfds.size(), 100) < 0 && errno != EINTR)
+      klee_error("poll failed: %s", strerror(errno));
+
+    for (unsigned i = 0; i < pfds.size(); ++i) {
+      if (!pfds[i].revents)
+        continue;
+      Worker &worker = *polled[i];
+      Message type;
+      std::string payload;
+      if (worker.channel->receive(type, payload)) {
+        handleMessage(worker, type, payload);
+        continue;
+      }
+      // The worker is gone. Whatever it was exploring is lost.
+      if (!stopping && worker.busy)
+        klee_warning("lost worker %d", (int)worker.pid);
+      worker.channel = nullptr;
+      worker.busy = false;
+    }
+  }
+
+  for (auto &worker : workers) {
+    int status = 0;
+    pid_t res;
+    do {
+      res = waitpid(worker.pid, &status, 0);
+    } while (res < 0 && errno == EINTR);
+    if (res < 0) {
+      klee_warning("waitpid() for worker %d failed: %s", (int)worker.pid,
+                   strerror(errno));
+      continue;
+    }
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+      klee_warning("worker %d failed", (int)worker.pid);
+  }
+}
+
+/// Explore \a mainFn in --workers worker processes. Only the coordinator
+/// returns.
+static void runWorkers(KleeHandler *handler, Interpreter *interpreter,
+                       Function *mainFn, int argc, char **argv, char **envp) {
+  if (!theStatisticManager->shareBetweenProcesses())
+    klee_warning("unable to share the statistics with the workers");
+
+  Coordinator coordinator(*handler);
+  std::vector<int> coordinatorFDs;
+  for (unsigned i = 0; i < Workers; ++i) {
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0)
+      klee_error("unable to create worker socket: %s", strerror(errno));
+
+    handler->getInfoStream().flush();
+    llvm::outs().flush();
+    llvm::errs().flush();
+    fflush(nullptr);
+
+    pid_t pid = fork();
+    if (pid < 0)
+      klee_error("unable to fork worker: %s", strerror(errno));
+    if (pid == 0) {
+      for (int fd : coordinatorFDs)
+        close(fd);
+      close(fds[0]);
+      handler->becomeWorker(fds[1], i);
+      handler->runWorker(mainFn, argc, argv, envp);
+
+      handler->getInfoStream().flush();
+      llvm::outs().flush();
+      llvm::errs().flush();
+      fflush(nullptr);
+      _exit(0);
+    }
+    close(fds[1]);
+    coordinatorFDs.push_back(fds[0]);
+    coordinator.addWorker(pid, fds[0]);
+  }
+
+  klee_message("exploring in %u workers", (unsigned)Workers);
+  coordinator.run();
+  klee_message("explored %u path prefixes", coordinator.getNumDispatched());
+
+  // The workers left writing the statistics files to this process
+  interpreter->prepareForEarlyExit();
+}
+
 int main(int argc, char **argv, char **envp) {
   atexit(llvm_shutdown);  // Call llvm_shutdown() on exit.
 
@@ -1346,6 +1813,11 @@ int main(int argc, char **argv, char **envp) {
 
   std::vector<bool> replayPath;
 
+  if (Workers && (ReplayPathFile != "" || !ReplayKTestDir.empty() ||
+                  !ReplayKTestFile.empty() || !SeedOutFile.empty() ||
+                  !SeedOutDir.empty()))
+    klee_error("--workers cannot be used with replaying or seeding");
+
   if (ReplayPathFile != "") {
     KleeHandler::loadPathFile(ReplayPathFile, replayPath);
   }
@@ -1477,7 +1949,10 @@ int main(int argc, char **argv, char **envp) {
                    sys::StrError(errno).c_str());
       }
     }
-    interpreter->runFunctionAsMain(mainFn, pArgc, pArgv, pEnvp);
+    if (Workers)
+      runWorkers(handler, interpreter, mainFn, pArgc, pArgv, pEnvp);
+    else
+      interpreter->runFunctionAsMain(mainFn, pArgc, pArgv, pEnvp);
 
     while (!seeds.empty()) {
       kTest_free(seeds.back());
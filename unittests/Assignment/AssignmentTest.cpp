@@ -2,6 +2,7 @@
 
 #include "klee/Expr/ArrayCache.h"
 #include "klee/Expr/Assignment.h"
+#include "klee/Expr/CompiledExpr.h"
 
 #include <iostream>
 #include <vector>
@@ -35,3 +36,142 @@ TEST(AssignmentTest, FoldNotOptimized)
   ASSERT_TRUE(asConstant != NULL);
   ASSERT_EQ(asConstant->getZExtValue(), (unsigned) 128);
 }
+
+TEST(AssignmentTest, BatchEvaluation)
+{
+  ArrayCache ac;
+  const Array* array = ac.CreateArray("batch_array", /*size=*/ 2);
+  std::vector<const Array*> objects(1, array);
+
+  // Three assignments: x = {1, 2}, x = {3, 0}, and no binding at all.
+  std::vector< std::vector<unsigned char> > values1(1, {1, 2});
+  std::vector< std::vector<unsigned char> > values2(1, {3, 0});
+  Assignment a1(objects, values1), a2(objects, values2), a3;
+  AssignmentBatchEvaluator evaluator({&a1, &a2, &a3});
+
+  // x[0] + x[1] and x[0] / x[1]
+  ref<Expr> x0 = ReadExpr::create(UpdateList(array, 0),
+                                  ConstantExpr::create(0, Expr::Int32));
+  ref<Expr> x1 = ReadExpr::create(UpdateList(array, 0),
+                                  ConstantExpr::create(1, Expr::Int32));
+  ref<Expr> sum = AddExpr::create(x0, x1);
+  ref<Expr> quotient = UDivExpr::create(x0, x1);
+
+  const AssignmentBatchEvaluator::values_ty &sums = evaluator.evaluate(sum);
+  ASSERT_EQ(sums.size(), 3u);
+  EXPECT_EQ(sums[0]->getZExtValue(), 3u);
+  EXPECT_EQ(sums[1]->getZExtValue(), 3u);
+  EXPECT_EQ(sums[2]->getZExtValue(), 0u);
+
+  // Division by zero does not evaluate to a constant.
+  const AssignmentBatchEvaluator::values_ty &quotients =
+      evaluator.evaluate(quotient);
+  EXPECT_EQ(quotients[0]->getZExtValue(), 0u);
+  EXPECT_TRUE(quotients[1].isNull());
+  EXPECT_TRUE(quotients[2].isNull());
+
+  // The results agree with evaluating every assignment on its own.
+  ref<Expr> cond = UltExpr::create(x1, sum);
+  const AssignmentBatchEvaluator::values_ty &conds = evaluator.evaluate(cond);
+  EXPECT_EQ(ref<Expr>(conds[0]), a1.evaluate(cond));
+  EXPECT_EQ(ref<Expr>(conds[1]), a2.evaluate(cond));
+  EXPECT_EQ(ref<Expr>(conds[2]), a3.evaluate(cond));
+}
+
+TEST(AssignmentTest, CompiledExpr)
+{
+  ArrayCache ac;
+  const Array* array = ac.CreateArray("compiled_array", /*size=*/ 4);
+  std::vector<const Array*> objects(1, array);
+
+  UpdateList ul(array, 0);
+  ref<Expr> idx[4];
+  for (unsigned i = 0; i < 4; ++i)
+    idx[i] = ConstantExpr::create(i, Expr::Int32);
+  ref<Expr> b0 = ReadExpr::create(ul, idx[0]);
+  ref<Expr> b1 = ReadExpr::create(ul, idx[1]);
+  ref<Expr> w16 = ConcatExpr::create(b1, b0);
+  ref<Expr> w32 = SExtExpr::create(w16, Expr::Int32);
+  ref<Expr> w64 = ZExtExpr::create(ConcatExpr::create(
+      ReadExpr::create(ul, idx[3]), ReadExpr::create(ul, idx[2])), Expr::Int64);
+
+  // x[b0 & 3] after storing b1 at index 2
+  UpdateList updated(array, 0);
+  updated.extend(idx[2], b1);
+  ref<Expr> symbolicRead = ReadExpr::create(
+      updated, ZExtExpr::create(AndExpr::create(b0, ConstantExpr::create(
+                                    3, Expr::Int8)), Expr::Int32));
+
+  std::vector<ref<Expr> > exprs = {
+    UltExpr::create(b0, b1),
+    SltExpr::create(b0, b1),
+    EqExpr::create(symbolicRead, b1),
+    NeExpr::alloc(w16, ConstantExpr::create(0x1234, Expr::Int16)),
+    SgeExpr::alloc(w32, ConstantExpr::create(0xffffff9c, Expr::Int32)),
+    EqExpr::create(UDivExpr::create(w16, ZExtExpr::create(b0, Expr::Int16)),
+                   ConstantExpr::create(1, Expr::Int16)),
+    SleExpr::create(SRemExpr::create(w32, SExtExpr::create(b1, Expr::Int32)),
+                    ConstantExpr::create(0, Expr::Int32)),
+    EqExpr::create(SDivExpr::create(b0, b1), ConstantExpr::create(0x80, Expr::Int8)),
+    UgtExpr::alloc(ShlExpr::create(w64, ZExtExpr::create(b0, Expr::Int64)),
+                   LShrExpr::create(w64, ZExtExpr::create(b1, Expr::Int64))),
+    SltExpr::create(AShrExpr::create(w32, ZExtExpr::create(b0, Expr::Int32)),
+                    ConstantExpr::create(0, Expr::Int32)),
+    EqExpr::create(ExtractExpr::create(MulExpr::create(w32, w32), 5, 8),
+                   XorExpr::create(b0, NotExpr::create(b1))),
+    EqExpr::create(SelectExpr::create(UleExpr::create(b0, b1),
+                                      SubExpr::create(b1, b0),
+                                      AddExpr::create(b0, b1)),
+                   OrExpr::create(b0, ConstantExpr::create(1, Expr::Int8))),
+  };
+
+  std::vector<CompiledExpr *> compiled;
+  std::vector<std::unique_ptr<CompiledExpr> > owner;
+  for (const ref<Expr> &e : exprs) {
+    owner.push_back(CompiledExpr::compile(std::vector<ref<Expr> >(1, e)));
+    ASSERT_TRUE(owner.back() != nullptr);
+  }
+  std::unique_ptr<CompiledExpr> conjunction = CompiledExpr::compile(exprs);
+  ASSERT_TRUE(conjunction != nullptr);
+
+  // Edge cases first, then pseudo-random values.
+  std::vector<std::unique_ptr<Assignment> > assignments;
+  std::vector< std::vector<unsigned char> > edges = {
+    {0, 0, 0, 0}, {0x80, 0xff, 0, 0x80}, {0xff, 0x7f, 0xff, 0xff},
+    {1, 1, 2, 3}, {0x34, 0x12, 0x80, 0}, {63, 64, 5, 7}};
+  unsigned seed = 12345;
+  for (unsigned i = 0; i < 200; ++i) {
+    std::vector< std::vector<unsigned char> > values(1);
+    if (i < edges.size()) {
+      values[0] = edges[i];
+    } else {
+      for (unsigned j = 0; j < 4; ++j) {
+        seed = seed * 1103515245 + 12345;
+        values[0].push_back((seed >> 16) & 0xff);
+      }
+    }
+    assignments.emplace_back(new Assignment(objects, values));
+  }
+
+  std::vector<const Assignment *> batch;
+  for (const auto &a : assignments)
+    batch.push_back(a.get());
+
+  for (unsigned k = 0; k < exprs.size(); ++k) {
+    std::vector<bool> results;
+    owner[k]->satisfiedBy(batch, results);
+    ASSERT_EQ(results.size(), batch.size());
+    for (unsigned i = 0; i < batch.size(); ++i) {
+      bool expected = assignments[i]->satisfies(&exprs[k], &exprs[k] + 1);
+      EXPECT_EQ(expected, results[i]) << "expression " << k
+                                      << ", assignment " << i;
+      EXPECT_EQ(expected, owner[k]->satisfiedBy(*assignments[i]));
+    }
+  }
+
+  std::vector<bool> results;
+  conjunction->satisfiedBy(batch, results);
+  for (unsigned i = 0; i < batch.size(); ++i)
+    EXPECT_EQ(assignments[i]->satisfies(exprs.begin(), exprs.end()),
+              results[i]);
+}
@@ -74,4 +74,31 @@ TEST(ArrayExprTest, HashCollisions) {
   EXPECT_EQ(a->evaluate(oUpdatedRead), getConstant(42, Expr::Int8));
   EXPECT_EQ(a->evaluate(oFirstRead), getConstant(5, Expr::Int8));
 }
+
+TEST(ArrayExprTest, ConstantArraysInternedByContents) {
+  ArrayCache cache;
+  std::vector<ref<ConstantExpr>> table, other;
+  for (unsigned i = 0; i < 16; ++i) {
+    table.push_back(ConstantExpr::create(i, Expr::Int8));
+    other.push_back(ConstantExpr::create(i == 7 ? 0 : i, Expr::Int8));
+  }
+  auto create = [&cache](const std::string &name,
+                         const std::vector<ref<ConstantExpr>> &values) {
+    return cache.CreateArray(name, values.size(), values.data(),
+                             values.data() + values.size(), Expr::Int32,
+                             Expr::Int8);
+  };
+
+  // The same contents under another name are the first array
+  const Array *first = create("table0", table);
+  const Array *second = create("table1", table);
+  EXPECT_EQ(first, second);
+  EXPECT_EQ(second->name, "table0");
+
+  // Different contents, or a symbolic array of the same name, are not
+  EXPECT_NE(create("table2", other), first);
+  const Array *symbolic = cache.CreateArray("table0", 16);
+  EXPECT_NE(symbolic, first);
+  EXPECT_TRUE(symbolic->isSymbolicArray());
+}
 }
@@ -8,10 +8,13 @@
 //===----------------------------------------------------------------------===//
 
 #include <iostream>
+#include <thread>
+#include <vector>
 #include "gtest/gtest.h"
 
 #include "klee/Expr/ArrayCache.h"
 #include "klee/Expr/Expr.h"
+#include "klee/Expr/ExprBuilder.h"
 
 using namespace klee;
 
@@ -29,6 +32,54 @@ TEST(ExprTest, BasicConstruction) {
                             ConstantExpr::alloc(10, 32)));
 }
 
+TEST(ExprTest, SharedSmallConstants) {
+  // Small values of the common widths are shared
+  EXPECT_EQ(ConstantExpr::alloc(7, Expr::Int32).get(),
+            ConstantExpr::create(7, Expr::Int32).get());
+  EXPECT_EQ(ConstantExpr::alloc(1, Expr::Bool).get(),
+            EqExpr::create(ConstantExpr::alloc(3, Expr::Int8),
+                           ConstantExpr::alloc(3, Expr::Int8)).get());
+  EXPECT_EQ(ConstantExpr::alloc(0, Expr::Int64).get(),
+            SubExpr::create(ConstantExpr::alloc(255, Expr::Int64),
+                            ConstantExpr::alloc(255, Expr::Int64)).get());
+
+  // Other constants are allocated separately but compare equal
+  ref<ConstantExpr> large1 = ConstantExpr::alloc(256, Expr::Int32);
+  ref<ConstantExpr> large2 = ConstantExpr::alloc(256, Expr::Int32);
+  EXPECT_NE(large1.get(), large2.get());
+  EXPECT_EQ(large1, large2);
+  EXPECT_NE(ConstantExpr::alloc(7, Expr::Int32).get(),
+            ConstantExpr::alloc(7, 24).get());
+  EXPECT_NE(ConstantExpr::alloc(7, Expr::Int32).get(),
+            ConstantExpr::alloc(7, Expr::Int64).get());
+  EXPECT_EQ(24u, ConstantExpr::alloc(7, 24)->getWidth());
+  EXPECT_EQ(7u, ConstantExpr::alloc(7, Expr::Int64)->getZExtValue());
+}
+
+TEST(ExprTest, SharedSmallConstantsThreads) {
+  ref<ConstantExpr> one = ConstantExpr::alloc(1, Expr::Int8);
+  unsigned count = one->_refCount.getCount();
+
+  // Shared constants are referenced from many threads at once without
+  // their counts being written.
+  std::vector<std::thread> threads;
+  for (unsigned t = 0; t < 4; ++t)
+    threads.emplace_back([]() {
+      for (unsigned i = 0; i < 10000; ++i) {
+        ref<Expr> sum = AddExpr::create(ConstantExpr::alloc(1, Expr::Int8),
+                                        ConstantExpr::alloc(i % 2, Expr::Int8));
+        ref<Expr> eq = EqExpr::create(sum, ConstantExpr::alloc(1, Expr::Int8));
+        (void)eq;
+      }
+    });
+  for (auto &thread : threads)
+    thread.join();
+
+  EXPECT_EQ(count, one->_refCount.getCount());
+  EXPECT_EQ(one.get(), ConstantExpr::alloc(1, Expr::Int8).get());
+  EXPECT_EQ(1u, one->getZExtValue());
+}
+
 TEST(ExprTest, ConcatExtract) {
   ArrayCache ac;
   const Array *array = ac.CreateArray("arr0", 256);
@@ -264,4 +315,103 @@ TEST(ExprTest, ReadExprFoldingSymbolicIndexUpdate) {
     EXPECT_EQ(Expr::Read, read.get()->getKind());
   }
 }
+
+TEST(ExprTest, HashConsingBuilder) {
+  ArrayCache ac;
+  const Array *array = ac.CreateArray("arr", 4);
+  ExprBuilder *builder =
+      createHashConsingExprBuilder(createDefaultExprBuilder());
+
+  // Reads built outside of the builder are canonicalized on first use.
+  ref<Expr> a = ReadExpr::createTempRead(array, Expr::Int32);
+  ref<Expr> b = ReadExpr::createTempRead(array, Expr::Int32);
+  ASSERT_NE(a.get(), b.get());
+
+  ref<Expr> one = builder->Constant(1, Expr::Int32);
+  ref<Expr> sum1 = builder->Add(a, one);
+  ref<Expr> sum2 = builder->Add(b, builder->Constant(1, Expr::Int32));
+  EXPECT_EQ(sum1.get(), sum2.get());
+  EXPECT_EQ(sum1->getKid(0).get(), sum2->getKid(0).get());
+
+  ref<Expr> eq1 = builder->Eq(sum1, builder->Constant(7, Expr::Int32));
+  ref<Expr> eq2 = builder->Eq(sum2, builder->Constant(7, Expr::Int32));
+  EXPECT_EQ(eq1.get(), eq2.get());
+  EXPECT_EQ(eq1->getKid(1).get(), eq2->getKid(1).get());
+
+  // Structurally different expressions stay distinct.
+  ref<Expr> sum3 = builder->Add(a, builder->Constant(2, Expr::Int32));
+  EXPECT_NE(sum1.get(), sum3.get());
+  EXPECT_EQ(sum1->getKid(0).get(), sum3->getKid(0).get());
+
+  delete builder;
+}
+
+TEST(ExprTest, ConstantOperationsMatchBuilder) {
+  // The executor evaluates instructions with constant operands through the
+  // ConstantExpr operations directly, so they have to agree with the
+  // expression builder.
+  typedef ref<ConstantExpr> (ConstantExpr::*ConstantOp)(
+      const ref<ConstantExpr> &);
+  typedef ref<Expr> (*CreateOp)(const ref<Expr> &, const ref<Expr> &);
+  struct Operation {
+    const char *name;
+    ConstantOp constantOp;
+    CreateOp create;
+    bool isDivision;
+  };
+  const Operation operations[] = {
+      {"Add", &ConstantExpr::Add, &AddExpr::create, false},
+      {"Sub", &ConstantExpr::Sub, &SubExpr::create, false},
+      {"Mul", &ConstantExpr::Mul, &MulExpr::create, false},
+      {"UDiv", &ConstantExpr::UDiv, &UDivExpr::create, true},
+      {"SDiv", &ConstantExpr::SDiv, &SDivExpr::create, true},
+      {"URem", &ConstantExpr::URem, &URemExpr::create, true},
+      {"SRem", &ConstantExpr::SRem, &SRemExpr::create, true},
+      {"And", &ConstantExpr::And, &AndExpr::create, false},
+      {"Or", &ConstantExpr::Or, &OrExpr::create, false},
+      {"Xor", &ConstantExpr::Xor, &XorExpr::create, false},
+      {"Shl", &ConstantExpr::Shl, &ShlExpr::create, false},
+      {"LShr", &ConstantExpr::LShr, &LShrExpr::create, false},
+      {"AShr", &ConstantExpr::AShr, &AShrExpr::create, false},
+      {"Eq", &ConstantExpr::Eq, &EqExpr::create, false},
+      {"Ne", &ConstantExpr::Ne, &NeExpr::create, false},
+      {"Ugt", &ConstantExpr::Ugt, &UgtExpr::create, false},
+      {"Uge", &ConstantExpr::Uge, &UgeExpr::create, false},
+      {"Ult", &ConstantExpr::Ult, &UltExpr::create, false},
+      {"Ule", &ConstantExpr::Ule, &UleExpr::create, false},
+      {"Sgt", &ConstantExpr::Sgt, &SgtExpr::create, false},
+      {"Sge", &ConstantExpr::Sge, &SgeExpr::create, false},
+      {"Slt", &ConstantExpr::Slt, &SltExpr::create, false},
+      {"Sle", &ConstantExpr::Sle, &SleExpr::create, false},
+  };
+  const int values[] = {0, 1, 2, 3, 7, 8, 31, 100, -1, -2, -7, -128, 127};
+  const Expr::Width widths[] = {Expr::Bool, Expr::Int8, Expr::Int16,
+                                Expr::Int32, Expr::Int64};
+
+  for (Expr::Width width : widths) {
+    std::vector<ref<ConstantExpr> > constants;
+    for (int value : values)
+      constants.push_back(cast<ConstantExpr>(getConstant(value, width)));
+    // The extremes of the width, which getConstant cannot express
+    constants.push_back(
+        ConstantExpr::alloc(llvm::APInt::getSignedMinValue(width)));
+    constants.push_back(
+        ConstantExpr::alloc(llvm::APInt::getSignedMaxValue(width)));
+
+    for (const Operation &op : operations) {
+      for (const ref<ConstantExpr> &l : constants) {
+        for (const ref<ConstantExpr> &r : constants) {
+          if (op.isDivision && r->isZero())
+            continue;
+          ref<Expr> expected = op.create(l, r);
+          ref<ConstantExpr> result = (l.get()->*op.constantOp)(r);
+          ASSERT_TRUE(isa<ConstantExpr>(expected));
+          EXPECT_EQ(expected, ref<Expr>(result))
+              << op.name << " of " << l->getZExtValue() << " and "
+              << r->getZExtValue() << " at width " << width;
+        }
+      }
+    }
+  }
+}
 }
@@ -0,0 +1,60 @@
+//===-- AddressSpaceTest.cpp ------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+
+#include "Core/AddressSpace.h"
+#include "Core/CoreStats.h"
+#include "Core/Memory.h"
+#include "Core/MemoryManager.h"
+
+#include "klee/Expr/ArrayCache.h"
+#include "klee/Statistics/Statistics.h"
+
+using namespace klee;
+
+namespace {
+
+TEST(AddressSpaceTest, CopiesAreChargedToTheFork) {
+  const unsigned objectSize = 64;
+  const unsigned forkIndex = 1, otherIndex = 2;
+  ArrayCache arrayCache;
+  MemoryManager memory(&arrayCache);
+  StatisticManager &sm = *theStatisticManager;
+  sm.useIndexedStats(3);
+  sm.setIndex(otherIndex);
+
+  MemoryObject *mo = memory.allocate(objectSize, false, true, nullptr, 8);
+  ObjectState *os = new ObjectState(mo);
+  AddressSpace parent;
+  parent.bindObject(mo, os);
+
+  // The states share the object after the fork, so both copy it on write
+  parent.forkIndex = forkIndex;
+  AddressSpace child(parent);
+  EXPECT_EQ(child.forkIndex, forkIndex);
+
+  uint64_t total = stats::forkCopyBytes;
+  ObjectState *childCopy = child.getWriteable(mo, child.findObject(mo));
+  EXPECT_NE(childCopy, os);
+  EXPECT_EQ(sm.getIndexedValue(stats::forkCopyBytes, forkIndex), objectSize);
+  EXPECT_EQ(sm.getIndexedValue(stats::forkCopyBytes, otherIndex), 0u);
+  EXPECT_EQ(stats::forkCopyBytes - total, objectSize);
+  EXPECT_EQ(sm.getIndex(), otherIndex);
+
+  // Writing to an owned object copies nothing
+  EXPECT_EQ(child.getWriteable(mo, childCopy), childCopy);
+  EXPECT_EQ(sm.getIndexedValue(stats::forkCopyBytes, forkIndex), objectSize);
+
+  parent.getWriteable(mo, parent.findObject(mo));
+  EXPECT_EQ(sm.getIndexedValue(stats::forkCopyBytes, forkIndex),
+            2 * objectSize);
+  EXPECT_EQ(stats::forkCopyBytes - total, 2 * objectSize);
+}
+}
@@ -0,0 +1,91 @@
+//===-- MemoryArenaTest.cpp -------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+
+#include "Core/MemoryArena.h"
+
+#include <cstdint>
+#include <vector>
+
+using namespace klee;
+
+namespace {
+
+TEST(MemoryArenaTest, SizeClasses) {
+  MemoryArena arena;
+  void *a = arena.allocate(1);
+  void *b = arena.allocate(MemoryArena::Granularity);
+  void *c = arena.allocate(MemoryArena::Granularity + 1);
+  // Sizes are rounded up to the granularity, and slots are aligned to it
+  EXPECT_EQ(arena.getBytesAllocated(), 4 * MemoryArena::Granularity);
+  for (void *p : {a, b, c})
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(p) % MemoryArena::Granularity, 0u);
+  EXPECT_NE(a, b);
+  // Two size classes, two chunks
+  EXPECT_EQ(arena.getBytesReserved(), 2 * MemoryArena::ChunkSize);
+
+  // Large allocations go to the heap, but are accounted for
+  void *large = arena.allocate(MemoryArena::MaxSlotSize + 1);
+  EXPECT_EQ(arena.getBytesAllocated(),
+            4 * MemoryArena::Granularity + MemoryArena::MaxSlotSize + 1);
+  EXPECT_EQ(arena.getBytesReserved(),
+            2 * MemoryArena::ChunkSize + MemoryArena::MaxSlotSize + 1);
+  arena.deallocate(large, MemoryArena::MaxSlotSize + 1);
+
+  arena.deallocate(a, 1);
+  arena.deallocate(b, MemoryArena::Granularity);
+  arena.deallocate(c, MemoryArena::Granularity + 1);
+  EXPECT_EQ(arena.getBytesAllocated(), 0u);
+  // One empty chunk is kept as a spare
+  EXPECT_EQ(arena.getBytesReserved(), MemoryArena::ChunkSize);
+}
+
+TEST(MemoryArenaTest, SlabReuse) {
+  MemoryArena arena;
+  void *keep = arena.allocate(48);
+  void *a = arena.allocate(48);
+  arena.deallocate(a, 48);
+  // Freed slots are reused first
+  EXPECT_EQ(arena.allocate(48), a);
+  arena.deallocate(a, 48);
+  arena.deallocate(keep, 48);
+
+  // The spare chunk is reused by another size class
+  size_t reserved = arena.getBytesReserved();
+  void *b = arena.allocate(200);
+  EXPECT_EQ(arena.getBytesReserved(), reserved);
+  arena.deallocate(b, 200);
+}
+
+TEST(MemoryArenaTest, ChunkRelease) {
+  MemoryArena arena;
+  const size_t size = 64;
+
+  // Fill more than one chunk
+  std::vector<void *> slots;
+  while (arena.getBytesReserved() < 3 * MemoryArena::ChunkSize)
+    slots.push_back(arena.allocate(size));
+  EXPECT_EQ(arena.getBytesAllocated(), slots.size() * size);
+
+  // Freeing every other slot keeps all chunks, and the freed slots are
+  // handed out again before new chunks are taken
+  for (size_t i = 0; i < slots.size(); i += 2)
+    arena.deallocate(slots[i], size);
+  for (size_t i = 0; i < slots.size(); i += 2)
+    slots[i] = arena.allocate(size);
+  EXPECT_EQ(arena.getBytesReserved(), 3 * MemoryArena::ChunkSize);
+
+  // Empty chunks are returned, except for the spare
+  for (void *p : slots)
+    arena.deallocate(p, size);
+  EXPECT_EQ(arena.getBytesAllocated(), 0u);
+  EXPECT_EQ(arena.getBytesReserved(), MemoryArena::ChunkSize);
+}
+}
@@ -0,0 +1,299 @@
+//===-- ObjectStateTest.cpp -------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+
+#include "Core/Context.h"
+#include "Core/CoreStats.h"
+#include "Core/Memory.h"
+#include "Core/MemoryArena.h"
+#include "Core/MemoryManager.h"
+
+#include "klee/Expr/ArrayCache.h"
+#include "klee/Expr/Assignment.h"
+#include "klee/Expr/Expr.h"
+
+#include <random>
+#include <vector>
+
+using namespace klee;
+
+namespace {
+
+const unsigned objectSize = 16;
+
+class ObjectStateTest : public ::testing::Test {
+protected:
+  ArrayCache arrayCache;
+  MemoryManager memory;
+  MemoryObject *mo;
+  const Array *offsets;
+  const Array *values;
+  /// The symbolic arrays the contents may refer to.
+  std::vector<const Array *> arrays;
+
+  static void SetUpTestCase() { Context::initialize(true, Expr::Int64); }
+
+  ObjectStateTest() : memory(&arrayCache) {
+    mo = memory.allocate(objectSize, false, true, nullptr, 8);
+    offsets = arrayCache.CreateArray("offsets", 256);
+    values = arrayCache.CreateArray("values", 256);
+    arrays = {offsets, values};
+  }
+
+  ref<Expr> symbolicOffset(unsigned k) {
+    ref<Expr> byte = ReadExpr::create(
+        UpdateList(offsets, 0), ConstantExpr::create(k, Expr::Int32));
+    return AndExpr::create(ZExtExpr::create(byte, Expr::Int32),
+                           ConstantExpr::create(objectSize - 1, Expr::Int32));
+  }
+
+  ref<Expr> symbolicValue(unsigned k) {
+    return ReadExpr::create(UpdateList(values, 0),
+                            ConstantExpr::create(k, Expr::Int32));
+  }
+
+  /// Check that the bytes of os evaluate like the bytes of the model under
+  /// a few random assignments.
+  void expectEquivalent(const ObjectState &os,
+                        const std::vector<ref<Expr> > &model,
+                        std::mt19937 &rng) {
+    for (unsigned round = 0; round < 4; ++round) {
+      std::vector<std::vector<unsigned char> > contents;
+      for (const Array *array : arrays) {
+        contents.emplace_back();
+        for (unsigned i = 0; i < array->size; ++i)
+          contents.back().push_back(rng());
+      }
+      Assignment assignment(arrays, contents);
+
+      for (unsigned i = 0; i < objectSize; ++i) {
+        ref<Expr> actual = assignment.evaluate(os.read8(i));
+        ref<Expr> expected = assignment.evaluate(model[i]);
+        ASSERT_TRUE(isa<ConstantExpr>(actual));
+        ASSERT_EQ(expected, actual) << "byte " << i;
+      }
+    }
+  }
+
+  /// Apply random writes at concrete and symbolic offsets to os and a model
+  /// of its bytes, reading the object back after each step.
+  void runRandomWrites(ObjectState &os, std::vector<ref<Expr> > &model,
+                       unsigned seed) {
+    std::mt19937 rng(seed);
+    for (unsigned step = 0; step < 400; ++step) {
+      unsigned k = step % 256;
+      unsigned choice = rng() % 8;
+      if (choice < 2) {
+        // Write at a symbolic offset
+        ref<Expr> offset = symbolicOffset(k);
+        ref<Expr> value = symbolicValue(k);
+        if (!choice)
+          value = ConstantExpr::create(rng() % 256, Expr::Int8);
+        os.write(offset, value);
+        for (unsigned i = 0; i < objectSize; ++i)
+          model[i] = SelectExpr::create(
+              EqExpr::create(offset, ConstantExpr::create(i, Expr::Int32)),
+              value, model[i]);
+      } else if (choice < 4) {
+        // Read at a symbolic offset, which flushes the object to the updates
+        os.read(symbolicOffset(k), Expr::Int8);
+      } else {
+        unsigned offset = rng() % objectSize;
+        ref<Expr> value = symbolicValue(k);
+        if (choice >= 6)
+          value = ConstantExpr::create(rng() % 256, Expr::Int8);
+        os.write(offset, value);
+        model[offset] = value;
+      }
+
+      if (step % 50 == 49)
+        expectEquivalent(os, model, rng);
+    }
+    expectEquivalent(os, model, rng);
+  }
+};
+
+TEST_F(ObjectStateTest, CompactionAndIndexOfConcreteObject) {
+  ObjectState *os = new ObjectState(mo);
+  ref<ObjectState> holder(os);
+  std::vector<ref<Expr> > model;
+  for (unsigned i = 0; i < objectSize; ++i) {
+    os->write8(i, (uint8_t)i);
+    model.push_back(ConstantExpr::create(i, Expr::Int8));
+  }
+
+  uint64_t compacted = stats::updateNodesCompacted;
+  runRandomWrites(*os, model, 1);
+  // The updates grew long enough to be compacted (and indexed)
+  EXPECT_GT(stats::updateNodesCompacted, compacted);
+}
+
+TEST_F(ObjectStateTest, CompactionAndIndexOfSymbolicObject) {
+  const Array *initial = arrayCache.CreateArray("initial", objectSize);
+  arrays.push_back(initial);
+  ObjectState *os = new ObjectState(mo, initial);
+  ref<ObjectState> holder(os);
+  std::vector<ref<Expr> > model;
+  for (unsigned i = 0; i < objectSize; ++i)
+    model.push_back(ReadExpr::create(UpdateList(initial, 0),
+                                     ConstantExpr::create(i, Expr::Int32)));
+
+  uint64_t compacted = stats::updateNodesCompacted;
+  runRandomWrites(*os, model, 2);
+  EXPECT_GT(stats::updateNodesCompacted, compacted);
+}
+
+TEST_F(ObjectStateTest, CopiesKeepTheirUpdates) {
+  ObjectState *os = new ObjectState(mo);
+  ref<ObjectState> holder(os);
+  std::vector<ref<Expr> > model;
+  for (unsigned i = 0; i < objectSize; ++i) {
+    os->write8(i, (uint8_t)0);
+    model.push_back(ConstantExpr::create(0, Expr::Int8));
+  }
+  runRandomWrites(*os, model, 3);
+
+  // A copy is compacted and indexed independently of the original
+  ObjectState *copy = new ObjectState(*os);
+  ref<ObjectState> copyHolder(copy);
+  std::vector<ref<Expr> > copyModel = model;
+  runRandomWrites(*copy, copyModel, 4);
+
+  std::mt19937 rng(5);
+  expectEquivalent(*os, model, rng);
+  expectEquivalent(*copy, copyModel, rng);
+}
+
+TEST_F(ObjectStateTest, SymbolicObjectWithoutMetadata) {
+  const unsigned largeSize = 64 * 1024;
+  MemoryObject *large = memory.allocate(largeSize, false, true, nullptr, 8);
+  const Array *initial = arrayCache.CreateArray("large", largeSize);
+
+  // Neither a concrete store nor masks of the object's size are allocated
+  size_t allocated = MemoryArena::get().getBytesAllocated();
+  ObjectState *os = new ObjectState(large, initial);
+  ref<ObjectState> holder(os);
+  EXPECT_LT(MemoryArena::get().getBytesAllocated() - allocated,
+            largeSize / 8);
+
+  // Bytes read from the initial array, and the concrete store reads as zeros
+  for (unsigned i : {0u, 1u, largeSize - 1}) {
+    ref<Expr> expected = ReadExpr::create(
+        UpdateList(initial, 0), ConstantExpr::create(i, Expr::Int32));
+    EXPECT_EQ(os->read8(i), expected);
+  }
+  std::vector<uint8_t> contents(largeSize, 1);
+  os->copyOutConcreteStore(contents.data());
+  EXPECT_EQ(contents, std::vector<uint8_t>(largeSize, 0));
+
+  // A write at a concrete offset switches to the masked form
+  os->write8(5, (uint8_t)42);
+  EXPECT_EQ(os->read8(5), ConstantExpr::create(42, Expr::Int8));
+  EXPECT_EQ(os->read8(6),
+            ReadExpr::create(UpdateList(initial, 0),
+                             ConstantExpr::create(6, Expr::Int32)));
+}
+
+TEST_F(ObjectStateTest, SymbolicObjectWrites) {
+  const Array *initial = arrayCache.CreateArray("initial", objectSize);
+  arrays.push_back(initial);
+  std::vector<ref<Expr> > model;
+  for (unsigned i = 0; i < objectSize; ++i)
+    model.push_back(ReadExpr::create(UpdateList(initial, 0),
+                                     ConstantExpr::create(i, Expr::Int32)));
+
+  // Writes at symbolic offsets only, which keep the object all symbolic
+  ObjectState *os = new ObjectState(mo, initial);
+  ref<ObjectState> holder(os);
+  for (unsigned k = 0; k < 8; ++k) {
+    ref<Expr> offset = symbolicOffset(k);
+    ref<Expr> value = symbolicValue(k);
+    os->write(offset, value);
+    for (unsigned i = 0; i < objectSize; ++i)
+      model[i] = SelectExpr::create(
+          EqExpr::create(offset, ConstantExpr::create(i, Expr::Int32)), value,
+          model[i]);
+  }
+  std::mt19937 rng(6);
+  expectEquivalent(*os, model, rng);
+
+  // A copy switches to the masked form on its own
+  ObjectState *copy = new ObjectState(*os);
+  ref<ObjectState> copyHolder(copy);
+  std::vector<ref<Expr> > copyModel = model;
+  copy->write(3, ConstantExpr::create(7, Expr::Int8));
+  copyModel[3] = ConstantExpr::create(7, Expr::Int8);
+  copy->write(4, symbolicValue(9));
+  copyModel[4] = symbolicValue(9);
+  expectEquivalent(*os, model, rng);
+  expectEquivalent(*copy, copyModel, rng);
+}
+
+TEST_F(ObjectStateTest, ConcreteReads) {
+  ObjectState *os = new ObjectState(mo);
+  ref<ObjectState> holder(os);
+  for (unsigned i = 0; i < objectSize; ++i)
+    os->write8(i, (uint8_t)(0x10 + i));
+
+  // Constant-offset reads of a concrete object give a single constant
+  ref<Expr> word = os->read(2, Expr::Int32);
+  ASSERT_TRUE(isa<ConstantExpr>(word));
+  EXPECT_EQ(cast<ConstantExpr>(word)->getZExtValue(), 0x15141312u);
+  ref<Expr> dword = os->read(8, Expr::Int64);
+  ASSERT_TRUE(isa<ConstantExpr>(dword));
+  EXPECT_EQ(cast<ConstantExpr>(dword)->getZExtValue(),
+            UINT64_C(0x1f1e1d1c1b1a1918));
+
+  // With a symbolic byte, the read is assembled from the bytes as before
+  os->write(3, symbolicValue(0));
+  ref<Expr> mixed = os->read(2, Expr::Int32);
+  EXPECT_FALSE(isa<ConstantExpr>(mixed));
+  ref<Expr> expected = ConcatExpr::create4(
+      ConstantExpr::create(0x15, Expr::Int8),
+      ConstantExpr::create(0x14, Expr::Int8), symbolicValue(0),
+      ConstantExpr::create(0x12, Expr::Int8));
+  EXPECT_EQ(mixed, expected);
+}
+
+TEST_F(ObjectStateTest, ReadOnlyContentsShared) {
+  const unsigned tableSize = 8192;
+  auto makeTable = [this](uint8_t seed) {
+    MemoryObject *table = memory.allocate(tableSize, false, true, nullptr, 8);
+    ObjectState *os = new ObjectState(table);
+    for (unsigned i = 0; i < tableSize; ++i)
+      os->write8(i, (uint8_t)(seed + i));
+    os->setReadOnly(true);
+    return os;
+  };
+
+  ref<ObjectState> first(makeTable(1));
+  first->internContents();
+
+  // Equal contents share the pages of the first table
+  uint64_t shared = stats::objectStatePagesShared;
+  ref<ObjectState> second(makeTable(1));
+  second->internContents();
+  EXPECT_GT(stats::objectStatePagesShared, shared);
+
+  // Different contents are kept as they are
+  shared = stats::objectStatePagesShared;
+  ref<ObjectState> third(makeTable(2));
+  third->internContents();
+  EXPECT_EQ(stats::objectStatePagesShared, shared);
+
+  std::vector<uint8_t> contents(tableSize);
+  second->copyOutConcreteStore(contents.data());
+  EXPECT_TRUE(first->equalsConcreteStore(contents.data()));
+  EXPECT_FALSE(third->equalsConcreteStore(contents.data()));
+  for (unsigned i : {0u, 100u, tableSize - 1})
+    EXPECT_EQ(second->read8(i),
+              ConstantExpr::create((uint8_t)(1 + i), Expr::Int8));
+}
+}
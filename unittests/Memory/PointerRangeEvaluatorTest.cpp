@@ -0,0 +1,154 @@
+//===-- PointerRangeEvaluatorTest.cpp ---------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+
+#include "Core/PointerRangeEvaluator.h"
+
+#include "klee/Expr/ArrayCache.h"
+#include "klee/Expr/Assignment.h"
+#include "klee/Expr/Expr.h"
+
+#include <vector>
+
+using namespace klee;
+
+namespace {
+
+class PointerRangeEvaluatorTest : public ::testing::Test {
+protected:
+  ArrayCache arrayCache;
+  const Array *array;
+
+  PointerRangeEvaluatorTest() : array(arrayCache.CreateArray("a", 2)) {}
+
+  ref<Expr> byte(unsigned i) {
+    return ReadExpr::create(UpdateList(array, 0),
+                            ConstantExpr::create(i, Expr::Int32));
+  }
+
+  ref<Expr> constant(uint64_t value, Expr::Width width) {
+    return ConstantExpr::create(value, width);
+  }
+
+  static ref<Expr> divide(Expr::Kind kind, const ref<Expr> &l,
+                          const ref<Expr> &r) {
+    return kind == Expr::UDiv ? UDivExpr::create(l, r)
+                              : URemExpr::create(l, r);
+  }
+
+  /// Check that every value \a e takes for any two input bytes lies in the
+  /// range computed for it. Divisions by zero are left unevaluated, so
+  /// their results have to be checked with expectContains(e, value).
+  void expectContains(const ref<Expr> &e) {
+    PointerRange range = PointerRangeEvaluator().evaluate(e);
+    std::vector<const Array *> objects(1, array);
+    for (unsigned a = 0; a < 256; ++a) {
+      for (unsigned b = 0; b < 256; ++b) {
+        std::vector<std::vector<unsigned char> > values(
+            1, std::vector<unsigned char>{static_cast<unsigned char>(a),
+                                          static_cast<unsigned char>(b)});
+        Assignment assignment(objects, values);
+        ref<Expr> value = assignment.evaluate(e);
+        if (!isa<ConstantExpr>(value))
+          continue;
+        uint64_t v = cast<ConstantExpr>(value)->getZExtValue();
+        ASSERT_LE(range.first, v) << "a = " << a << ", b = " << b;
+        ASSERT_GE(range.second, v) << "a = " << a << ", b = " << b;
+      }
+    }
+  }
+
+  void expectContains(const ref<Expr> &e, uint64_t value) {
+    PointerRange range = PointerRangeEvaluator().evaluate(e);
+    EXPECT_LE(range.first, value);
+    EXPECT_GE(range.second, value);
+  }
+};
+
+TEST_F(PointerRangeEvaluatorTest, BasePlusOffset) {
+  ref<Expr> offset = ZExtExpr::create(byte(0), Expr::Int64);
+  ref<Expr> p = AddExpr::create(
+      constant(0x1000, Expr::Int64),
+      MulExpr::create(offset, constant(4, Expr::Int64)));
+  PointerRange range = PointerRangeEvaluator().evaluate(p);
+  EXPECT_EQ(range.first, 0x1000u);
+  EXPECT_EQ(range.second, 0x1000u + 255 * 4);
+  expectContains(p);
+}
+
+TEST_F(PointerRangeEvaluatorTest, DivisionByConstant) {
+  ref<Expr> dividend = AddExpr::create(ZExtExpr::create(byte(0), Expr::Int64),
+                                       constant(1000, Expr::Int64));
+  PointerRange quotient = PointerRangeEvaluator().evaluate(
+      UDivExpr::create(dividend, constant(10, Expr::Int64)));
+  EXPECT_EQ(quotient.first, 100u);
+  EXPECT_EQ(quotient.second, 125u);
+
+  PointerRange remainder = PointerRangeEvaluator().evaluate(
+      URemExpr::create(dividend, constant(10, Expr::Int64)));
+  EXPECT_EQ(remainder.first, 0u);
+  EXPECT_EQ(remainder.second, 9u);
+}
+
+TEST_F(PointerRangeEvaluatorTest, DivisorMayBeZero) {
+  // x / 0 is all ones and x % 0 is x, so neither can be bounded by the
+  // dividend or the divisor
+  ref<Expr> dividend = ZExtExpr::create(byte(0), Expr::Int64);
+  ref<Expr> divisor = ZExtExpr::create(byte(1), Expr::Int64);
+  PointerRange full(0, UINT64_MAX);
+  EXPECT_EQ(PointerRangeEvaluator().evaluate(
+                UDivExpr::create(dividend, divisor)),
+            full);
+  EXPECT_EQ(PointerRangeEvaluator().evaluate(
+                URemExpr::create(dividend, divisor)),
+            full);
+
+  for (Expr::Kind kind : {Expr::UDiv, Expr::URem}) {
+    ref<Expr> x = AndExpr::create(byte(0), constant(15, Expr::Int8));
+    // The largest result of dividing x by zero
+    uint64_t byZero = kind == Expr::UDiv ? 0xFF : 15;
+    ref<Expr> e = divide(kind, x, byte(1));
+    expectContains(e);
+    expectContains(e, byZero);
+
+    e = divide(kind, x, AndExpr::create(byte(1), constant(3, Expr::Int8)));
+    expectContains(e);
+    expectContains(e, byZero);
+
+    e = AddExpr::create(
+        constant(0x1000, Expr::Int64),
+        ZExtExpr::create(divide(kind, x, byte(1)), Expr::Int64));
+    expectContains(e);
+    expectContains(e, 0x1000 + byZero);
+  }
+}
+
+TEST_F(PointerRangeEvaluatorTest, NonZeroDivisor) {
+  ref<Expr> dividend = AddExpr::create(ZExtExpr::create(byte(0), Expr::Int64),
+                                       constant(1000, Expr::Int64));
+  ref<Expr> divisor = AddExpr::create(ZExtExpr::create(byte(1), Expr::Int64),
+                                      constant(1, Expr::Int64));
+  PointerRange quotient =
+      PointerRangeEvaluator().evaluate(UDivExpr::create(dividend, divisor));
+  EXPECT_EQ(quotient.first, 1000u / 256);
+  EXPECT_EQ(quotient.second, 1255u);
+  expectContains(UDivExpr::create(dividend, divisor));
+
+  PointerRange remainder =
+      PointerRangeEvaluator().evaluate(URemExpr::create(dividend, divisor));
+  EXPECT_EQ(remainder.first, 0u);
+  EXPECT_EQ(remainder.second, 255u);
+  expectContains(URemExpr::create(dividend, divisor));
+
+  for (Expr::Kind kind : {Expr::UDiv, Expr::URem})
+    expectContains(divide(kind, byte(0),
+                          OrExpr::create(byte(1), constant(1, Expr::Int8))));
+}
+}
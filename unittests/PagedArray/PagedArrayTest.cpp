@@ -0,0 +1,160 @@
+//===-- PagedArrayTest.cpp --------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "klee/ADT/PagedArray.h"
+#include "klee/Expr/Expr.h"
+#include "gtest/gtest.h"
+
+#include <map>
+#include <vector>
+
+using namespace klee;
+
+int finished = 0;
+
+namespace {
+
+/// An allocation policy that keeps track of the bytes it hands out.
+struct CountingAllocator {
+  static size_t live;
+  static void *allocate(size_t size) {
+    live += size;
+    return ::operator new(size);
+  }
+  static void deallocate(void *p, size_t size) {
+    live -= size;
+    ::operator delete(p);
+  }
+};
+size_t CountingAllocator::live = 0;
+
+/// An allocation policy that checks that every allocation is freed with
+/// the size it was allocated with.
+struct CheckingAllocator {
+  static std::map<void *, size_t> sizes;
+  static void *allocate(size_t size) {
+    void *p = ::operator new(size);
+    sizes[p] = size;
+    return p;
+  }
+  static void deallocate(void *p, size_t size) {
+    auto it = sizes.find(p);
+    ASSERT_NE(it, sizes.end());
+    EXPECT_EQ(it->second, size);
+    sizes.erase(it);
+    ::operator delete(p);
+  }
+};
+std::map<void *, size_t> CheckingAllocator::sizes;
+
+/// An element that counts its live instances.
+struct Counted {
+  static int live;
+  Counted() { ++live; }
+  Counted(const Counted &) { ++live; }
+  Counted &operator=(const Counted &) = default;
+  ~Counted() { --live; }
+};
+int Counted::live = 0;
+
+TEST(PagedArrayTest, CopyOnWrite) {
+  const unsigned size = 3 * PagedArray<uint8_t>::PageSize + 10;
+  PagedArray<uint8_t> a(size, 7);
+  EXPECT_EQ(a.getNumPages(), 4u);
+  EXPECT_EQ(a.getNumSharedPages(), 0u);
+
+  PagedArray<uint8_t> b(a);
+  EXPECT_EQ(b.getNumSharedPages(), 4u);
+
+  // Writing to a copy only copies the page that is written to.
+  EXPECT_TRUE(b.set(PagedArray<uint8_t>::PageSize + 1, 42));
+  EXPECT_FALSE(b.set(PagedArray<uint8_t>::PageSize + 2, 43));
+  EXPECT_EQ(b.getNumSharedPages(), 3u);
+  EXPECT_EQ(a.getNumSharedPages(), 3u);
+  EXPECT_EQ(a[PagedArray<uint8_t>::PageSize + 1], 7);
+  EXPECT_EQ(b[PagedArray<uint8_t>::PageSize + 1], 42);
+
+  // Copying in unchanged contents keeps pages shared.
+  std::vector<uint8_t> contents(size);
+  b.copyOut(contents.data());
+  EXPECT_TRUE(b.equals(contents.data()));
+  EXPECT_FALSE(a.equals(contents.data()));
+  contents[size - 1] = 1;
+  EXPECT_EQ(b.copyIn(contents.data()), 1u);
+  EXPECT_EQ(b.getNumSharedPages(), 2u);
+  EXPECT_EQ(b[size - 1], 1);
+  EXPECT_EQ(a[size - 1], 7);
+}
+
+TEST(PagedArrayTest, Refs) {
+  ref<Expr> value = ConstantExpr::create(5, Expr::Int8);
+  PagedArray<ref<Expr> > a(1000);
+  a.set(999, value);
+  {
+    PagedArray<ref<Expr> > b(a);
+    b.set(0, value);
+    EXPECT_TRUE(a[0].isNull());
+    EXPECT_EQ(b[999], value);
+  }
+  EXPECT_EQ(a[999], value);
+}
+
+TEST(PagedArrayTest, Bits) {
+  PagedBitArray a(100000, true);
+  PagedBitArray b(a);
+  EXPECT_TRUE(b.unset(99999));
+  EXPECT_FALSE(b.unset(99999));
+  EXPECT_FALSE(b.set(0));
+  EXPECT_FALSE(b.get(99999));
+  EXPECT_TRUE(a.get(99999));
+}
+
+TEST(PagedArrayTest, Allocator) {
+  typedef PagedArray<uint8_t, CountingAllocator> Array;
+  {
+    Array a(2 * Array::PageSize + 10);
+    size_t pages = CountingAllocator::live;
+    EXPECT_GE(pages, 2 * Array::PageSize + 10);
+
+    // Copies share pages until they are written to, and arrays created
+    // with new come from the allocator as well.
+    Array *b = new Array(a);
+    EXPECT_EQ(CountingAllocator::live, pages + sizeof(Array));
+    b->set(0, 1);
+    EXPECT_GT(CountingAllocator::live, pages + sizeof(Array) + Array::PageSize);
+    delete b;
+    EXPECT_EQ(CountingAllocator::live, pages);
+
+    BasicPagedBitArray<CountingAllocator> bits(100);
+    EXPECT_GT(CountingAllocator::live, pages);
+  }
+  EXPECT_EQ(CountingAllocator::live, 0u);
+}
+
+TEST(PagedArrayTest, PageSizes) {
+  typedef PagedArray<Counted, CheckingAllocator> Array;
+  {
+    // Full pages and a short last page, of different sizes
+    Array a(Array::PageSize + 3);
+    Array b(5);
+    EXPECT_EQ(a.getNumPages(), 2u);
+    EXPECT_EQ(Counted::live, (int)Array::PageSize + 3 + 5);
+
+    // Copied pages have the size of the original
+    Array c(a);
+    c.set(Array::PageSize, Counted());
+    c.set(0, Counted());
+    EXPECT_EQ(Counted::live, 2 * ((int)Array::PageSize + 3) + 5);
+  }
+  // All elements were destroyed and all pages freed with their size
+  EXPECT_EQ(Counted::live, 0);
+  EXPECT_TRUE(CheckingAllocator::sizes.empty());
+}
+
+}
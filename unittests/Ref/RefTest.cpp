@@ -172,3 +172,23 @@ TEST(RefTest, SelfRef) {
   r_root = r_root->next_;
   EXPECT_EQ(2u, r_e_1->_refCount.getCount());
 }
+
+TEST(RefTest, Immortal) {
+  finished = 0;
+  finished_counter = 0;
+  struct Expr *r_e = new Expr();
+  r_e->_refCount.makeImmortal();
+  unsigned count = r_e->_refCount.getCount();
+  {
+    ref<Expr> r(r_e);
+    ref<Expr> q = r;
+    EXPECT_EQ(count, r_e->_refCount.getCount());
+  }
+  // Dropping all references does not delete it
+  EXPECT_EQ(count, r_e->_refCount.getCount());
+  EXPECT_EQ(0, finished_counter);
+
+  finished = 1;
+  delete r_e;
+  EXPECT_EQ(1, finished_counter);
+}
@@ -9,15 +9,24 @@
 
 #include "gtest/gtest.h"
 
+#include "klee/Config/config.h"
 #include "klee/Expr/ArrayCache.h"
+#include "klee/Expr/Assignment.h"
 #include "klee/Expr/Constraints.h"
 #include "klee/Expr/Expr.h"
 #include "klee/Solver/Solver.h"
 #include "klee/Solver/SolverCmdLine.h"
+#include "klee/Solver/SolverStats.h"
 
 #include "llvm/ADT/StringExtras.h"
 
+#include <atomic>
+#include <cstdlib>
 #include <iostream>
+#include <string>
+#include <thread>
+
+#include <unistd.h>
 
 using namespace klee;
 
@@ -169,4 +178,260 @@ TEST(SolverTest, Evaluation) {
   delete solver;
 }
 
+TEST(SolverTest, Portfolio) {
+  Solver *solver = klee::createCoreSolver(PORTFOLIO_SOLVER);
+  ASSERT_NE(solver, nullptr);
+  solver->setCoreSolverTimeout(time::Span("10s"));
+
+  testOpcode<AddExpr>(*solver);
+  testOpcode<UDivExpr>(*solver, false, false, 8);
+  testOpcode<UltExpr>(*solver);
+
+  delete solver;
+}
+
+TEST(SolverTest, ParallelIndependentFactors) {
+  IndependentSolverJobs = 2;
+  IndependentSolverParallelMinConstraints = 1;
+  Solver *solver =
+      createIndependentSolver(klee::createCoreSolver(CoreSolverToUse));
+
+  // Three independent factors: x == 3, y == 5 && z == y + 1
+  std::vector<const Array *> objects;
+  std::vector<ref<Expr>> reads;
+  for (const char *name : {"factor_x", "factor_y", "factor_z"}) {
+    objects.push_back(ac.CreateArray(name, 1));
+    reads.push_back(Expr::createTempRead(objects.back(), Expr::Int8));
+  }
+  ConstraintSet constraints;
+  constraints.push_back(EqExpr::create(reads[0], getConstant(3, Expr::Int8)));
+  constraints.push_back(EqExpr::create(reads[1], getConstant(5, Expr::Int8)));
+  constraints.push_back(EqExpr::create(
+      reads[2], AddExpr::create(reads[1], getConstant(1, Expr::Int8))));
+
+  std::vector<std::vector<unsigned char>> values;
+  ASSERT_TRUE(solver->getInitialValues(
+      Query(constraints, getConstant(0, Expr::Bool)), objects, values));
+  ASSERT_EQ(values.size(), 3u);
+  EXPECT_EQ(values[0][0], 3);
+  EXPECT_EQ(values[1][0], 5);
+  EXPECT_EQ(values[2][0], 6);
+
+  // An unsatisfiable factor makes the whole query unsatisfiable.
+  constraints.push_back(EqExpr::create(reads[0], getConstant(4, Expr::Int8)));
+  values.clear();
+  EXPECT_FALSE(solver->getInitialValues(
+      Query(constraints, getConstant(0, Expr::Bool)), objects, values));
+
+  delete solver;
+  IndependentSolverJobs = 1;
+  IndependentSolverParallelMinConstraints = 8;
+}
+
+TEST(SolverTest, ParallelIndependentFactorsMatchSerial) {
+  // Factors of i + 1 constraints each: x_i * 3 + j < y_i + i for j <= i
+  std::vector<const Array *> objects;
+  ConstraintSet constraints;
+  for (unsigned i = 0; i < 6; ++i) {
+    const Array *x = ac.CreateArray("match_x" + llvm::utostr(i), 1);
+    const Array *y = ac.CreateArray("match_y" + llvm::utostr(i), 1);
+    objects.push_back(x);
+    objects.push_back(y);
+    ref<Expr> readX = Expr::createTempRead(x, Expr::Int8);
+    ref<Expr> readY = Expr::createTempRead(y, Expr::Int8);
+    for (unsigned j = 0; j <= i; ++j)
+      constraints.push_back(UltExpr::create(
+          AddExpr::create(MulExpr::create(readX, getConstant(3, Expr::Int8)),
+                          getConstant(j, Expr::Int8)),
+          AddExpr::create(readY, getConstant(i, Expr::Int8))));
+  }
+  Query query(constraints, getConstant(0, Expr::Bool));
+
+  auto solve = [&](unsigned jobs, unsigned minConstraints,
+                   std::vector<std::vector<unsigned char>> &values) {
+    IndependentSolverJobs = jobs;
+    IndependentSolverParallelMinConstraints = minConstraints;
+    Solver *solver =
+        createIndependentSolver(klee::createCoreSolver(CoreSolverToUse));
+    uint64_t before = stats::queryCounterexamples;
+    EXPECT_TRUE(solver->getInitialValues(query, objects, values));
+    delete solver;
+    IndependentSolverJobs = 1;
+    IndependentSolverParallelMinConstraints = 8;
+    return stats::queryCounterexamples - before;
+  };
+
+  std::vector<std::vector<unsigned char>> serial, parallel, mixed;
+  EXPECT_EQ(solve(1, 8, serial), 6u);
+  // The factors solved by the other processes are not counted here
+  EXPECT_EQ(solve(3, 1, parallel), 0u);
+  EXPECT_EQ(solve(3, 4, mixed), 3u);
+
+  // The solutions may differ, as the solver state differs, but all of them
+  // must satisfy the query
+  for (auto *values : {&serial, &parallel, &mixed}) {
+    ASSERT_EQ(values->size(), objects.size());
+    Assignment assignment(objects, *values);
+    for (const auto &constraint : constraints)
+      EXPECT_TRUE(assignment.evaluate(constraint)->isTrue());
+  }
+
+  // Unsatisfiable factors are found in parallel as well
+  const Array *z = ac.CreateArray("match_z", 1);
+  ref<Expr> readZ = Expr::createTempRead(z, Expr::Int8);
+  for (unsigned i = 0; i < 2; ++i)
+    constraints.push_back(EqExpr::create(readZ, getConstant(i, Expr::Int8)));
+  Query unsatisfiable(constraints, getConstant(0, Expr::Bool));
+  for (unsigned jobs : {1u, 3u}) {
+    IndependentSolverJobs = jobs;
+    IndependentSolverParallelMinConstraints = 1;
+    Solver *solver =
+        createIndependentSolver(klee::createCoreSolver(CoreSolverToUse));
+    std::vector<std::vector<unsigned char>> values;
+    EXPECT_FALSE(solver->getInitialValues(unsatisfiable, objects, values));
+    delete solver;
+  }
+  IndependentSolverJobs = 1;
+  IndependentSolverParallelMinConstraints = 8;
+}
+
+TEST(SolverTest, BranchCacheSubsumption) {
+  BranchCacheSubsumption = true;
+  Solver *solver = createCachingSolver(klee::createCoreSolver(CoreSolverToUse));
+
+  const Array *array = ac.CreateArray("subsumption", 1);
+  ref<Expr> x = Expr::createTempRead(array, Expr::Int8);
+  ref<Expr> aboveTen = UltExpr::create(getConstant(10, Expr::Int8), x);
+  ref<Expr> belowTwenty = UltExpr::create(x, getConstant(20, Expr::Int8));
+  ref<Expr> aboveFive = UltExpr::create(getConstant(5, Expr::Int8), x);
+  ref<Expr> isFifteen = EqExpr::create(x, getConstant(15, Expr::Int8));
+
+  ConstraintSet small, large;
+  small.push_back(aboveTen);
+  large.push_back(aboveTen);
+  large.push_back(belowTwenty);
+
+  Solver::Validity result;
+  ASSERT_TRUE(solver->evaluate(Query(small, aboveFive), result));
+  EXPECT_EQ(result, Solver::True);
+  ASSERT_TRUE(solver->evaluate(Query(large, isFifteen), result));
+  EXPECT_EQ(result, Solver::Unknown);
+
+  // Validity under the smaller set carries over to the larger one, and
+  // satisfiability under the larger set carries over to the smaller one.
+  std::uint64_t hits = stats::queryCacheSubsumptionHits;
+  ASSERT_TRUE(solver->evaluate(Query(large, aboveFive), result));
+  EXPECT_EQ(result, Solver::True);
+  ASSERT_TRUE(solver->evaluate(Query(small, isFifteen), result));
+  EXPECT_EQ(result, Solver::Unknown);
+  EXPECT_EQ(stats::queryCacheSubsumptionHits - hits, 2u);
+
+  delete solver;
+  BranchCacheSubsumption = false;
+}
+
+// Asks whether `x u< i + 1` may hold under `i u< x` for a fresh array
+// allocated from the given cache.
+bool threadSafeQuery(Solver &solver, ArrayCache &cache, unsigned i) {
+  const Array *array = cache.CreateArray("threaded", 1);
+  ref<Expr> x = Expr::createTempRead(array, Expr::Int8);
+  ConstraintSet constraints;
+  constraints.push_back(UltExpr::create(getConstant(i, Expr::Int8), x));
+  Solver::Validity result;
+  return solver.evaluate(
+             Query(constraints,
+                   UltExpr::create(x, getConstant(i + 1, Expr::Int8))),
+             result) &&
+         result == Solver::False;
+}
+
+// Uses a thread-safe solver over the given core solver from several threads.
+void testThreadSafe(CoreSolverType cst) {
+  Solver *solver = createThreadSafeSolver([cst](SharedQueryCache &cache) {
+    return createSharedCachingSolver(klee::createCoreSolver(cst), cache);
+  });
+  solver->setCoreSolverTimeout(time::Span("10s"));
+
+  // Expressions must not be shared between threads, except for the
+  // immortal small constants, so every thread builds its queries from its
+  // own array cache.
+  std::atomic<unsigned> failures(0);
+  std::vector<std::thread> threads;
+  for (unsigned t = 0; t < 4; ++t)
+    threads.emplace_back([&]() {
+      ArrayCache cache;
+      for (unsigned i = 0; i < 8; ++i)
+        if (!threadSafeQuery(*solver, cache, i))
+          ++failures;
+    });
+  for (auto &thread : threads)
+    thread.join();
+  EXPECT_EQ(failures, 0u);
+
+  // All results are in the shared cache now.
+  ArrayCache cache;
+  std::uint64_t hits = stats::querySharedCacheHits;
+  for (unsigned i = 0; i < 8; ++i)
+    EXPECT_TRUE(threadSafeQuery(*solver, cache, i));
+  EXPECT_EQ(stats::querySharedCacheHits - hits, 8u);
+
+  delete solver;
+}
+
+TEST(SolverTest, ThreadSafe) { testThreadSafe(CoreSolverToUse); }
+
+#ifdef ENABLE_STP
+TEST(SolverTest, ThreadSafeSTP) {
+  // Each thread has its own STP solver, which forks by default and needs a
+  // region of its own to receive the counterexamples in.
+  testThreadSafe(STP_SOLVER);
+}
+#endif
+
+// Builds `x + 1 == 2` over a fresh array named "persistent" so that each call
+// yields a structurally equal query that shares no objects with the others.
+ref<Expr> persistentCacheQuery(ArrayCache &cache) {
+  const Array *array = cache.CreateArray("persistent", 1);
+  ref<Expr> x = Expr::createTempRead(array, Expr::Int8);
+  return EqExpr::create(AddExpr::create(x, getConstant(1, Expr::Int8)),
+                        getConstant(2, Expr::Int8));
+}
+
+TEST(SolverTest, PersistentCache) {
+  char dirTemplate[] = "/tmp/klee-query-cache-XXXXXX";
+  ASSERT_NE(mkdtemp(dirTemplate), nullptr);
+  const std::string directory = dirTemplate;
+  ConstraintSet constraints;
+
+  {
+    ArrayCache cache;
+    Solver *solver = createPersistentCachingSolver(
+        klee::createCoreSolver(CoreSolverToUse), directory);
+    Solver::Validity result;
+    ASSERT_TRUE(solver->evaluate(
+        Query(constraints, persistentCacheQuery(cache)), result));
+    EXPECT_EQ(result, Solver::Unknown);
+    delete solver;
+  }
+
+  {
+    // A second "run" answers from the cache alone.
+    ArrayCache cache;
+    Solver *solver =
+        createPersistentCachingSolver(createDummySolver(), directory);
+    Solver::Validity result;
+    ASSERT_TRUE(solver->evaluate(
+        Query(constraints, persistentCacheQuery(cache)), result));
+    EXPECT_EQ(result, Solver::Unknown);
+    bool mustBeTrue;
+    EXPECT_TRUE(solver->mustBeTrue(
+        Query(constraints, persistentCacheQuery(cache)), mustBeTrue));
+    EXPECT_FALSE(mustBeTrue);
+    delete solver;
+  }
+
+  unlink((directory + "/query-cache.bin").c_str());
+  rmdir(directory.c_str());
+}
+
 }
@@ -18,6 +18,8 @@
 #include "klee/Expr/Constraints.h"
 #include "klee/Expr/Expr.h"
 #include "klee/Solver/Solver.h"
+#include "klee/Solver/SolverCmdLine.h"
+#include "klee/Solver/SolverStats.h"
 
 using namespace klee;
 
@@ -69,3 +71,45 @@ TEST_F(Z3SolverTest, GetConstraintLog) {
   ASSERT_STRNE(Occurence, nullptr);
   free(ConstraintsString);
 }
+
+TEST_F(Z3SolverTest, IncrementalSolving) {
+  SolverIncremental = true;
+  Solver *Incremental = createCoreSolver(CoreSolverType::Z3_SOLVER);
+  Incremental->setCoreSolverTimeout(time::Span("10s"));
+
+  const Array *A = AC.CreateArray("incremental_a", 1);
+  const ref<Expr> X = Expr::createTempRead(A, Expr::Int8);
+  const ref<Expr> C0 = ConstantExpr::alloc(0, Expr::Int8);
+  const ref<Expr> C10 = ConstantExpr::alloc(10, Expr::Int8);
+  const ref<Expr> C20 = ConstantExpr::alloc(20, Expr::Int8);
+
+  // Parent state: x > 10
+  ConstraintSet Parent;
+  Parent.push_back(UltExpr::create(C10, X));
+
+  // Sibling states diverge on x < 20 / x >= 20
+  ConstraintSet Left(Parent), Right(Parent);
+  Left.push_back(UltExpr::create(X, C20));
+  Right.push_back(UleExpr::create(C20, X));
+
+  bool Result;
+  uint64_t Hits = stats::solverIncrementalHits;
+  ASSERT_TRUE(Incremental->mustBeFalse(Query(Parent, EqExpr::create(X, C0)),
+                                       Result));
+  EXPECT_TRUE(Result);
+  ASSERT_TRUE(Incremental->mustBeTrue(Query(Left, UltExpr::create(X, C20)),
+                                      Result));
+  EXPECT_TRUE(Result);
+  // Right shares the first constraint with Left, only its second one differs.
+  ASSERT_TRUE(Incremental->mustBeFalse(Query(Right, UltExpr::create(X, C20)),
+                                       Result));
+  EXPECT_TRUE(Result);
+  // Back to the parent: nothing new needs to be asserted.
+  ASSERT_TRUE(Incremental->mayBeTrue(Query(Parent, EqExpr::create(X, C20)),
+                                     Result));
+  EXPECT_TRUE(Result);
+  EXPECT_EQ(stats::solverIncrementalHits - Hits, 3u);
+
+  delete Incremental;
+  SolverIncremental = false;
+}
@@ -0,0 +1,167 @@
+//===-- StateSnapshotTest.cpp -----------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+#define KLEE_UNITTEST
+
+#include "gtest/gtest.h"
+
+#include "Core/Context.h"
+#include "Core/CoreStats.h"
+#include "Core/ExecutionState.h"
+#include "Core/Memory.h"
+#include "Core/MemoryManager.h"
+#include "Core/StateSnapshot.h"
+
+#include "klee/Expr/ArrayCache.h"
+#include "klee/Expr/Expr.h"
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+using namespace klee;
+
+namespace {
+
+const unsigned objectSize = 4096;
+
+class StateSnapshotTest : public ::testing::Test {
+protected:
+  ArrayCache arrayCache;
+  MemoryManager memory;
+  const Array *input;
+  std::string path;
+
+  static void SetUpTestCase() { Context::initialize(true, Expr::Int64); }
+
+  StateSnapshotTest()
+      : memory(&arrayCache), input(arrayCache.CreateArray("input", 4)),
+        path(::testing::TempDir() + "StateSnapshotTest.snapshot") {}
+
+  ref<Expr> inputByte(unsigned i) {
+    return ReadExpr::create(UpdateList(input, 0),
+                            ConstantExpr::create(i, Expr::Int32));
+  }
+
+  /// Give \a es an object with contents depending on \a id: concrete
+  /// bytes, except for a symbolic one and one of an update list, and a
+  /// constraint on the input.
+  std::unique_ptr<ExecutionState> makeState(unsigned id) {
+    std::unique_ptr<ExecutionState> es(new ExecutionState());
+    MemoryObject *mo = memory.allocate(objectSize, false, true, nullptr, 8);
+    ObjectState *os = new ObjectState(mo);
+    for (unsigned i = 0; i < objectSize; ++i)
+      os->write8(i, static_cast<uint8_t>(id * 7 + i));
+    os->write(0, inputByte(0));
+    os->write(ZExtExpr::create(inputByte(1), Expr::Int32),
+              ConstantExpr::create(id, Expr::Int8));
+    es->addressSpace.bindObject(mo, os);
+    es->addConstraint(
+        UltExpr::create(inputByte(2), ConstantExpr::create(id + 1, Expr::Int8)));
+    return es;
+  }
+
+  /// The constraints of \a es and the values of some bytes of its object.
+  std::vector<ref<Expr> > contents(const ExecutionState &es) {
+    std::vector<ref<Expr> > result(es.constraints.begin(),
+                                   es.constraints.end());
+    EXPECT_EQ(es.addressSpace.objects.size(), 1u);
+    if (es.addressSpace.objects.empty())
+      return result;
+    const ObjectState *os = es.addressSpace.objects.begin()->second.get();
+    for (unsigned i = 0; i < objectSize; i += 97)
+      result.push_back(os->read8(i));
+    result.push_back(os->read(ZExtExpr::create(inputByte(3), Expr::Int32),
+                              Expr::Int8));
+    return result;
+  }
+};
+
+TEST_F(StateSnapshotTest, SwapOutAndIn) {
+  SnapshotStore store(path);
+  uint64_t emptySize = store.getFileSize();
+  std::vector<std::unique_ptr<ExecutionState> > states;
+  std::vector<std::vector<ref<Expr> > > expected;
+  for (unsigned id = 0; id < 3; ++id) {
+    states.push_back(makeState(id));
+    expected.push_back(contents(*states.back()));
+  }
+
+  for (auto &es : states) {
+    store.swapOut(*es);
+    EXPECT_TRUE(store.isSwappedOut(*es));
+    EXPECT_TRUE(es->constraints.empty());
+    EXPECT_TRUE(es->addressSpace.objects.empty());
+  }
+  EXPECT_EQ(store.getNumSwappedOut(), 3u);
+  EXPECT_GT(store.getFileSize(), emptySize);
+
+  for (unsigned id = 0; id < 3; ++id) {
+    store.swapIn(*states[id]);
+    EXPECT_FALSE(store.isSwappedOut(*states[id]));
+    EXPECT_EQ(contents(*states[id]), expected[id]);
+  }
+  // Nothing uses the file anymore
+  EXPECT_EQ(store.getFileSize(), emptySize);
+}
+
+TEST_F(StateSnapshotTest, DropDoesNotRead) {
+  SnapshotStore store(path);
+  uint64_t emptySize = store.getFileSize();
+  std::unique_ptr<ExecutionState> first = makeState(0), second = makeState(1);
+  std::vector<ref<Expr> > expected = contents(*second);
+
+  store.swapOut(*first);
+  store.swapOut(*second);
+  uint64_t swappedIn = stats::statesSwappedIn;
+  store.drop(*first);
+  EXPECT_EQ(stats::statesSwappedIn, swappedIn);
+  EXPECT_FALSE(store.isSwappedOut(*first));
+  EXPECT_TRUE(first->addressSpace.objects.empty());
+  EXPECT_EQ(store.getNumSwappedOut(), 1u);
+
+  // Resident states are left alone
+  std::unique_ptr<ExecutionState> resident = makeState(2);
+  store.drop(*resident);
+  EXPECT_EQ(resident->addressSpace.objects.size(), 1u);
+
+  store.swapIn(*second);
+  EXPECT_EQ(contents(*second), expected);
+  EXPECT_EQ(store.getFileSize(), emptySize);
+
+  store.swapOut(*second);
+  store.drop(*second);
+  EXPECT_EQ(store.getFileSize(), emptySize);
+}
+
+TEST_F(StateSnapshotTest, Compaction) {
+  // Compact whenever the file doubles
+  SnapshotStore store(path, 1);
+  uint64_t compactions = stats::snapshotCompactions;
+
+  // Two states are swapped out at any time, while many more were
+  std::vector<std::unique_ptr<ExecutionState> > states;
+  std::vector<std::vector<ref<Expr> > > expected;
+  uint64_t maxSize = 0;
+  for (unsigned id = 0; id < 40; ++id) {
+    states.push_back(makeState(id));
+    expected.push_back(contents(*states.back()));
+    store.swapOut(*states.back());
+    if (id >= 2)
+      store.drop(*states[id - 2]);
+    maxSize = std::max(maxSize, store.getFileSize());
+  }
+  EXPECT_GT(stats::snapshotCompactions, compactions);
+  EXPECT_LT(maxSize, 8 * objectSize);
+
+  for (unsigned id = 38; id < 40; ++id) {
+    store.swapIn(*states[id]);
+    EXPECT_EQ(contents(*states[id]), expected[id]);
+  }
+}
+}
@@ -0,0 +1,105 @@
+#include "klee/Statistics/Statistic.h"
+#include "klee/Statistics/Statistics.h"
+#include "gtest/gtest.h"
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace klee;
+
+namespace {
+Statistic testStatistic("TestStatistic", "TS");
+
+class SharedStatisticsTest : public ::testing::Test {
+protected:
+  // Sharing cannot be undone, so all tests share the statistics
+  static void SetUpTestCase() {
+    theStatisticManager->useIndexedStats(5);
+    ASSERT_TRUE(theStatisticManager->shareBetweenProcesses());
+  }
+
+  /// Run \a f in a child process and wait for it to exit. The child
+  /// fails if \a f returns false.
+  template <typename F> static void inChild(F f) {
+    pid_t pid = fork();
+    ASSERT_GE(pid, 0);
+    if (pid == 0)
+      _exit(f() ? 0 : 1);
+    int status;
+    ASSERT_EQ(waitpid(pid, &status, 0), pid);
+    ASSERT_TRUE(WIFEXITED(status));
+    ASSERT_EQ(WEXITSTATUS(status), 0);
+  }
+};
+
+TEST_F(SharedStatisticsTest, FlushedUpdatesAreShared) {
+  StatisticManager &sm = *theStatisticManager;
+  uint64_t before = testStatistic.getValue();
+
+  sm.setIndex(2);
+  inChild([&] {
+    testStatistic += 5;
+    sm.flushStatistics();
+    // Pending until the next flush, which never comes
+    testStatistic += 3;
+    return true;
+  });
+  EXPECT_EQ(testStatistic.getValue(), before + 5);
+  EXPECT_EQ(sm.getIndexedValue(testStatistic, 2), 5u);
+
+  // Pending updates of this process are seen by itself
+  testStatistic += 7;
+  EXPECT_EQ(testStatistic.getValue(), before + 12);
+  EXPECT_EQ(sm.getIndexedValue(testStatistic, 2), 12u);
+  sm.flushStatistics();
+  EXPECT_EQ(testStatistic.getValue(), before + 12);
+  EXPECT_EQ(sm.getIndexedValue(testStatistic, 2), 12u);
+}
+
+TEST_F(SharedStatisticsTest, ManyUpdatesAreFlushed) {
+  StatisticManager &sm = *theStatisticManager;
+  uint64_t before = sm.getIndexedValue(testStatistic, 1);
+
+  sm.setIndex(1);
+  inChild([&] {
+    for (unsigned i = 0; i < 100000; ++i)
+      ++testStatistic;
+    return true;
+  });
+  // Only the updates after the last batch are lost
+  uint64_t value = sm.getIndexedValue(testStatistic, 1);
+  EXPECT_GT(value, before + 90000);
+  EXPECT_LE(value, before + 100000);
+}
+
+TEST_F(SharedStatisticsTest, IndexedValues) {
+  StatisticManager &sm = *theStatisticManager;
+
+  inChild([&] {
+    sm.incrementIndexedValue(testStatistic, 3, 4);
+    sm.incrementIndexedValue(testStatistic, 0, 1);
+    sm.flushStatistics();
+    return true;
+  });
+  EXPECT_EQ(sm.getIndexedValue(testStatistic, 3), 4u);
+
+  sm.incrementIndexedValue(testStatistic, 3, 2);
+  EXPECT_EQ(sm.getIndexedValue(testStatistic, 3), 6u);
+  // Setting a value drops the pending updates
+  sm.setIndexedValue(testStatistic, 3, 1);
+  EXPECT_EQ(sm.getIndexedValue(testStatistic, 3), 1u);
+  sm.flushStatistics();
+  EXPECT_EQ(sm.getIndexedValue(testStatistic, 3), 1u);
+}
+
+TEST_F(SharedStatisticsTest, ClaimsAreImmediate) {
+  StatisticManager &sm = *theStatisticManager;
+  uint64_t before = testStatistic.getValue();
+
+  sm.setIndex(4);
+  inChild([&] { return sm.claimStatistic(testStatistic); });
+  EXPECT_FALSE(sm.claimStatistic(testStatistic));
+  EXPECT_EQ(testStatistic.getValue(), before + 1);
+}
+}
@@ -0,0 +1,167 @@
+//===-- TimingSolverTest.cpp ------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+
+#include "Core/CoreStats.h"
+#include "Core/TimingSolver.h"
+
+#include "klee/Expr/ArrayCache.h"
+#include "klee/Expr/Assignment.h"
+#include "klee/Expr/Constraints.h"
+#include "klee/Expr/Expr.h"
+#include "klee/Solver/Solver.h"
+#include "klee/Solver/SolverCmdLine.h"
+#include "klee/Solver/SolverStats.h"
+
+#include "llvm/Support/CommandLine.h"
+
+#include <memory>
+
+using namespace klee;
+
+namespace {
+
+class TimingSolverTest : public ::testing::Test {
+protected:
+  ArrayCache arrayCache;
+  const Array *array;
+  std::unique_ptr<TimingSolver> solver;
+  ConstraintSet constraints;
+  SolverQueryMetaData metaData;
+
+  static void setModelCacheSize(unsigned size) {
+    auto &options = llvm::cl::getRegisteredOptions();
+    static_cast<llvm::cl::opt<unsigned> *>(options["state-model-cache-size"])
+        ->setValue(size);
+  }
+
+  TimingSolverTest()
+      : array(arrayCache.CreateArray("x", 1)),
+        solver(new TimingSolver(createCoreSolver(CoreSolverToUse))) {
+    setModelCacheSize(4);
+  }
+
+  ~TimingSolverTest() { setModelCacheSize(0); }
+
+  ref<Expr> x() {
+    return ReadExpr::create(UpdateList(array, 0),
+                            ConstantExpr::create(0, Expr::Int32));
+  }
+
+  ref<Expr> constant(uint64_t value) {
+    return ConstantExpr::create(value, Expr::Int8);
+  }
+
+  void addConstraint(const ref<Expr> &e) {
+    ConstraintManager(constraints).addConstraint(e);
+  }
+
+  /// Check that all models kept for the constraints satisfy them.
+  void expectModelsSatisfyConstraints() {
+    for (const auto &model : metaData.models) {
+      AssignmentBatchEvaluator evaluator({model.get()});
+      for (const auto &constraint : constraints) {
+        ref<ConstantExpr> value = evaluator.evaluate(constraint).front();
+        ASSERT_FALSE(value.isNull());
+        EXPECT_TRUE(value->isTrue());
+      }
+    }
+  }
+};
+
+TEST_F(TimingSolverTest, MissesIssueOneQuery) {
+  addConstraint(UltExpr::create(x(), constant(100)));
+
+  // Not answered by any model, so the solver is asked once for a model
+  // under which x < 50 is false, which also answers the query
+  uint64_t queries = stats::queries, misses = stats::modelReuseMisses;
+  bool result;
+  ASSERT_TRUE(solver->mustBeTrue(constraints,
+                                 UltExpr::create(x(), constant(50)), result,
+                                 metaData));
+  EXPECT_FALSE(result);
+  EXPECT_EQ(stats::queries - queries, 1u);
+  EXPECT_EQ(stats::modelReuseMisses - misses, 1u);
+  ASSERT_EQ(metaData.models.size(), 1u);
+  expectModelsSatisfyConstraints();
+
+  queries = stats::queries;
+  ref<ConstantExpr> value;
+  ASSERT_TRUE(solver->getValue(constraints, x(), value, metaData));
+  EXPECT_GE(value->getZExtValue(), 50u);
+  EXPECT_LT(value->getZExtValue(), 100u);
+  EXPECT_EQ(stats::queries, queries);
+
+  // A valid query has no counterexample to keep
+  ASSERT_TRUE(solver->mustBeTrue(constraints,
+                                 UltExpr::create(x(), constant(200)), result,
+                                 metaData));
+  EXPECT_TRUE(result);
+  EXPECT_EQ(stats::queries - queries, 1u);
+  EXPECT_EQ(metaData.models.size(), 1u);
+}
+
+TEST_F(TimingSolverTest, Evaluate) {
+  addConstraint(UltExpr::create(x(), constant(100)));
+
+  Solver::Validity validity;
+  ASSERT_TRUE(solver->evaluate(constraints, UltExpr::create(x(), constant(50)),
+                               validity, metaData));
+  EXPECT_EQ(validity, Solver::Unknown);
+  EXPECT_EQ(metaData.models.size(), 2u);
+
+  uint64_t queries = stats::queries, hits = stats::modelReuseHits;
+  ASSERT_TRUE(solver->evaluate(constraints, UltExpr::create(x(), constant(50)),
+                               validity, metaData));
+  EXPECT_EQ(validity, Solver::Unknown);
+  EXPECT_EQ(stats::queries, queries);
+  EXPECT_EQ(stats::modelReuseHits - hits, 1u);
+
+  ASSERT_TRUE(solver->evaluate(constraints,
+                               UltExpr::create(x(), constant(200)), validity,
+                               metaData));
+  EXPECT_EQ(validity, Solver::True);
+  ASSERT_TRUE(solver->evaluate(constraints,
+                               UgtExpr::create(x(), constant(150)), validity,
+                               metaData));
+  EXPECT_EQ(validity, Solver::False);
+  expectModelsSatisfyConstraints();
+}
+
+TEST_F(TimingSolverTest, ConstraintsAddedLater) {
+  addConstraint(UltExpr::create(x(), constant(100)));
+  ref<ConstantExpr> first;
+  ASSERT_TRUE(solver->getValue(constraints, x(), first, metaData));
+
+  // The model of the first value is dropped once it is excluded
+  addConstraint(NeExpr::create(x(), first));
+  ref<ConstantExpr> second;
+  ASSERT_TRUE(solver->getValue(constraints, x(), second, metaData));
+  EXPECT_NE(first, second);
+  EXPECT_LT(second->getZExtValue(), 100u);
+  expectModelsSatisfyConstraints();
+
+  // Adding an equality rewrites the earlier constraints
+  unsigned fixed = second->getZExtValue() == 7 ? 8 : 7;
+  addConstraint(EqExpr::create(constant(fixed), x()));
+  ref<ConstantExpr> third;
+  ASSERT_TRUE(solver->getValue(constraints, x(), third, metaData));
+  EXPECT_EQ(third->getZExtValue(), fixed);
+  expectModelsSatisfyConstraints();
+
+  // A different set of constraints has its own models checked as well
+  ConstraintSet other;
+  ConstraintManager(other).addConstraint(
+      UgtExpr::create(x(), constant(200)));
+  ref<ConstantExpr> fourth;
+  ASSERT_TRUE(solver->getValue(other, x(), fourth, metaData));
+  EXPECT_GT(fourth->getZExtValue(), 200u);
+}
+}